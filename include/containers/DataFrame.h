@@ -1,4 +1,8 @@
 #pragma once
+#include <array>
+#include "extsort.h"
+#include "groupby.h"
+#include "zonemap.h"
 
 template <typename... Args>
 class DataFrame {
@@ -32,14 +36,28 @@ public:
     insert_from_tuple(tup, int_<index + 1>());
   }
 
+  //a column at a time when the result can be read in batches
   template <typename ResType>
     void loadResult(ResType res) {
-    while(res->next()) {
-      ++_nrow;
-      insert_from_tuple(readRow(res), int_<1>());
+    if constexpr (has_batches<ResType>::value) {
+      for (auto batch = res->nextBatch(defaultBatchRows); batch.nrow != 0;
+           batch = res->nextBatch(defaultBatchRows)) {
+        appendBatch(batch, std::index_sequence_for<Args...>());
+        _nrow += batch.nrow;
+      }
+    } else {
+      while(res->next()) {
+        ++_nrow;
+        insert_from_tuple(readRow(res), int_<1>());
+      }
     }
   }
 
+  template <typename Batch, size_t... J>
+    void appendBatch(const Batch& batch, std::index_sequence<J...>) {
+    (batch.columns[J].appendTo(std::get<J>(_data)), ...);
+  }
+
   uint nrow() {return  _nrow;}
 
   static constexpr uint ncol() {return (uint) std::tuple_size<RowType>::value;}
@@ -66,7 +84,96 @@ public:
     return extractRow<0, Args...>(i);
   }
 
+  //the rows grouped by the values of column k, with op of the values
+  //of column v in each group, groups in the order of their first row
+  template <size_t k, size_t v>
+    std::vector< std::pair< atype<k>, double > > groupBy(const AggregateOp op) {
+    const ctype<k>& keys = column<k>();
+    const ctype<v>& values = column<v>();
+    const auto groups = groupRows< atype<k> >(
+      keys.size(), 1,
+      [&keys] (const std::size_t i) -> const atype<k>& { return keys[i];},
+      [&values] (std::size_t, const std::size_t i) { return (double) values[i];});
+    std::vector< std::pair< atype<k>, double > > result;
+    for (std::size_t g = 0; g != groups.size(); ++g)
+      result.emplace_back(groups.keys[g], groups.at(g, 0).value(op));
+    return result;
+  }
+
+  //the rows sorted by the columns K..., the first one first, each of them
+  //from the smallest value unless it is descending.
+  //rows that sort the same stay in their order.
+  template <size_t... K>
+    void orderBy(const std::array<bool, sizeof...(K)>& descending = {},
+                 const std::size_t budget = defaultSortBudget) {
+    ExternalSort sort(budget);
+    for (uint i = 0; i != _nrow; ++i) {
+      std::string key;
+      std::size_t j = 0;
+      (appendSortKey(key, column<K>()[i], descending[j++]), ...);
+      sort.add(std::move(key), std::string((const char*) &i, sizeof(i)));
+    }
+    std::vector<uint> order;
+    order.reserve(_nrow);
+    for (const SortRecord* r = sort.next(); r; r = sort.next()) {
+      uint i;
+      std::memcpy(&i, r->payload.data(), sizeof(i));
+      order.push_back(i);
+    }
+    permute(order, std::index_sequence_for<Args...>());
+    _zones = decltype(_zones)();
+  }
+
+  //the zone map of column j, in blocks of defaultZoneRows rows,
+  //brought up to date with the rows added since it was last read
+  template <size_t j>
+    const ZoneMap< atype<j> >& zoneMap() {
+    ZoneMap< atype<j> >& zones = std::get<j>(_zones);
+    const ctype<j>& values = column<j>();
+    for (std::size_t i = zones.rows(); i < values.size(); ++i) zones.append(values[i]);
+    return zones;
+  }
+
+  //the rows whose value of column j is from low to high, with no bound
+  //on a side without one, read from the blocks the zone map does not rule out
+  template <size_t j>
+    std::vector<uint> rangeRows(const std::optional< atype<j> >& low, const bool lowIncluded,
+                                const std::optional< atype<j> >& high, const bool highIncluded) {
+    const ZoneMap< atype<j> >& zones = zoneMap<j>();
+    const ctype<j>& values = column<j>();
+    std::vector<uint> rows;
+    for (const std::size_t b: zones.blocks(low, lowIncluded, high, highIncluded))
+      for (std::size_t i = zones.first(b); i != zones.last(b); ++i) {
+        const atype<j>& x = values[i];
+        if (low and (lowIncluded ? x < *low : not (*low < x))) continue;
+        if (high and (highIncluded ? *high < x : not (x < *high))) continue;
+        if constexpr (std::is_floating_point< atype<j> >::value)
+          if (x != x) continue;
+        rows.push_back((uint) i);
+      }
+    return rows;
+  }
+
+  template <size_t j>
+    std::vector<uint> equalRows(const atype<j>& x) {
+    return rangeRows<j>(x, true, x, true);
+  }
+
 private:
+  template <size_t... J>
+    void permute(const std::vector<uint>& order, std::index_sequence<J...>) {
+    (permuteColumn(std::get<J>(_data), order), ...);
+  }
+
+  template <typename T>
+    static void permuteColumn(std::vector<T>& values, const std::vector<uint>& order) {
+    std::vector<T> sorted;
+    sorted.reserve(order.size());
+    for (const uint i: order) sorted.push_back(std::move(values[i]));
+    values.swap(sorted);
+  }
+
   typename VectorizedTuple<Args...>::type _data;
   uint _nrow = 0;
+  std::tuple< ZoneMap<Args>... > _zones;
 };
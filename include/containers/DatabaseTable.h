@@ -1,4 +1,5 @@
 #pragma once
+#include "task.h"
 
 template <typename R, typename... Args>
 struct Row {
@@ -26,15 +27,33 @@ public:
 
 	template<class ResType>
 	void loadResult(ResType const res) {
-		while(res->next()) {
-			_data.push_back(read(res));
+		if constexpr (has_batches<ResType>::value) {
+			for (auto batch = res->nextBatch(defaultBatchRows); batch.nrow != 0;
+			     batch = res->nextBatch(defaultBatchRows))
+				appendBatchRows(_data, batch, std::index_sequence_for<Args...>());
+		} else {
+			while(res->next()) {
+				_data.push_back(read(res));
+			}
 		}
 	}
 
+	//through a cursor of its own, so that queries on the same table
+	//can be loaded at the same time
 	template<class QueryType>
 	void loadQuery(QueryType const query) {
-		const auto res = query->execute();
-		loadResult(res);
+		const auto res = query->cursor();
+		loadResult(&res);
+	}
+
+	//execute the query and load its result on the pool, so that several
+	//tables load at once. the task returns the number of rows, and works
+	//on this table, that must not be moved or destroyed before get()
+	//has returned.
+	template<class QueryType>
+	Async::Task<uint> loadQueryAsync(QueryType const query,
+	                                 ThreadPool& pool = ThreadPool::shared()) {
+		return Async::async([this, query] () { loadQuery(query); return nrow(); }, pool);
 	}
 
 
@@ -26,13 +26,21 @@ public:
 
   template<class ResType>
   void loadResult(ResType res) {
-    while(res->next()) {
-      _data.push_back(readRow(res));
+    if constexpr (has_batches<ResType>::value) {
+      while (loadBatch(res, defaultBatchRows) != 0) {}
+    } else {
+      while(res->next()) {
+        _data.push_back(readRow(res));
+      }
     }
   }
 
   template<class ResType>
   ResType loadNext(ResType res, uint N=10000) {
+    if constexpr (has_batches<ResType>::value) {
+      loadBatch(res, N);
+      return res;
+    }
     uint n = 0;
     while(res->next() and n != N) {
       _data.push_back(readRow(res));
@@ -41,6 +49,14 @@ public:
     return res;
   }
 
+  //the next N rows at most, returns how many there were
+  template<class ResType>
+  uint loadBatch(ResType res, uint N) {
+    const auto batch = res->nextBatch(N);
+    appendBatchRows(_data, batch, std::index_sequence_for<Args...>());
+    return batch.nrow;
+  }
+
 private:
   std::vector<RowType> _data;
 };
@@ -0,0 +1,100 @@
+#pragma once
+#include <unordered_map>
+
+//the encodings of the columns of a ColumnRdbTable:
+//a dictionary of the distinct strings of a column, and the code of each row,
+//runs of rows with the same value, and the row each of them ends at,
+//and integers as offsets from the smallest of them, a frame of reference.
+//codes and offsets take 1, 2 or 4 bytes, as few as the largest of them needs.
+//a column is encoded in whichever of them takes the fewest bytes for its
+//values, and stays plain when none takes fewer than its values as they are.
+//
+//the values are read without decoding the column: a filter tests each string
+//of a dictionary, or each run, once, and an aggregate of a run adds its value
+//for all of its rows at once (see RdbQuery.cpp).
+//a row is appended to a column as it is encoded when the encoding has
+//room for its value; the column is decoded otherwise.
+class RdbEncodedColumn {
+public:
+  //the column encoded, null when it is better left as it is
+  static std::shared_ptr<const RdbEncodedColumn> encode(const RdbColumn& column);
+
+  ColumnEncoding encoding() const { return _encoding;}
+  ColumnType type() const { return _type;}
+  std::size_t size() const { return _size;}
+  //the bytes of the encoded values
+  std::size_t bytes() const;
+
+  //the strings of a dictionary, or the value of each run
+  const RdbColumn& values() const { return _values;}
+  //1 past the last row of each run
+  const std::vector<uint>& ends() const { return _ends;}
+  //the smallest value, for a frame of reference
+  int64_t base() const { return _base;}
+
+  //the run of a row, its index in values()
+  std::size_t run(const std::size_t row) const {
+    return (std::size_t) (std::upper_bound(_ends.begin(), _ends.end(), row) - _ends.begin());
+  }
+  //f(codes), with the codes of a dictionary, or the offsets
+  //of a frame of reference, an array of 1, 2 or 4 byte integers
+  template <typename F>
+  void withCodes(const F& f) const {
+    switch (_width) {
+    case 1: f(_codes8.data()); break;
+    case 2: f(_codes16.data()); break;
+    default: f(_codes32.data()); break;
+    }
+  }
+
+  //the value of a row, as getX of a column would read it
+  std::string_view stringView(const std::size_t row) const;
+  std::string getString(const std::size_t row) const;
+  double getDouble(const std::size_t row) const;
+  int getInt(const std::size_t row) const;
+  uint getUInt(const std::size_t row) const;
+
+  //append the values of the rows first + rows[i], or those
+  //from first on when rows is null, to a plain column of the same type
+  void decode(const std::size_t first, const uint* rows, const std::size_t n, RdbColumn& out) const;
+
+  //whether the value at row of a plain column of the same type can be
+  //appended without decoding: it is that of the last run, a string of
+  //the dictionary, or an integer in the range of the offsets
+  bool accepts(const RdbColumn& from, const std::size_t row) const;
+  //append it, when accepts(from, row)
+  void append(const RdbColumn& from, const std::size_t row);
+
+private:
+  RdbEncodedColumn(const ColumnEncoding encoding, const ColumnType type, const std::size_t size) :
+    _encoding(encoding), _type(type), _size(size), _values(type) {}
+
+  //the code, or the offset, of a row
+  uint32_t code(const std::size_t row) const {
+    switch (_width) {
+    case 1: return _codes8[row];
+    case 2: return _codes16[row];
+    default: return _codes32[row];
+    }
+  }
+  void setCodes(const std::vector<uint32_t>& codes, const uint32_t largest);
+  //the index into values() of the value of a row
+  std::size_t valueIndex(const std::size_t row) const {
+    return _encoding == ColumnEncoding::RunLength ? run(row) : code(row);
+  }
+  //the code a value would have, -1 when it has none
+  int64_t codeOf(const RdbColumn& from, const std::size_t row) const;
+
+  ColumnEncoding _encoding;
+  ColumnType _type;
+  std::size_t _size;
+  RdbColumn _values;
+  std::vector<uint> _ends;
+  int64_t _base = 0;
+  uint _width = 4;
+  std::vector<uint8_t> _codes8;
+  std::vector<uint16_t> _codes16;
+  std::vector<uint32_t> _codes32;
+  //the code of each string of a dictionary, once a row is appended
+  mutable std::unordered_map<std::string, uint32_t> _dictionary;
+};
@@ -0,0 +1,177 @@
+#pragma once
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "RelationalDatabaseSim.h"
+
+//equi-joins of tables of the database simulator, by hash.
+//the rows of the smaller table are put in a hash table by their key,
+//and the rows of the other one look their key up, a batch at a time.
+//
+//  ColumnRdbTable trades = hashJoin(orders, customers, 2, 1);
+//
+//has the columns of orders, then those of customers, for each pair of rows
+//with the same key, in no particular order.
+//keys compare as strings when both key columns hold strings,
+//and as numbers otherwise.
+
+//an open addressing hash table, from keys to the rows that have them.
+//a slot holds a key and the first of its rows, and further rows with
+//the same key are chained from there, in the order they were given.
+//when the slots would not fit in cache, the keys are first split
+//by the high bits of their hash into partitions that do, each with slots
+//of its own: a batch of lookups sorted by partition then works within
+//one partition at a time.
+template <typename K>
+class RdbHashIndex {
+public:
+  static constexpr uint None = std::numeric_limits<uint>::max();
+  //bytes of slots a partition is kept under
+  static constexpr std::size_t CacheBytes = 1 << 18;
+  static constexpr uint MaxBits = 12;
+
+  RdbHashIndex() = default;
+
+  //rows[i] has key keys[i]
+  RdbHashIndex(const std::vector<K>& keys, const std::vector<uint>& rows) {
+    const std::size_t n = keys.size();
+    while (_bits < MaxBits and ((n * 2 * sizeof(Slot)) >> _bits) > CacheBytes) ++_bits;
+
+    //a radix pass, the entries of a partition next to each other
+    std::vector<uint64_t> hashes(n);
+    std::vector<std::size_t> start(partitions() + 1, 0);
+    for (std::size_t i = 0; i != n; ++i) {
+      hashes[i] = hash(keys[i]);
+      ++start[partition(hashes[i]) + 1];
+    }
+    for (uint p = 0; p != partitions(); ++p) start[p + 1] += start[p];
+    std::vector<std::size_t> fill(start.begin(), start.end() - 1);
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0; i != n; ++i) order[fill[partition(hashes[i])]++] = i;
+
+    _partitions.clear();
+    std::size_t total = 0;
+    for (uint p = 0; p != partitions(); ++p) {
+      std::size_t capacity = 1;
+      while (capacity < 2 * (start[p + 1] - start[p])) capacity <<= 1;
+      _partitions.push_back(Partition{total, capacity - 1});
+      total += capacity;
+    }
+    _slots.assign(total, Slot{K(), None});
+    _rows.resize(n);
+    _next.assign(n, None);
+    //from the last, so that the chain of a key lists its rows in order
+    for (std::size_t e = n; e-- != 0;) {
+      const std::size_t i = order[e];
+      _rows[e] = rows[i];
+      Slot& s = lookup(keys[i], hashes[i]);
+      if (s.head == None) s.key = keys[i];
+      _next[e] = s.head;
+      s.head = (uint) e;
+    }
+  }
+
+  static uint64_t hash(const K& key) {
+    uint64_t h;
+    if constexpr (std::is_floating_point<K>::value) {
+      //0.0 and -0.0 are the same key
+      const double x = key == 0 ? 0.0 : (double) key;
+      std::memcpy(&h, &x, sizeof(h));
+    } else {
+      h = (uint64_t) std::hash<K>()(key);
+    }
+    //the finalizer of murmur3, so that high and low bits are all mixed
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  uint partitions() const { return 1U << _bits;}
+  uint partition(const uint64_t h) const {
+    return _bits == 0 ? 0 : (uint) (h >> (64 - _bits));
+  }
+  std::size_t size() const { return _rows.size();}
+
+  void prefetch(const uint64_t h) const {
+    const Partition& p = _partitions[partition(h)];
+    __builtin_prefetch(&_slots[p.base + (h & p.mask)]);
+  }
+
+  //f(row) for each row with the key, of hash h
+  template <typename F>
+  void find(const K& key, const uint64_t h, const F& f) const {
+    const Partition& p = _partitions[partition(h)];
+    for (std::size_t i = h & p.mask;; i = (i + 1) & p.mask) {
+      const Slot& s = _slots[p.base + i];
+      if (s.head == None) return;
+      if (s.key == key) {
+        for (uint e = s.head; e != None; e = _next[e]) f(_rows[e]);
+        return;
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    K key;
+    uint head;
+  };
+  struct Partition {
+    std::size_t base;
+    std::size_t mask;
+  };
+
+  //the slot of the key, or the empty one where it would go
+  Slot& lookup(const K& key, const uint64_t h) {
+    const Partition& p = _partitions[partition(h)];
+    for (std::size_t i = h & p.mask;; i = (i + 1) & p.mask) {
+      Slot& s = _slots[p.base + i];
+      if (s.head == None or s.key == key) return s;
+    }
+  }
+
+  uint _bits = 0;
+  std::vector<Partition> _partitions {Partition{0, 0}};
+  std::vector<Slot> _slots {Slot{K(), None}};
+  std::vector<uint> _rows;
+  std::vector<uint> _next;
+};
+
+//the build side of a join: the selected rows of a key column, by key.
+//string keys refer to the column, that should outlive the table.
+class RdbJoinTable {
+public:
+  //the rows of keys, or its first n when rows is null.
+  //keys are strings when text, otherwise numbers.
+  RdbJoinTable(const RdbColumnSpan& keys, const uint* rows, const uint n, const bool text);
+
+  //append the pairs of a probe row and a build row with the same key,
+  //for the rows of keys
+  void probe(const RdbColumnSpan& keys, const uint* rows, const uint n,
+             std::vector<uint>& probeRows, std::vector<uint>& buildRows) const;
+
+  uint partitions() const { return _text ? _strings.partitions() : _numbers.partitions();}
+  std::size_t size() const { return _text ? _strings.size() : _numbers.size();}
+
+private:
+  bool _text;
+  RdbHashIndex<double> _numbers;
+  RdbHashIndex<std::string_view> _strings;
+};
+
+//the join of two batches, the columns of left then those of right,
+//on the (1 based) key columns
+ColumnRdbTable hashJoin(const RdbBatch& left, const RdbBatch& right,
+                        const uint leftKey, const uint rightKey);
+
+template <class Left, class Right>
+ColumnRdbTable hashJoin(const Left& left, const Right& right,
+                        const uint leftKey, const uint rightKey) {
+  return hashJoin(left.batch(0, left.size()), right.batch(0, right.size()), leftKey, rightKey);
+}
@@ -0,0 +1,336 @@
+#pragma once
+#include <memory>
+#include <optional>
+#include "extsort.h"
+#include "groupby.h"
+#include "RelationalDatabaseSim.h"
+#include "RdbJoin.h"
+
+//queries over the tables of a DbSim, built clause by clause:
+//
+//  const auto q = RdbQuery::scan("trades")
+//    .filter(col(2) >= 100)
+//    .filter(col(3) == "buy")
+//    .project({1, 2})
+//    .limit(10);
+//  ColumnRdbTable result = q.execute(dbsim);
+//
+//the clauses mean what they would in SQL, in whatever order they are given:
+//join pairs the rows of the table with those of another with the same key,
+//the filters select the rows that pass all of them, project picks the
+//columns of the result (all of them when there is no projection),
+//aggregate reduces the selected rows to one, or to one per group of rows
+//with the same values in the columns of groupBy, orderBy sorts the rows of
+//the result, and limit keeps its first rows. columns are (1 based) indexes
+//into the scanned table, followed by the columns of the joined one,
+//but for those of orderBy, that are columns of the result, as in ORDER BY 1, 2.
+//a query runs on batches of rows of the table. each filter refines
+//a selection vector, the indexes of the rows of the batch that passed
+//the filters so far, and only the selected values of the projected
+//columns are copied out: filters and projections are part of the scan.
+//a join is a hash join (see RdbJoin.h), built on the smaller table,
+//once the filters on its columns have been applied to it, and probed
+//by the batches of the other.
+//a filter on a column of the scanned table with an index (see DbSim::createIndex)
+//has the index find its rows: the scan reads those alone, those of the
+//smallest set when several filters have an index, and the filters still
+//apply to them.
+//otherwise the scan skips the blocks of rows that the zone maps of the
+//columns of the filters (see zonemap.h) rule out, those with no value
+//in the range of a comparison, or equal to that of an equality.
+//a column of a table of the database is read as it is encoded (see
+//RdbEncoding.h): a filter tests each value of a dictionary, or of a run,
+//once, and an aggregate adds the value of a run for all its rows at once.
+//a sort is an external merge sort (see extsort.h): the rows of the result
+//are sorted in runs, within the memory of the query, and those that do
+//not fit are written to temporary files, to be merged back.
+
+enum class CompareOp { Eq, Ne, Lt, Le, Gt, Ge };
+
+//a column compared with a constant, a number or a string.
+//strings compare as strings with a string, as numbers with a number.
+struct RdbPredicate {
+  uint column = 0;
+  CompareOp op = CompareOp::Eq;
+  bool text = false;
+  double number = 0;
+  std::string string;
+};
+
+struct RdbColumnRef {
+  uint index;
+};
+
+inline RdbColumnRef col(const uint index) { return RdbColumnRef{index};}
+
+inline RdbPredicate compare(const RdbColumnRef c, const CompareOp op, const double x) {
+  RdbPredicate p;
+  p.column = c.index;
+  p.op = op;
+  p.number = x;
+  return p;
+}
+
+inline RdbPredicate compare(const RdbColumnRef c, const CompareOp op, const std::string& x) {
+  RdbPredicate p;
+  p.column = c.index;
+  p.op = op;
+  p.text = true;
+  p.string = x;
+  return p;
+}
+
+template <typename X>
+RdbPredicate operator==(const RdbColumnRef c, const X& x) { return compare(c, CompareOp::Eq, x);}
+template <typename X>
+RdbPredicate operator!=(const RdbColumnRef c, const X& x) { return compare(c, CompareOp::Ne, x);}
+template <typename X>
+RdbPredicate operator<(const RdbColumnRef c, const X& x) { return compare(c, CompareOp::Lt, x);}
+template <typename X>
+RdbPredicate operator<=(const RdbColumnRef c, const X& x) { return compare(c, CompareOp::Le, x);}
+template <typename X>
+RdbPredicate operator>(const RdbColumnRef c, const X& x) { return compare(c, CompareOp::Gt, x);}
+template <typename X>
+RdbPredicate operator>=(const RdbColumnRef c, const X& x) { return compare(c, CompareOp::Ge, x);}
+
+//an AggregateOp (see groupby.h) of a column.
+//count is a UInt column of the result, the others are Double.
+//over no rows, sum is 0, and min, max and avg are NaN.
+struct RdbAggregate {
+  AggregateOp op = AggregateOp::Count;
+  uint column = 0;
+
+  static RdbAggregate count() { return RdbAggregate{AggregateOp::Count, 0};}
+  static RdbAggregate sum(const uint column) { return RdbAggregate{AggregateOp::Sum, column};}
+  static RdbAggregate min(const uint column) { return RdbAggregate{AggregateOp::Min, column};}
+  static RdbAggregate max(const uint column) { return RdbAggregate{AggregateOp::Max, column};}
+  static RdbAggregate avg(const uint column) { return RdbAggregate{AggregateOp::Avg, column};}
+};
+
+//a column of the result to sort its rows by.
+//numbers sort as numbers, and strings as strings, even those of numbers.
+struct RdbOrder {
+  uint column = 0;
+  bool descending = false;
+
+  static RdbOrder asc(const uint column) { return RdbOrder{column, false};}
+  static RdbOrder desc(const uint column) { return RdbOrder{column, true};}
+};
+
+//the rows of table with the value of leftKey (a column of the scanned
+//table) in their column rightKey
+struct RdbJoinClause {
+  std::string table;
+  uint leftKey = 0;
+  uint rightKey = 0;
+};
+
+class RdbQueryResult;
+
+class RdbQuery {
+public:
+  static RdbQuery scan(const std::string& table) { return RdbQuery(table);}
+
+  //a query joins one other table at most
+  RdbQuery& join(const std::string& table, const uint leftKey, const uint rightKey) {
+    _join = RdbJoinClause{table, leftKey, rightKey};
+    return *this;
+  }
+  RdbQuery& filter(const RdbPredicate& p) {
+    _predicates.push_back(p);
+    return *this;
+  }
+  RdbQuery& project(const std::vector<uint>& columns) {
+    _columns = columns;
+    return *this;
+  }
+  RdbQuery& aggregate(const std::vector<RdbAggregate>& aggregates) {
+    _aggregates = aggregates;
+    return *this;
+  }
+  //the result has the columns of groupBy, then the aggregates
+  RdbQuery& groupBy(const std::vector<uint>& columns) {
+    _groupBy = columns;
+    return *this;
+  }
+  //rows that sort the same by the first column are sorted by the next one,
+  //and so on; rows that sort the same by all of them stay in their order
+  RdbQuery& orderBy(const std::vector<RdbOrder>& orders) {
+    _orderBy = orders;
+    return *this;
+  }
+  //the bytes of rows a sort keeps in memory
+  RdbQuery& sortMemory(const std::size_t bytes) {
+    _sortMemory = bytes;
+    return *this;
+  }
+  RdbQuery& limit(const uint n) {
+    _limit = n;
+    return *this;
+  }
+
+  const std::string& table() const { return _table;}
+  const std::optional<RdbJoinClause>& joined() const { return _join;}
+  const std::vector<RdbPredicate>& predicates() const { return _predicates;}
+  const std::vector<uint>& columns() const { return _columns;}
+  const std::vector<RdbAggregate>& aggregates() const { return _aggregates;}
+  const std::vector<uint>& groupedBy() const { return _groupBy;}
+  const std::vector<RdbOrder>& orderedBy() const { return _orderBy;}
+  std::size_t sortBudget() const { return _sortMemory;}
+  uint rowLimit() const { return _limit;}
+
+  //the query running on a database, its result read in batches
+  RdbQueryResult open(const DbSim& db) const;
+  //all of the result
+  ColumnRdbTable execute(const DbSim& db) const;
+
+private:
+  explicit RdbQuery(const std::string& table) : _table(table) {}
+
+  std::string _table;
+  std::optional<RdbJoinClause> _join;
+  std::vector<RdbPredicate> _predicates;
+  std::vector<uint> _columns;
+  std::vector<RdbAggregate> _aggregates;
+  std::vector<uint> _groupBy;
+  std::vector<RdbOrder> _orderBy;
+  std::size_t _sortMemory = defaultSortBudget;
+  uint _limit = std::numeric_limits<uint>::max();
+};
+
+//a running query: nextBatch(n) returns up to n rows of the result,
+//and none once it is over, as a table would.
+//it refers to the tables of the database, that should outlive it.
+class RdbQueryResult {
+public:
+  RdbQueryResult(const RdbQuery& query, const DbSim& db);
+
+  //the types of the columns of the result
+  const ColumnRdbTable::Schema& schema() const { return _schema;}
+  //how many rows of the scanned table were read, or skipped, so far
+  uint scanned() const { return _position;}
+  //whether an index found the rows to scan
+  bool indexed() const { return _indexed.has_value();}
+  //how many of the rows scanned were skipped, in blocks their zone maps ruled out
+  uint skipped() const { return _skipped;}
+
+  RdbBatch nextBatch(const uint n);
+
+private:
+  //a table of the database, of either kind
+  struct Source {
+    const ColumnRdbTable* columns = nullptr;
+    const StrRowRdbTable* rows = nullptr;
+    uint nrow = 0;
+    ColumnRdbTable::Schema schema;
+    std::string name;
+
+    Source(const DbSim& db, const std::string& name);
+    //n rows from the (0 based) row first
+    RdbBatch batch(const uint first, const uint n) const;
+    //the same, the values of encoded columns left as they are
+    RdbBatch encodedBatch(const uint first, const uint n) const;
+    //the n (0 based) rows at indexes
+    RdbBatch gather(const uint* indexes, const uint n) const;
+  };
+
+  //where a column of the query is: in the batch being scanned,
+  //or in the build side of the join, and its (0 based) index there
+  struct Place {
+    bool scanned;
+    uint index;
+  };
+
+  Place place(const uint column) const;
+  //the values of a column, and the rows of them that are in the result
+  const RdbColumnSpan& values(const Place& p) const {
+    return p.scanned ? _batch.columns[p.index] : _build.columns[p.index];
+  }
+  const uint* rows(const Place& p) const {
+    return p.scanned ? _selection.data() : _buildRows.data();
+  }
+
+  //the rows an index finds for the filters, if there is one
+  void findIndexed(const DbSim& db);
+  //the blocks of the scanned table that the zone maps of the filters rule out,
+  //when no index found the rows
+  void findZones(const DbSim& db);
+  //read the next rows of the scanned table, into _batch,
+  //with the rows of the result in _selection and _buildRows.
+  //false when the scan is over.
+  bool scan(const uint n);
+  RdbBatch aggregateAll();
+  RdbBatch nextGroups(const uint n);
+  RdbBatch nextSorted(const uint n);
+
+  RdbQuery _query;
+  Source _scan;
+  std::vector<RdbPredicate> _filters;
+  std::vector<Place> _output;
+  std::vector<Place> _aggregated;
+  ColumnRdbTable::Schema _schema;
+
+  //the join, built on _build, probed with the key _scanKey of _batch
+  bool _scanIsLeft = true;
+  uint _leftColumns = 0;
+  uint _scanKey = 0;
+  RdbBatch _build;
+  std::shared_ptr<const RdbJoinTable> _joinTable;
+
+  //the rows to scan, when an index found them, all of them otherwise.
+  //_position is then an index into them.
+  std::optional< std::vector<uint> > _indexed;
+  uint _position = 0;
+  uint _returned = 0;
+  //the blocks of _zoneRows rows with no row that passes the filters,
+  //none when they may all have some
+  std::vector<bool> _ruledOut;
+  uint _zoneRows = 0;
+  uint _skipped = 0;
+  uint _first = 0;
+  RdbBatch _batch;
+  std::vector<uint> _selection;
+  std::vector<uint> _buildRows;
+  //the rows of the result in the batch, and how many were returned
+  uint _matches = 0;
+  uint _next = 0;
+  //for each filter on an encoded column, whether each code of its dictionary
+  //passes it, and for each aggregate, the number each code of a dictionary reads as
+  std::vector< std::vector<int8_t> > _passing;
+  std::vector< std::vector< std::optional<double> > > _numbers;
+
+  //for a group by, the rows to group, with the keys then the aggregated columns,
+  //and the groups, once they are all there.
+  //for an order by, the rows to sort, and the sort, that has them all
+  //once the input is gone
+  std::shared_ptr<RdbQueryResult> _input;
+  std::shared_ptr<const ColumnRdbTable> _groups;
+  std::shared_ptr<ExternalSort> _sorted;
+};
+
+//the rows of a batch grouped by the values of the (1 based) key columns,
+//with the keys then the aggregates of each group, in the order of their first row
+ColumnRdbTable groupBy(const RdbBatch& batch, const std::vector<uint>& keys,
+                       const std::vector<RdbAggregate>& aggregates);
+
+template <class Table>
+ColumnRdbTable groupBy(const Table& table, const std::vector<uint>& keys,
+                       const std::vector<RdbAggregate>& aggregates) {
+  return groupBy(table.batch(0, table.size()), keys, aggregates);
+}
+
+//the rows of a batch sorted by some of its columns
+ColumnRdbTable orderBy(const RdbBatch& batch, const std::vector<RdbOrder>& orders,
+                       const std::size_t budget = defaultSortBudget);
+
+template <class Table>
+ColumnRdbTable orderBy(const Table& table, const std::vector<RdbOrder>& orders,
+                       const std::size_t budget = defaultSortBudget) {
+  return orderBy(table.batch(0, table.size()), orders, budget);
+}
+
+//the join of two tables of a database, the columns of left then those of right
+inline ColumnRdbTable hashJoin(const DbSim& db, const std::string& left, const std::string& right,
+                               const uint leftKey, const uint rightKey) {
+  return RdbQuery::scan(left).join(right, leftKey, rightKey).execute(db);
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include "zonemap.h"
 
 class StrRdbRow {
   //using DataStr = std::vector<std::string>;
@@ -63,6 +64,176 @@ Header<Args...> header(Args... names) {
     return Header<Args...>(names...);
 }
 
+//the type of a column of a ColumnRdbTable
+enum class ColumnType { Double, Int, UInt, String };
+
+//how a column of a ColumnRdbTable stores its values (see RdbEncoding.h)
+enum class ColumnEncoding { Plain, Dictionary, RunLength, FrameOfReference };
+
+class RdbEncodedColumn;
+
+//n values of type T, one after the other
+template <typename T>
+struct Span {
+  const T* data = nullptr;
+  std::size_t size = 0;
+
+  const T* begin() const { return data;}
+  const T* end() const { return data + size;}
+  const T& operator[](std::size_t i) const { return data[i];}
+};
+
+//the values of a column for the rows of a batch,
+//in the span for the type of the column.
+//the i-th string is blob[offsets[i], offsets[i + 1]).
+//a span of an encoded column, from ColumnRdbTable::encodedBatch, has none
+//of these: its values are those of the rows from first on of encoded.
+struct RdbColumnSpan {
+  ColumnType type = ColumnType::String;
+  std::size_t size = 0;
+  Span<double> doubles;
+  Span<int> ints;
+  Span<uint> uints;
+  const char* blob = nullptr;
+  const std::size_t* offsets = nullptr;
+  const RdbEncodedColumn* encoded = nullptr;
+  std::size_t first = 0;
+
+  std::string_view stringView(std::size_t i) const {
+    return std::string_view(blob + offsets[i], offsets[i + 1] - offsets[i]);
+  }
+
+  //the i-th value as a T, converted as getX of a table would
+  template <typename T>
+  T get(std::size_t i) const {
+    if constexpr (std::is_same<T, std::string>::value) {
+      switch (type) {
+      case ColumnType::Double: return DataType::convert<std::string, double>(doubles[i]);
+      case ColumnType::Int: return DataType::convert<std::string, int>(ints[i]);
+      case ColumnType::UInt: return DataType::convert<std::string, uint>(uints[i]);
+      case ColumnType::String: return std::string(stringView(i));
+      }
+      return std::string();
+    } else {
+      switch (type) {
+      case ColumnType::Double: return (T) doubles[i];
+      case ColumnType::Int: return (T) ints[i];
+      case ColumnType::UInt: return (T) uints[i];
+      case ColumnType::String: return DataType::convert<T, std::string>(std::string(stringView(i)));
+      }
+      return T();
+    }
+  }
+
+  //append all the values, copied as they are when T is the type of the column
+  template <typename T>
+  void appendTo(std::vector<T>& out) const {
+    if constexpr (std::is_same<T, double>::value) {
+      if (type == ColumnType::Double) return (void) out.insert(out.end(), doubles.begin(), doubles.end());
+    } else if constexpr (std::is_same<T, int>::value) {
+      if (type == ColumnType::Int) return (void) out.insert(out.end(), ints.begin(), ints.end());
+    } else if constexpr (std::is_same<T, uint>::value) {
+      if (type == ColumnType::UInt) return (void) out.insert(out.end(), uints.begin(), uints.end());
+    }
+    out.reserve(out.size() + size);
+    for (std::size_t i = 0; i != size; ++i) out.push_back(get<T>(i));
+  }
+};
+
+//a column holds values of its declared type, in the vector for that type.
+//strings are kept one after the other in a blob, the i-th one
+//from offsets[i] to offsets[i + 1].
+//an encoded column holds them in encoded instead, and none in the vectors.
+struct RdbColumn {
+  explicit RdbColumn(ColumnType t) : type(t) {}
+
+  std::size_t size() const;
+  //parse a field into the type of the column
+  void append(const std::string& field);
+  //keep the first n values
+  void truncate(std::size_t n);
+
+  //store the values in the encoding that takes the fewest bytes
+  void encode();
+  //store them as they are, in the vectors
+  void decode();
+  ColumnEncoding encoding() const;
+
+  std::string_view stringView(std::size_t i) const;
+  std::string getString(std::size_t i) const;
+  double getDouble(std::size_t i) const;
+  int getInt(std::size_t i) const;
+  uint getUInt(std::size_t i) const;
+
+  //the n values from first on
+  RdbColumnSpan span(std::size_t first, std::size_t n) const;
+  //append the values of a span of the same type at rows,
+  //or its first n values when rows is null
+  void gather(const RdbColumnSpan& from, const uint* rows, std::size_t n);
+
+  ColumnType type;
+  std::vector<double> doubles;
+  std::vector<int> ints;
+  std::vector<uint> uints;
+  std::string blob;
+  std::vector<std::size_t> offsets {0};
+  std::shared_ptr<const RdbEncodedColumn> encoded;
+};
+
+//a batch of rows from a table, a span of values for each of its columns.
+//spans point into the table when it stores its columns,
+//or into the columns the batch owns when it had to build them.
+struct RdbBatch {
+  uint nrow = 0;
+  std::vector<RdbColumnSpan> columns;
+  std::shared_ptr< const std::vector<RdbColumn> > owned;
+};
+
+//a position of its own in a table, so that several scans of the same table,
+//from different threads, do not move each other along.
+//it reads like the table: next() moves to the next row,
+//and getX(index) reads the field at (1 based) index of that row.
+template <class Table>
+class RdbCursor {
+public:
+  explicit RdbCursor(const Table& table) : _table(&table) {}
+
+  uint size() const { return _table->size();}
+  uint position() const { return _position;}
+  const Table& table() const { return *_table;}
+
+  RdbCursor const* next() const {
+    if (++_position > _table->size()) { return nullptr;}
+    return this;
+  }
+  void reset() const { _position = 0;}
+
+  //the next n rows at most, none when the scan is over
+  RdbBatch nextBatch(const uint n) const {
+    const uint first = std::min(_position, _table->size());
+    const uint count = std::min(n, _table->size() - first);
+    _position = first + count;
+    return _table->batch(first, count);
+  }
+
+  std::string getString(const uint index) const {
+    return _table->getString(_position - 1, index);
+  }
+  double getDouble(const uint index) const {
+    return _table->getDouble(_position - 1, index);
+  }
+  int getInt(const uint index) const {
+    return _table->getInt(_position - 1, index);
+  }
+  uint getUInt(const uint index) const {
+    return _table->getUInt(_position - 1, index);
+  }
+
+private:
+  const Table* _table;
+  mutable uint _position = 0; //1 past the end
+};
+
 class StrRowRdbTable {
   using RowType = std::vector<std::string>;
 public:
@@ -104,23 +275,51 @@ StrRowRdbTable(const StrRowRdbTable& st) :
     _data.push_back(row);
   }
 
+  //the table's own position is shared by all its readers,
+  //a scan that may run alongside others should use a cursor()
   StrRowRdbTable const* next() const  {
     if (++_position > _data.size()) { return nullptr;}
     return this;
   }
+  RdbCursor<StrRowRdbTable> cursor() const { return RdbCursor<StrRowRdbTable>(*this);}
+
+  //the next n rows at most, as columns of strings
+  RdbBatch nextBatch(const uint n) const {
+    const uint first = std::min(_position, size());
+    const uint count = std::min(n, size() - first);
+    _position = first + count;
+    return batch(first, count);
+  }
+  //n rows from the (0 based) row first
+  RdbBatch batch(const uint first, const uint n) const;
+  //the n (0 based) rows at indexes
+  RdbBatch gather(const uint* indexes, const uint n) const;
 
   std::string getString(const uint index) const {
-      return _data[_position - 1].getString(index);
+      return getString(_position - 1, index);
   }
   double getDouble(const uint index) const {
-      return _data[_position - 1].getDouble(index);
+      return getDouble(_position - 1, index);
   }
   int getInt(const uint index) const {
-    return  _data[_position - 1].getInt(index);
+    return getInt(_position - 1, index);
   }
-
   uint getUInt(const uint index) const {
-    return  _data[_position - 1].getUInt(index);
+    return getUInt(_position - 1, index);
+  }
+
+  //the field at (1 based) index of the (0 based) row
+  std::string getString(const uint row, const uint index) const {
+      return _data[row].getString(index);
+  }
+  double getDouble(const uint row, const uint index) const {
+      return _data[row].getDouble(index);
+  }
+  int getInt(const uint row, const uint index) const {
+    return  _data[row].getInt(index);
+  }
+  uint getUInt(const uint row, const uint index) const {
+    return  _data[row].getUInt(index);
   }
 
   void printCurrent() {
@@ -260,16 +459,354 @@ private:
 
 
 
+//a table stored by column, with a declared schema.
+//fields are parsed once, when they are inserted, not at every read.
+//once encoded, each column is stored in the encoding that takes the fewest
+//bytes for its values; batches are then decoded, but for encodedBatch.
+//a row inserted into an encoded column is appended to it as it is encoded
+//when the encoding has room for its value. the column is decoded otherwise,
+//and encoded again once reencodeRows rows, or an eighth of the table,
+//are inserted after that.
+//it reads like a StrRowRdbTable: next() moves to the next row,
+//and getX(index) reads the field at (1 based) index of that row.
+class ColumnRdbTable {
+public:
+  using Schema = std::vector<ColumnType>;
+
+  //the fewest rows inserted into a table, after a column was decoded,
+  //before it is encoded again
+  static constexpr uint reencodeRows = 1024;
+
+  explicit ColumnRdbTable(const Schema& schema);
+  ColumnRdbTable(const Schema& schema, const std::vector< std::vector<std::string> >& table);
+  ColumnRdbTable(const Schema& schema, const StrRowRdbTable& table);
+  //a table of columns of the same size
+  explicit ColumnRdbTable(std::vector<RdbColumn> columns);
+
+ColumnRdbTable(const ColumnRdbTable& ct) :
+  _schema(ct.schema()), _columns(ct._columns), _nrow(ct.nrow()), _position(0),
+    _encoded(ct._encoded), _dirty(ct._dirty), _dirtyRows(ct._dirtyRows) {}
+
+  uint size() const { return _nrow;}
+  uint ncol() const { return (uint) _schema.size();}
+  uint nrow() const { return _nrow;}
+  uint position() const { return _position;}
+  const Schema& schema() const { return _schema;}
+  //(1 based) as for getX
+  const RdbColumn& column(const uint index) const {
+    check_index(index);
+    return _columns[index - 1];
+  }
+
+  void insert(const std::vector<std::string>& row);
+  //append the rows of a batch with the columns of this table
+  void append(const RdbBatch& batch);
+
+  //as for StrRowRdbTable, concurrent scans should use a cursor()
+  ColumnRdbTable const* next() const {
+    if (++_position > _nrow) { return nullptr;}
+    return this;
+  }
+  RdbCursor<ColumnRdbTable> cursor() const { return RdbCursor<ColumnRdbTable>(*this);}
+
+  //the next n rows at most, as spans over the columns of the table
+  RdbBatch nextBatch(const uint n) const {
+    const uint first = std::min(_position, _nrow);
+    const uint count = std::min(n, _nrow - first);
+    _position = first + count;
+    return batch(first, count);
+  }
+  //n rows from the (0 based) row first
+  RdbBatch batch(const uint first, const uint n) const {
+    if (_encoded) return decodedBatch(first, n);
+    return encodedBatch(first, n);
+  }
+  //n rows, the values of the encoded columns left as they are
+  RdbBatch encodedBatch(const uint first, const uint n) const {
+    RdbBatch b;
+    b.nrow = n;
+    for (const auto& c: _columns) b.columns.push_back(c.span(first, n));
+    return b;
+  }
+  //the n (0 based) rows at indexes
+  RdbBatch gather(const uint* indexes, const uint n) const;
+
+  std::string getString(const uint index) const {
+    return getString(_position - 1, index);
+  }
+  double getDouble(const uint index) const {
+    return getDouble(_position - 1, index);
+  }
+  int getInt(const uint index) const {
+    return getInt(_position - 1, index);
+  }
+  uint getUInt(const uint index) const {
+    return getUInt(_position - 1, index);
+  }
+
+  //the field at (1 based) index of the (0 based) row
+  std::string getString(const uint row, const uint index) const {
+    return column(index).getString(row);
+  }
+  double getDouble(const uint row, const uint index) const {
+    return column(index).getDouble(row);
+  }
+  int getInt(const uint row, const uint index) const {
+    return column(index).getInt(row);
+  }
+  uint getUInt(const uint row, const uint index) const {
+    return column(index).getUInt(row);
+  }
+
+  //store each column in the encoding that takes the fewest bytes for its values
+  void encode();
+  //(1 based) as for getX
+  ColumnEncoding encoding(const uint index) const { return column(index).encoding();}
+
+  void check_index(const uint index) const {
+    if (index == 0 or index > ncol())
+      throw std::invalid_argument (
+          "requested column " +
+          DataType::convert<std::string, uint>(index) +
+          " is not in a table of " +
+          DataType::convert<std::string, uint>(ncol()) + " columns");
+  }
+
+ protected:
+  RdbBatch decodedBatch(const uint first, const uint n) const;
+  std::size_t encodedColumns() const;
+  //after n rows were inserted, with encoded columns encoded before
+  void inserted(const std::size_t encoded, const uint n);
+
+  Schema _schema;
+  std::vector<RdbColumn> _columns;
+  uint _nrow = 0;
+  mutable uint _position = 0; //1 past the end
+  //whether a column is encoded
+  bool _encoded = false;
+  //whether an insert decoded a column, and the rows inserted since
+  bool _dirty = false;
+  uint _dirtyRows = 0;
+};
+
+//how an index finds rows: a hash index those with a value,
+//a sorted one also those with values in a range
+enum class IndexKind { Hash, Sorted };
+
+//the (0 based) rows of a table by their key in one of its columns.
+//a hash index keeps the rows of each key, in order; a sorted one keeps
+//keys and rows sorted in an array, with the keys inserted last in a small
+//sorted array of their own, merged into the other one once it gets too large,
+//so that inserting a row does not move the whole index.
+template <typename K>
+class RdbKeyIndex {
+public:
+  using Entry = std::pair<K, uint>;
+
+  explicit RdbKeyIndex(const IndexKind kind = IndexKind::Hash) : _kind(kind) {}
+
+  IndexKind kind() const { return _kind;}
+
+  void insert(std::vector<Entry> entries) {
+    //NaN is equal to nothing, and would not sort
+    if constexpr (std::is_floating_point<K>::value)
+      entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                   [] (const Entry& e) { return e.first != e.first;}),
+                    entries.end());
+    if (_kind == IndexKind::Hash) {
+      for (const auto& e: entries) _hashed[e.first].push_back(e.second);
+      return;
+    }
+    if (entries.size() > RecentEntries) {
+      std::sort(entries.begin(), entries.end());
+      merge(_recent);
+      merge(entries);
+      _recent.clear();
+      return;
+    }
+    for (const auto& e: entries)
+      _recent.insert(std::upper_bound(_recent.begin(), _recent.end(), e), e);
+    //at most as many as the square root of the size of the index
+    if (_recent.size() > RecentEntries and _recent.size() * _recent.size() > _sorted.size()) {
+      merge(_recent);
+      _recent.clear();
+    }
+  }
+
+  //the rows with the key, in order
+  std::vector<uint> equal(const K& key) const {
+    if (_kind == IndexKind::Hash) {
+      const auto found = _hashed.find(key);
+      return found == _hashed.end() ? std::vector<uint>() : found->second;
+    }
+    return range(key, true, key, true);
+  }
+
+  //the rows with keys from low to high, in order, with no bound
+  //on a side without one. a hash index cannot find them.
+  std::vector<uint> range(const std::optional<K>& low, const bool lowIncluded,
+                          const std::optional<K>& high, const bool highIncluded) const {
+    if (_kind == IndexKind::Hash)
+      throw std::invalid_argument("a hash index cannot find the rows of a range of keys");
+    std::vector<uint> rows;
+    for (const auto* entries: {&_sorted, &_recent}) {
+      const auto first = not low ? entries->begin() :
+        std::lower_bound(entries->begin(), entries->end(), *low,
+                         [lowIncluded] (const Entry& e, const K& x) {
+                           return lowIncluded ? e.first < x : e.first <= x;
+                         });
+      const auto last = not high ? entries->end() :
+        std::lower_bound(first, entries->end(), *high,
+                         [highIncluded] (const Entry& e, const K& x) {
+                           return highIncluded ? e.first <= x : e.first < x;
+                         });
+      for (auto e = first; e < last; ++e) rows.push_back(e->second);
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+  }
+
+private:
+  static constexpr std::size_t RecentEntries = 64;
+
+  void merge(const std::vector<Entry>& entries) {
+    std::vector<Entry> merged;
+    merged.reserve(_sorted.size() + entries.size());
+    std::merge(_sorted.begin(), _sorted.end(), entries.begin(), entries.end(),
+               std::back_inserter(merged));
+    _sorted.swap(merged);
+  }
+
+  IndexKind _kind;
+  std::unordered_map< K, std::vector<uint> > _hashed;
+  std::vector<Entry> _sorted;
+  std::vector<Entry> _recent;
+};
+
+//an index of a column of a table, by number for a column of numbers,
+//by string for a column of strings
+class RdbIndex {
+public:
+  RdbIndex(const IndexKind kind, const ColumnType type) :
+    _type(type), _numbers(kind), _strings(kind) {}
+
+  IndexKind kind() const { return _numbers.kind();}
+  ColumnType type() const { return _type;}
+  bool text() const { return _type == ColumnType::String;}
+
+  //the values of a column of a batch, those of the rows from first on
+  void insert(const RdbColumnSpan& values, const uint first);
+
+  std::vector<uint> equal(const double x) const { return _numbers.equal(x);}
+  std::vector<uint> equal(const std::string& x) const { return _strings.equal(x);}
+  std::vector<uint> range(const std::optional<double>& low, const bool lowIncluded,
+                          const std::optional<double>& high, const bool highIncluded) const {
+    return _numbers.range(low, lowIncluded, high, highIncluded);
+  }
+  std::vector<uint> range(const std::optional<std::string>& low, const bool lowIncluded,
+                          const std::optional<std::string>& high, const bool highIncluded) const {
+    return _strings.range(low, lowIncluded, high, highIncluded);
+  }
+
+private:
+  ColumnType _type;
+  RdbKeyIndex<double> _numbers;
+  RdbKeyIndex<std::string> _strings;
+};
+
+//the zone map of a column of a table (see zonemap.h),
+//of numbers for a column of numbers, of strings for a column of strings
+class RdbZoneMap {
+public:
+  RdbZoneMap(const ColumnType type, const std::size_t blockRows) :
+    _type(type), _numbers(blockRows), _strings(blockRows) {}
+
+  ColumnType type() const { return _type;}
+  bool text() const { return _type == ColumnType::String;}
+  std::size_t blockRows() const { return _numbers.blockRows();}
+  //how many blocks the rows of the column take
+  std::size_t size() const { return text() ? _strings.size() : _numbers.size();}
+
+  //the values of a column of a batch, those of its next rows
+  void insert(const RdbColumnSpan& values);
+
+  const ZoneMap<double>& numbers() const { return _numbers;}
+  const ZoneMap<std::string>& strings() const { return _strings;}
+  bool mayHold(const std::size_t block,
+               const std::optional<double>& low, const bool lowIncluded,
+               const std::optional<double>& high, const bool highIncluded) const {
+    return _numbers.mayHold(block, low, lowIncluded, high, highIncluded);
+  }
+  bool mayHold(const std::size_t block,
+               const std::optional<std::string>& low, const bool lowIncluded,
+               const std::optional<std::string>& high, const bool highIncluded) const {
+    return _strings.mayHold(block, low, lowIncluded, high, highIncluded);
+  }
+
+private:
+  ColumnType _type;
+  ZoneMap<double> _numbers;
+  ZoneMap<std::string> _strings;
+};
+
+//the tables of a database, with a zone map of each of their columns,
+//in blocks of zoneRows rows, that queries skip the blocks of filters with
 class DbSim {
 public:
-  DbSim() = default;
+  explicit DbSim(const std::size_t zoneRows = defaultZoneRows) : _zoneRows(zoneRows) {}
 
   void insert(const std::string& name, const StrRowRdbTable& t) {
-    _tables.insert(std::make_pair(name, t));
+    if (_tables.insert(std::make_pair(name, t)).second) mapZones(name);
   }
   StrRowRdbTable const* table(const std::string& name) const {return &(_tables.at(name));}
+
+  //its columns encoded, as they are loaded
+  void insert(const std::string& name, const ColumnRdbTable& t) {
+    const auto inserted = _columnTables.insert(std::make_pair(name, t));
+    if (not inserted.second) return;
+    inserted.first->second.encode();
+    mapZones(name);
+  }
+  ColumnRdbTable const* columnTable(const std::string& name) const {
+    return &(_columnTables.at(name));
+  }
+  bool hasTable(const std::string& name) const { return _tables.count(name) != 0;}
+  bool hasColumnTable(const std::string& name) const {
+    return _columnTables.count(name) != 0;
+  }
+  //independent scans of a table
+  RdbCursor<StrRowRdbTable> cursor(const std::string& name) const {
+    return table(name)->cursor();
+  }
+  RdbCursor<ColumnRdbTable> columnCursor(const std::string& name) const {
+    return columnTable(name)->cursor();
+  }
+
+  //an index of the (1 based) column of a table, that queries use to find
+  //the rows of predicates on the column instead of scanning the table.
+  //it replaces the index the column had.
+  void createIndex(const std::string& table, const uint column, const IndexKind kind);
+  //the index of a column, null when it has none
+  const RdbIndex* index(const std::string& table, const uint column) const;
+  //append a row to a table, and to its indexes and zone maps
+  void insertRow(const std::string& table, const std::vector<std::string>& row);
+
+  //the zone map of the (1 based) column of a table, null when there is none
+  const RdbZoneMap* zoneMap(const std::string& table, const uint column) const;
+
 private:
+  //n rows of a table, of either kind, from the (0 based) row first
+  RdbBatch batch(const std::string& table, const uint first, const uint n) const;
+  //the zone maps of the columns of a table just inserted
+  void mapZones(const std::string& table);
+
   std::map<std::string, StrRowRdbTable> _tables;
+  std::map<std::string, ColumnRdbTable> _columnTables;
+  //by table, then by column
+  std::map< std::string, std::map<uint, RdbIndex> > _indexes;
+  std::size_t _zoneRows;
+  //by table, then by (0 based) column
+  std::map< std::string, std::vector<RdbZoneMap> > _zones;
 };
 
 class DbQuerySim;
@@ -309,6 +846,10 @@ DbQueryClassSim(DbconnSim const& conn) : _conn(conn) {}
   StrRowRdbTable const* execute() const {
     return _conn->table(_tableName);
   }
+  //a scan of the result of its own, as a result set would be
+  RdbCursor<StrRowRdbTable> cursor() const {
+    return execute()->cursor();
+  }
  private:
   std::string _tableName;
   //StrRowRdbTable const* _ptrTable = nullptr;
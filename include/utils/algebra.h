@@ -0,0 +1,183 @@
+// Vectorized version of the algebra of real-valued functions in category.h
+// Add, Subtract, Multiply and Compose build lambdas that are applied
+//one value at a time. Here the same operators build expression templates,
+//that are evaluated over whole arrays (std::vector, DataFrame columns),
+//a block at a time. Each node runs a plain loop over the block,
+//and calls the functions it wraps directly, not through a pointer,
+//so that the compiler can inline and vectorize them.
+
+#pragma once
+#include "category.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+namespace category
+{
+namespace vectorized
+{
+// doubles evaluated at once: a block, and the temporaries of a node, fit in L1
+constexpr std::size_t Block = 512;
+
+template <typename E>
+using is_expression = std::is_base_of<Vectorized, E>;
+
+// The argument, x -> x
+struct Argument : Vectorized
+{
+  double operator()(double x) const { return x; }
+
+  void eval(const double* x, double* y, std::size_t n) const
+  {
+    std::copy(x, x + n, y);
+  }
+};
+
+const Argument arg{};
+
+struct Constant : Vectorized
+{
+  double c;
+
+  double operator()(double) const { return c; }
+
+  void eval(const double*, double* y, std::size_t n) const
+  {
+    for (std::size_t i = 0; i != n; ++i) y[i] = c;
+  }
+};
+
+// A scalar function, such as a lambda from category.h
+template <typename F>
+struct Lifted : Vectorized
+{
+  F f;
+
+  double operator()(double x) const { return f(x); }
+
+  void eval(const double* x, double* y, std::size_t n) const
+  {
+    for (std::size_t i = 0; i != n; ++i) y[i] = f(x[i]);
+  }
+};
+
+template <typename Op, typename L, typename R>
+struct Binary : Vectorized
+{
+  L l;
+  R r;
+
+  double operator()(double x) const { return Op()(l(x), r(x)); }
+
+  // y may be x
+  void eval(const double* x, double* y, std::size_t n) const
+  {
+    alignas(64) double u[Block];
+    alignas(64) double v[Block];
+    l.eval(x, u, n);
+    r.eval(x, v, n);
+    const Op op;
+    for (std::size_t i = 0; i != n; ++i) y[i] = op(u[i], v[i]);
+  }
+};
+
+// g after f, as Compose(f, g)
+template <typename F, typename G>
+struct Composed : Vectorized
+{
+  F f;
+  G g;
+
+  double operator()(double x) const { return g(f(x)); }
+
+  void eval(const double* x, double* y, std::size_t n) const
+  {
+    alignas(64) double u[Block];
+    f.eval(x, u, n);
+    g.eval(u, y, n);
+  }
+};
+
+template <typename F>
+Lifted<F> lift(F f)
+{
+  return Lifted<F>{{}, f};
+}
+
+// Operands of the operators: expressions stay as they are,
+//numbers become constants, and anything else is a function to lift
+template <typename E>
+auto expression(const E& e)
+{
+  if constexpr (is_expression<E>::value) return e;
+  else if constexpr (std::is_arithmetic<E>::value) return Constant{{}, (double) e};
+  else return lift(e);
+}
+
+template <typename E>
+using expression_t = decltype(expression(std::declval<E>()));
+
+template <typename L, typename R>
+using Mixed = std::enable_if_t<
+  is_expression<L>::value or is_expression<R>::value
+  >;
+
+template <typename L, typename R, typename = Mixed<L, R> >
+auto operator + (const L& l, const R& r)
+{
+  return Binary<std::plus<double>, expression_t<L>, expression_t<R> >{
+    {}, expression(l), expression(r)};
+}
+
+template <typename L, typename R, typename = Mixed<L, R> >
+auto operator - (const L& l, const R& r)
+{
+  return Binary<std::minus<double>, expression_t<L>, expression_t<R> >{
+    {}, expression(l), expression(r)};
+}
+
+template <typename L, typename R, typename = Mixed<L, R> >
+auto operator * (const L& l, const R& r)
+{
+  return Binary<std::multiplies<double>, expression_t<L>, expression_t<R> >{
+    {}, expression(l), expression(r)};
+}
+
+// g ^ f is g after f, as in category.h
+template <typename G, typename F, typename = Mixed<G, F> >
+auto operator ^ (const G& g, const F& f)
+{
+  return Composed<expression_t<F>, expression_t<G> >{{}, expression(f), expression(g)};
+}
+
+// y[i] = e(x[i]) for the n values of x, y may be x
+template <typename E>
+void evaluate(const E& e, const double* x, double* y, std::size_t n)
+{
+  for (std::size_t b = 0; b < n; b += Block)
+    e.eval(x + b, y + b, std::min(Block, n - b));
+}
+
+// e over a column, of doubles or of any other arithmetic type
+template <typename E, typename T>
+std::vector<double> evaluate(const E& e, const std::vector<T>& xs)
+{
+  static_assert(is_expression<E>::value, "evaluate needs a vectorized expression");
+  std::vector<double> ys(xs.size());
+  if constexpr (std::is_same<T, double>::value) {
+    evaluate(e, xs.data(), ys.data(), xs.size());
+  } else {
+    alignas(64) double u[Block];
+    for (std::size_t b = 0; b < xs.size(); b += Block) {
+      const std::size_t n = std::min(Block, xs.size() - b);
+      for (std::size_t i = 0; i != n; ++i) u[i] = (double) xs[b + i];
+      e.eval(u, ys.data() + b, n);
+    }
+  }
+  return ys;
+}
+
+} // end namespace vectorized
+} // end namespace category
@@ -1,6 +1,10 @@
+#pragma once
 #include <iostream>
+#include "curry.h"
+#include "pipeline.h"
+#include <type_traits>
 
-// compile and test with "g++ -std=c++14 -o category category.cpp && ./category"
+// compile and test with "g++ -std=c++17 -o category category.cpp && ./category"
 // Lists as implemented here can be printed in reverse order,
 //depending on the compiler. This is because
 //the order of pack expansion is not defined by the standard.
@@ -15,58 +19,68 @@ namespace category
 //containg only list types and morphisms between lists.
 
 // Identity morphism
-auto Id = [] (auto x) { return x; };
+inline auto Id = [] (auto x) { return x; };
 
 // Define algebra of real-valued functions
-auto Add = [] (auto f, auto g)
+inline auto Add = [] (auto f, auto g)
 {
   return [=] (auto x) { return f(x) + g(x); };
 };
 
-auto Subtract = [] (auto f, auto g)
+inline auto Subtract = [] (auto f, auto g)
 {
   return [=] (auto x) { return f(x) - g(x); };
 };
 
-auto Multiply = [] (auto f, auto g)
+inline auto Multiply = [] (auto f, auto g)
 {
   return [=] (auto x) { return f(x) * g(x); };
 };
 
 // Compose two morphisms if possible
-auto Compose = [] (auto f, auto g)
+inline auto Compose = [] (auto f, auto g)
 {
   return [=] (auto x) { return g(f(x)); };
 };
 
-// Overloads
+// Expressions of the vectorized algebra in algebra.h
+//derive from Vectorized, and have operators of their own
+struct Vectorized {};
+
 template <typename F, typename G>
+using Scalar = std::enable_if_t<
+  not std::is_base_of<Vectorized, F>::value and
+  not std::is_base_of<Vectorized, G>::value
+  >;
+
+// Overloads
+template <typename F, typename G, typename = Scalar<F, G> >
 auto operator + (F f, G g)
 {
   return Add(f,g);
 }
 
-template <typename F, typename G>
+template <typename F, typename G, typename = Scalar<F, G> >
 auto operator - (F f, G g)
 {
-  return Substract(f,g);
+  return Subtract(f,g);
 }
 
-template <typename F, typename G>
+template <typename F, typename G, typename = Scalar<F, G> >
 auto operator * (F f, G g)
 {
   return Multiply(f,g);
 }
 
 // Overload compose with ^
-template <typename F, typename G>
+template <typename F, typename G, typename = Scalar<F, G> >
 auto operator ^ (G g, F f)
 {
   return Compose(f,g);
 }
 
 //recursive lambda factorial
-auto lambda_factorial = [] (int n)
+inline auto lambda_factorial = [] (int n)
 {
   auto f = [] (int n, auto lambda) -> int
   {
@@ -76,7 +90,7 @@ auto lambda_factorial = [] (int n)
 };
 
 // Factorial "without" recursion
-auto fact = [] (auto f)
+inline auto fact = [] (auto f)
 {
   return [f] (int n) -> int
   {
@@ -85,32 +99,26 @@ auto fact = [] (auto f)
 };
 
 // Some kind of Y combinator
+//(memo_fix in memoize.h is one that works, and memoizes)
 #if 0
-auto Y = [] (auto f)
+inline auto Y = [] (auto f)
   {
     return f([f] (int n) -> int { return Y(f)(n); });
   };
 #endif
 
 // Simple wrapper for a double for currying
-auto Double = [] (auto x)
+inline auto Double = [] (auto x)
 {
   return [=] (auto f) { return f(x); };
 };
 
-// Currying
-auto curry = [] (auto f)
-{
-  return [f] (auto x)
-  {
-    return [=] (auto y) { return f(x,y); };
-  };
-};
+// Currying, of functions of any number of arguments, is in curry.h
 
 // Wrapper around a parameter pack
 // returns a lambda that expects a lambda,
 //to be be mapped over the list
-auto List = [] (auto... elements)
+inline auto List = [] (auto... elements)
 {
   return [=] (auto f) { return f(elements...); };
 };
@@ -119,7 +127,7 @@ auto List = [] (auto... elements)
 // Return a lambda that expects a lambda-list,
 //and have the same return type as List
 // This is needed in order to chain operations
-auto fmap = [] (auto f)
+inline auto fmap = [] (auto f)
 {
   return [f] (auto list)
   {
@@ -132,19 +140,26 @@ auto fmap = [] (auto f)
 };
 
 // Overload fmap for haskell-style notations
-template <typename F, typename L>
+//(on containers, > builds a Pipeline, see pipeline.h)
+template <
+  typename F,
+  typename L,
+  typename = std::enable_if_t<
+    not is_range<L>::value and not std::is_base_of<Pipelined, L>::value
+    >
+  >
 auto operator > (L l, F f)
 {
   return fmap(f)(l);
 }
 
 // We can have monads by combining unit (return in haskell) and bind
-auto unit = [] (auto x)
+inline auto unit = [] (auto x)
 {
   return [=] () { return x; };
 };
 
-auto bind = [] (auto u)
+inline auto bind = [] (auto u)
 {
   return [=] (auto callback)
   {
@@ -160,7 +175,7 @@ auto operator >= (Element x, F f)
 }
 
 // generic lambda that returns the size of a parameter pack
-auto pack_size = [] (auto ...elements)
+inline auto pack_size = [] (auto ...elements)
 {
   return sizeof...(elements);
 };
@@ -0,0 +1,346 @@
+//a persistent sequence that stores its elements in chunks.
+//traversals stream through contiguous memory,
+//instead of chasing a pointer per element as a cons list does.
+
+#pragma once
+#include "util.h"
+#include <algorithm>
+#include <memory>
+#include <iterator>
+#include <initializer_list>
+
+namespace Monadic {
+
+//a Chunked sequence is a spine of spans into shared chunks
+//of at most N elements. chunks are copied on write: a version that
+//owns its last chunk appends in place, a version that shares it
+//copies (at most N elements) first.
+//concatenation and slicing share the chunks, and copy only the spine.
+//a relaxed radix balanced tree would concat and slice in O(log n);
+//a flat spine does it in O(n / N), without a copy of any element.
+template<typename T, std::size_t N = 32>
+class Chunked
+{
+	static_assert(N >= 16 and N <= 64, "a chunk should hold 16 to 64 elements");
+
+	using Chunk = std::vector<T>;
+	using ChunkPtr = std::shared_ptr<Chunk>;
+
+	struct Span
+	{
+		ChunkPtr chunk;
+		std::size_t offset;
+		std::size_t length;
+
+		const T* data() const { return chunk->data() + offset;}
+	};
+
+	struct Spine
+	{
+		std::vector<Span> spans;
+		std::vector<std::size_t> ends; //number of elements upto each span
+	};
+
+public:
+	using type = T;
+	using value_type = T;
+	using size_type = std::size_t;
+	static constexpr size_type chunk_size = N;
+
+	class const_iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		const_iterator() = default;
+		const_iterator(const Spine* spine, const size_type s) :
+			_spine(spine),
+			_span(s),
+			_pos(0)
+		{}
+
+		reference operator*() const { return _spine->spans[_span].data()[_pos];}
+		pointer operator->() const { return _spine->spans[_span].data() + _pos;}
+		const_iterator& operator++()
+		{
+			if (++_pos == _spine->spans[_span].length) {
+				++_span;
+				_pos = 0;
+			}
+			return *this;
+		}
+		const_iterator operator++(int)
+		{
+			const_iterator it = *this;
+			++(*this);
+			return it;
+		}
+		bool operator==(const const_iterator& that) const
+		{
+			return _span == that._span and _pos == that._pos;
+		}
+		bool operator!=(const const_iterator& that) const { return not (*this == that);}
+	private:
+		const Spine* _spine = nullptr;
+		size_type _span = 0;
+		size_type _pos = 0;
+	};
+	using iterator = const_iterator;
+
+	Chunked() = default;
+
+	Chunked(std::initializer_list<T> ts) :
+		Chunked(std::begin(ts), std::end(ts))
+	{}
+
+	template<
+		typename It,
+		typename = typename std::iterator_traits<It>::value_type
+	>
+	Chunked(It first, It last)
+	{
+		for (; first != last; ++first) push_back(*first);
+	}
+
+	bool empty() const { return size() == 0;}
+	size_type size() const { return _spine ? _spine->ends.back() : 0;}
+	size_type nchunks() const { return _spine ? _spine->spans.size() : 0;}
+
+	const T& operator[](const size_type i) const
+	{
+		const auto& ends = _spine->ends;
+		const size_type s = (size_type) (
+			std::upper_bound(std::begin(ends), std::end(ends), i) - std::begin(ends)
+		);
+		return _spine->spans[s].data()[i - (s == 0 ? 0 : ends[s - 1])];
+	}
+	const T& at(const size_type i) const
+	{
+		if (i >= size()) throw std::out_of_range("index past the end of a Chunked");
+		return (*this)[i];
+	}
+
+	const_iterator begin() const { return const_iterator(_spine.get(), 0);}
+	const_iterator end() const { return const_iterator(_spine.get(), nchunks());}
+
+	//visit the contiguous spans of elements, f(const T* xs, size_type n)
+	template<typename F>
+	void for_each_span(const F& f) const
+	{
+		if (not _spine) return;
+		for (const auto& s : _spine->spans) f(s.data(), s.length);
+	}
+
+	//modifiers write only to what this version owns
+	void push_back(const T& t) { tip().push_back(t); grow(1);}
+	void push_back(T&& t) { tip().push_back(std::move(t)); grow(1);}
+
+	//and their persistent counterparts leave this version as it is
+	Chunked<T, N> pushed_back(const T& t) const
+	{
+		Chunked<T, N> that(*this);
+		that.push_back(t);
+		return that;
+	}
+
+	Chunked<T, N> slice(size_type from, size_type to) const
+	{
+		to = std::min(to, size());
+		Chunked<T, N> that;
+		if (from >= to) return that;
+		const auto& ends = _spine->ends;
+		size_type s = (size_type) (
+			std::upper_bound(std::begin(ends), std::end(ends), from) - std::begin(ends)
+		);
+		size_type start = s == 0 ? 0 : ends[s - 1];
+		for (; start < to; start = ends[s++]) {
+			const Span& span = _spine->spans[s];
+			const size_type b = std::max(from, start) - start;
+			const size_type e = std::min(to - start, span.length);
+			that.appendSpan(Span{span.chunk, span.offset + b, e - b});
+		}
+		return that;
+	}
+
+	//append the chunks of that, shared and not copied
+	void append(const Chunked<T, N>& that)
+	{
+		//hold on to that's spine, which may be our own
+		const auto spine = that._spine;
+		if (not spine) return;
+		for (const auto& s : spine->spans) appendSpan(s);
+	}
+
+	//a chunk filled by f(T* xs), with n elements
+	template<typename F>
+	void append_chunk(const size_type n, const F& f)
+	{
+		auto chunk = std::make_shared<Chunk>(n);
+		f(chunk->data());
+		appendSpan(Span{chunk, 0, n});
+	}
+
+private:
+	Spine& spine()
+	{
+		if (not _spine) _spine = std::make_shared<Spine>();
+		else if (_spine.use_count() > 1) _spine = std::make_shared<Spine>(*_spine);
+		return *_spine;
+	}
+
+	//the chunk to push into, which this version should own
+	Chunk& tip()
+	{
+		Spine& sp = spine();
+		if (not sp.spans.empty()) {
+			Span& last = sp.spans.back();
+			const bool full = last.length == N;
+			const bool atEnd = last.offset + last.length == last.chunk->size();
+			if (not full and last.chunk.use_count() == 1 and atEnd)
+				return *last.chunk;
+			if (not full) {
+				auto copy = std::make_shared<Chunk>();
+				copy->reserve(N);
+				copy->insert(std::end(*copy), last.data(), last.data() + last.length);
+				last = Span{copy, 0, last.length};
+				return *copy;
+			}
+		}
+		auto chunk = std::make_shared<Chunk>();
+		chunk->reserve(N);
+		sp.spans.push_back(Span{chunk, 0, 0});
+		sp.ends.push_back(sp.ends.empty() ? 0 : sp.ends.back());
+		return *chunk;
+	}
+
+	void grow(const size_type n)
+	{
+		_spine->spans.back().length += n;
+		_spine->ends.back() += n;
+	}
+
+	//a span is appended in place to the last chunk, when this version owns
+	//it and it has room. two small spans that meet otherwise are merged
+	//into a copy, that this version then owns, to keep chunks well filled
+	void appendSpan(const Span& span)
+	{
+		if (span.length == 0) return;
+		Spine& sp = spine();
+		if (not sp.spans.empty()) {
+			Span& last = sp.spans.back();
+			const bool atEnd = last.offset + last.length == last.chunk->size();
+			if (last.chunk.use_count() == 1 and atEnd and last.chunk != span.chunk and
+			    last.length + span.length <= N) {
+				last.chunk->insert(std::end(*last.chunk), span.data(), span.data() + span.length);
+				last.length += span.length;
+				sp.ends.back() += span.length;
+				return;
+			}
+		}
+		if (not sp.spans.empty() and sp.spans.back().length + span.length <= N / 2) {
+			Span& last = sp.spans.back();
+			auto merged = std::make_shared<Chunk>();
+			merged->reserve(N);
+			merged->insert(std::end(*merged), last.data(), last.data() + last.length);
+			merged->insert(std::end(*merged), span.data(), span.data() + span.length);
+			last = Span{merged, 0, merged->size()};
+			sp.ends.back() += span.length;
+			return;
+		}
+		sp.spans.push_back(span);
+		sp.ends.push_back((sp.ends.empty() ? 0 : sp.ends.back()) + span.length);
+	}
+
+	std::shared_ptr<Spine> _spine;
+};
+
+template<typename T, std::size_t N>
+Chunked<T, N> concat(const Chunked<T, N>& first, const Chunked<T, N>& second)
+{
+	Chunked<T, N> that(first);
+	that.append(second);
+	return that;
+}
+
+template<typename T, std::size_t N>
+bool operator==(const Chunked<T, N>& xs, const Chunked<T, N>& ys)
+{
+	if (xs.size() != ys.size()) return false;
+	return std::equal(std::begin(xs), std::end(xs), std::begin(ys));
+}
+
+//the monadic functions map chunk to chunk,
+//each chunk a loop over contiguous elements
+template<
+	typename T,
+	std::size_t N,
+	typename F,
+	typename S = typename std::result_of<F&(T)>::type
+>
+inline Chunked<S, N> map(const F f, const Chunked<T, N>& ts)
+{
+	Chunked<S, N> ss;
+	ts.for_each_span([&] (const T* xs, const std::size_t n) {
+			ss.append_chunk(n, [&] (S* ys) {
+					for (std::size_t i = 0; i != n; ++i) ys[i] = f(xs[i]);
+				}
+			);
+		}
+	);
+	return ss;
+}
+
+template<typename T, std::size_t N, typename P>
+inline Chunked<T, N> filter(const P& pred, const Chunked<T, N>& ts)
+{
+	Chunked<T, N> fs;
+	ts.for_each_span([&] (const T* xs, const std::size_t n) {
+			for (std::size_t i = 0; i != n; ++i)
+				if (pred(xs[i])) fs.push_back(xs[i]);
+		}
+	);
+	return fs;
+}
+
+template<typename T, std::size_t N, typename S, typename F>
+inline S foldl(const F& f, S s, const Chunked<T, N>& ts)
+{
+	ts.for_each_span([&] (const T* xs, const std::size_t n) {
+			for (std::size_t i = 0; i != n; ++i) s = f(s, xs[i]);
+		}
+	);
+	return s;
+}
+
+//flatten shares the chunks of the inner sequences
+template<typename T, std::size_t N>
+inline Chunked<T, N> flatten(const Chunked< Chunked<T, N>, N >& tss)
+{
+	Chunked<T, N> ts;
+	for (const auto& xs : tss) ts.append(xs);
+	return ts;
+}
+
+//bind
+template<
+	typename T,
+	std::size_t N,
+	typename F,
+	typename CS = typename std::result_of<F&(T)>::type,
+	typename S = typename CS::value_type
+>
+inline Chunked<S, N> operator >>= (const Chunked<T, N>& ts, const F& f)
+{
+	Chunked<S, N> ss;
+	ts.for_each_span([&] (const T* xs, const std::size_t n) {
+			for (std::size_t i = 0; i != n; ++i) ss.append(f(xs[i]));
+		}
+	);
+	return ss;
+}
+
+} /* namespace Monadic */
@@ -0,0 +1,221 @@
+// Currying and partial application, for functions of any number of arguments
+// curry(f) collects arguments over as many calls as it takes,
+//and calls f once it has all of them: curry(f)(1)(2, 3) is f(1, 2, 3).
+//The number of arguments is read from the signature of f when it has one;
+//a generic lambda is called as soon as it can be called with what was
+//collected, and curry<N>(f) sets the number for functions with
+//default or variadic arguments.
+// partial(f, x, _2, _1) binds some arguments, and leaves placeholders
+//for the others: partial(f, x, _2, _1)(y, z) is f(x, z, y).
+// Arguments are kept by value in a tuple inside the returned object,
+//with no allocation, and forwarded to f.
+
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace category
+{
+
+// The signature of a function that is not generic
+template <typename F, typename = void>
+struct signature {};
+
+template <typename F>
+struct signature<F, std::void_t<decltype(&F::operator())> >
+  : signature<decltype(&F::operator())> {};
+
+template <typename R, typename... A>
+struct signature<R (*)(A...)> { using type = R(A...); };
+
+template <typename C, typename R, typename... A>
+struct signature<R (C::*)(A...)> { using type = R(A...); };
+
+template <typename C, typename R, typename... A>
+struct signature<R (C::*)(A...) const> { using type = R(A...); };
+
+template <typename S>
+struct count_arguments;
+
+template <typename R, typename... A>
+struct count_arguments<R(A...)> : std::integral_constant<int, sizeof...(A)> {};
+
+// the number of arguments of F, or -1 when F is generic
+template <typename F, typename = void>
+struct arity : std::integral_constant<int, -1> {};
+
+template <typename F>
+struct arity<F, std::void_t<typename signature<F>::type> >
+  : count_arguments<typename signature<F>::type> {};
+
+template <int N, typename F, typename... Bound>
+class Curried
+{
+public:
+  Curried(F f, std::tuple<Bound...> bound) :
+    _f(std::move(f)),
+    _bound(std::move(bound))
+  {}
+
+  template <typename... Xs>
+  decltype(auto) operator()(Xs&&... xs) const &
+  {
+    return call(_f, _bound, std::forward<Xs>(xs)...);
+  }
+
+  // a curried function used once moves its arguments on
+  template <typename... Xs>
+  decltype(auto) operator()(Xs&&... xs) &&
+  {
+    return call(std::move(_f), std::move(_bound), std::forward<Xs>(xs)...);
+  }
+
+private:
+  template <typename G, typename Tuple, typename... Xs>
+  static decltype(auto) call(G&& f, Tuple&& bound, Xs&&... xs)
+  {
+    constexpr int collected = (int) (sizeof...(Bound) + sizeof...(Xs));
+    static_assert(N < 0 or collected <= N, "too many arguments for a curried function");
+    constexpr bool complete = N < 0 ?
+      std::is_invocable<const F&, const Bound&..., Xs&&...>::value :
+      collected == N;
+
+    if constexpr (complete) {
+      return std::apply(
+        [&f, &xs...] (auto&&... b) -> decltype(auto) {
+          return std::invoke(
+            std::forward<G>(f),
+            std::forward<decltype(b)>(b)...,
+            std::forward<Xs>(xs)...);
+        },
+        std::forward<Tuple>(bound));
+    } else {
+      return Curried<N, F, Bound..., std::decay_t<Xs>...>(
+        std::forward<G>(f),
+        std::tuple_cat(
+          std::forward<Tuple>(bound),
+          std::tuple<std::decay_t<Xs>...>(std::forward<Xs>(xs)...)));
+    }
+  }
+
+  F _f;
+  std::tuple<Bound...> _bound;
+};
+
+template <int N, typename F>
+Curried<N, std::decay_t<F>> curry(F&& f)
+{
+  return Curried<N, std::decay_t<F>>(std::forward<F>(f), std::tuple<>());
+}
+
+template <typename F>
+auto curry(F&& f)
+{
+  return curry<arity<std::decay_t<F>>::value>(std::forward<F>(f));
+}
+
+// Placeholders for partial, that std::bind understands as well
+template <int I>
+struct Placeholder {};
+
+inline constexpr Placeholder<1> _1 {};
+inline constexpr Placeholder<2> _2 {};
+inline constexpr Placeholder<3> _3 {};
+inline constexpr Placeholder<4> _4 {};
+
+} // end namespace category
+
+namespace std
+{
+template <int I>
+struct is_placeholder<category::Placeholder<I> > : integral_constant<int, I> {};
+}
+
+namespace category
+{
+
+// the largest placeholder among Xs
+template <typename... Xs>
+constexpr int placeholders()
+{
+  int n = 0;
+  ((n = std::max(n, std::is_placeholder<std::decay_t<Xs> >::value)), ...);
+  return n;
+}
+
+// Arguments of the call that no placeholder asks for are passed
+//after the bound ones, so partial(f, x) is f with x as its first argument
+template <typename F, typename... Bound>
+class Partial
+{
+public:
+  Partial(F f, std::tuple<Bound...> bound) :
+    _f(std::move(f)),
+    _bound(std::move(bound))
+  {}
+
+  template <typename... Xs>
+  decltype(auto) operator()(Xs&&... xs) const &
+  {
+    return call(_f, _bound, std::forward_as_tuple(std::forward<Xs>(xs)...));
+  }
+
+  template <typename... Xs>
+  decltype(auto) operator()(Xs&&... xs) &&
+  {
+    return call(std::move(_f), std::move(_bound), std::forward_as_tuple(std::forward<Xs>(xs)...));
+  }
+
+private:
+  static constexpr int Used = placeholders<Bound...>();
+
+  // the I-th bound argument, or the call argument it stands for
+  template <std::size_t I, typename Tuple, typename Calls>
+  static decltype(auto) pick(Tuple&& bound, Calls& calls)
+  {
+    constexpr int k = std::is_placeholder<
+      std::decay_t<std::tuple_element_t<I, std::tuple<Bound...> > >
+      >::value;
+    if constexpr (k > 0) return std::get<k - 1>(std::move(calls));
+    else return std::get<I>(std::forward<Tuple>(bound));
+  }
+
+  // calls holds references to the arguments of the call
+  template <typename G, typename Tuple, typename Calls>
+  static decltype(auto) call(G&& f, Tuple&& bound, Calls calls)
+  {
+    constexpr std::size_t n = std::tuple_size<Calls>::value;
+    static_assert((int) n >= Used, "missing arguments for the placeholders");
+    return call(
+      std::forward<G>(f), std::forward<Tuple>(bound), calls,
+      std::index_sequence_for<Bound...>(),
+      std::make_index_sequence<n - Used>());
+  }
+
+  template <typename G, typename Tuple, typename Calls, std::size_t... I, std::size_t... J>
+  static decltype(auto) call(
+    G&& f, Tuple&& bound, Calls& calls,
+    std::index_sequence<I...>, std::index_sequence<J...>)
+  {
+    return std::invoke(
+      std::forward<G>(f),
+      pick<I>(std::forward<Tuple>(bound), calls)...,
+      std::get<Used + J>(std::move(calls))...);
+  }
+
+  F _f;
+  std::tuple<Bound...> _bound;
+};
+
+template <typename F, typename... Xs>
+Partial<std::decay_t<F>, std::decay_t<Xs>...> partial(F&& f, Xs&&... xs)
+{
+  return Partial<std::decay_t<F>, std::decay_t<Xs>...>(
+    std::forward<F>(f),
+    std::tuple<std::decay_t<Xs>...>(std::forward<Xs>(xs)...));
+}
+
+} // end namespace category
@@ -0,0 +1,197 @@
+//sorting records by key, more of them than fit in memory:
+//
+//  ExternalSort sort(64 << 20);
+//  for (...) {
+//    std::string key;
+//    appendSortKey(key, price, true);
+//    appendSortKey(key, name);
+//    sort.add(std::move(key), row);
+//  }
+//  for (const SortRecord* r = sort.next(); r; r = sort.next()) ...
+//
+//keys compare as strings of bytes, and appendSortKey encodes numbers and
+//strings, ascending or descending, so that they compare as their values do.
+//records are kept in memory up to the budget. they are then sorted, in one
+//chunk for each thread of the pool, and the chunks are merged with a loser
+//tree into a run, written to a temporary file. the runs, and the records
+//still in memory, are merged the same way as they are read back.
+//records with the same key come out in the order they were added in.
+
+#pragma once
+#include "threadpool.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+//append x to a key, as bytes that compare (unsigned, one after the other)
+//as x does with other values of its type, or the other way round when descending
+template <typename T>
+void appendSortKey(std::string& key, const T& x, const bool descending = false)
+{
+  const unsigned char flip = descending ? 0xff : 0;
+  if constexpr (std::is_convertible<const T&, std::string_view>::value) {
+    //a 0 is followed by 0xff, and the string ends with two 0s,
+    //so that a string comes before those it is a prefix of
+    for (const char c: std::string_view(x)) {
+      key.push_back((char) ((unsigned char) c ^ flip));
+      if (c == 0) key.push_back((char) (0xff ^ flip));
+    }
+    key.push_back((char) flip);
+    key.push_back((char) flip);
+  } else {
+    static_assert(std::is_arithmetic<T>::value, "a sort key is a number or a string");
+    //the bits of the value, with its sign flipped so that they compare unsigned
+    uint64_t bits = 0;
+    std::size_t size = sizeof(T);
+    if constexpr (std::is_floating_point<T>::value) {
+      const double d = x == 0 ? 0.0 : (double) x;
+      std::memcpy(&bits, &d, sizeof(d));
+      bits = bits >> 63 ? ~bits : bits | (uint64_t(1) << 63);
+      size = sizeof(double);
+    } else if constexpr (std::is_signed<T>::value) {
+      bits = (uint64_t) (std::make_unsigned_t<T>) x ^ (uint64_t(1) << (8 * sizeof(T) - 1));
+    } else {
+      bits = (uint64_t) x;
+    }
+    //most significant byte first
+    for (std::size_t i = size; i != 0; --i)
+      key.push_back((char) ((unsigned char) (bits >> (8 * (i - 1))) ^ flip));
+  }
+}
+
+//a merge of k sorted sources: top() is the source with the first of their
+//current records, before(a, b) when the current record of source a comes
+//before that of source b. a source that moved on to its next record, or that
+//is over, takes its place again with replay.
+//of records that compare equal, that of the source with the lower index comes first.
+template <typename Before>
+class LoserTree
+{
+public:
+  static constexpr std::size_t None = std::numeric_limits<std::size_t>::max();
+
+  //k sources, none of them over
+  LoserTree(const std::size_t k, Before before) :
+    _k(k), _before(std::move(before)), _done(k, false), _tree(std::max<std::size_t>(k, 1), None)
+  {
+    if (k == 0) return;
+    //source i is the leaf at k + i, node n the match between 2n and 2n + 1:
+    //it keeps the loser, and passes the winner up
+    std::vector<std::size_t> winner(k);
+    const auto at = [&] (const std::size_t p) { return p >= k ? p - k : winner[p];};
+    for (std::size_t n = k - 1; n >= 1; --n) {
+      const std::size_t a = at(2 * n);
+      const std::size_t b = at(2 * n + 1);
+      winner[n] = beats(a, b) ? a : b;
+      _tree[n] = beats(a, b) ? b : a;
+    }
+    _tree[0] = k == 1 ? 0 : winner[1];
+  }
+
+  std::size_t top() const
+  {
+    return _k == 0 or _done[_tree[0]] ? None : _tree[0];
+  }
+
+  //the top source has moved on, or is over when done
+  void replay(const bool done)
+  {
+    std::size_t w = _tree[0];
+    _done[w] = done;
+    for (std::size_t p = (w + _k) / 2; p >= 1; p /= 2)
+      if (beats(_tree[p], w)) std::swap(_tree[p], w);
+    _tree[0] = w;
+  }
+
+private:
+  bool beats(const std::size_t a, const std::size_t b) const
+  {
+    if (_done[a] or _done[b]) return _done[a] == _done[b] ? a < b : _done[b];
+    if (_before(a, b)) return true;
+    return not _before(b, a) and a < b;
+  }
+
+  std::size_t _k;
+  Before _before;
+  std::vector<bool> _done;
+  std::vector<std::size_t> _tree;
+};
+
+struct SortRecord
+{
+  std::string key;
+  std::string payload;
+};
+
+//the bytes of records a sort keeps in memory, unless it is given a budget
+const std::size_t defaultSortBudget = std::size_t(256) << 20;
+
+class ExternalSort
+{
+public:
+  explicit ExternalSort(const std::size_t budget = defaultSortBudget,
+                        ThreadPool& pool = ThreadPool::shared());
+
+  ExternalSort(const ExternalSort&) = delete;
+  ExternalSort& operator=(const ExternalSort&) = delete;
+
+  void add(std::string key, std::string payload);
+
+  //the records in order, one at a time, and null after the last one.
+  //a record is there until the next call. once it has been called,
+  //no more records can be added.
+  const SortRecord* next();
+
+  //how many records were added
+  std::size_t size() const { return _size;}
+  //how many runs were written to temporary files
+  std::size_t spilled() const { return _files.size();}
+
+private:
+  //sorted records, in memory from position on,
+  //or in a file, of which the record read last is head
+  struct Run
+  {
+    std::vector<SortRecord> records;
+    std::size_t position = 0;
+    std::shared_ptr<std::FILE> file;
+    SortRecord head;
+
+    const SortRecord& current() const { return file ? head : records[position];}
+    //false once it is over
+    bool advance();
+  };
+
+  struct RunsBefore
+  {
+    const std::vector<Run>* runs;
+    bool operator()(const std::size_t a, const std::size_t b) const
+    {
+      return (*runs)[a].current().key < (*runs)[b].current().key;
+    }
+  };
+
+  //the buffered records, in sorted runs of their own
+  std::vector<Run> sortBuffer();
+  //the buffered records into a run of a temporary file
+  void spill();
+
+  std::size_t _budget;
+  ThreadPool* _pool;
+  std::size_t _size = 0;
+  std::vector<SortRecord> _buffer;
+  std::size_t _buffered = 0;
+  std::vector< std::shared_ptr<std::FILE> > _files;
+
+  //the merge, once next has been called
+  bool _merging = false;
+  std::vector<Run> _runs;
+  std::optional< LoserTree<RunsBefore> > _tree;
+};
@@ -0,0 +1,171 @@
+//formatting into a single growable buffer.
+//numbers are written with std::to_chars, and the buffer goes out
+//to a stream, or a file descriptor, in large blocks.
+//a write to a file descriptor that fails throws a std::system_error,
+//with what was not written still in the buffer.
+
+#pragma once
+#include <cerrno>
+#include <charconv>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
+
+namespace Format {
+
+//what goes around and between the elements of a range or a tuple
+struct Separators
+{
+	std::string_view open;
+	std::string_view between;
+	std::string_view close;
+};
+
+const Separators listSeparators {"", ", ", ""};
+const Separators tupleSeparators {"(", ",", ")"};
+
+class TextBuilder
+{
+public:
+	static constexpr std::size_t defaultBlock = 1 << 16;
+
+	//a builder without a sink keeps everything, see str()
+	TextBuilder() = default;
+	explicit TextBuilder(std::ostream& out, const std::size_t block = defaultBlock) :
+		_out(&out),
+		_block(block)
+	{
+		_buffer.reserve(block + block / 8);
+	}
+	explicit TextBuilder(const int fd, const std::size_t block = defaultBlock) :
+		_fd(fd),
+		_block(block)
+	{
+		_buffer.reserve(block + block / 8);
+	}
+	TextBuilder(const TextBuilder&) = delete;
+	TextBuilder& operator=(const TextBuilder&) = delete;
+
+	//what is left is written, but a failure cannot be reported from here:
+	//flush first to know about it
+	~TextBuilder()
+	{
+		try {
+			flush();
+		} catch (const std::system_error&) {
+		}
+	}
+
+	const std::string& str() const { return _buffer;}
+	std::size_t size() const { return _buffer.size();}
+
+	void flush()
+	{
+		if (_out) {
+			_out->write(_buffer.data(), (std::streamsize) _buffer.size());
+			_buffer.clear();
+		} else if (_fd >= 0) {
+			std::size_t written = 0;
+			while (written != _buffer.size()) {
+				const ssize_t w = ::write(_fd, _buffer.data() + written, _buffer.size() - written);
+				if (w < 0 and errno == EINTR) continue;
+				if (w <= 0) {
+					const int error = w < 0 ? errno : EIO;
+					_buffer.erase(0, written);
+					throw std::system_error(error, std::generic_category(), "TextBuilder could not write");
+				}
+				written += (std::size_t) w;
+			}
+			_buffer.clear();
+		}
+	}
+
+	TextBuilder& put(const char c)
+	{
+		_buffer.push_back(c);
+		return spill();
+	}
+	TextBuilder& put(const std::string_view s)
+	{
+		_buffer.append(s.data(), s.size());
+		return spill();
+	}
+	TextBuilder& put(const char* s) { return put(std::string_view(s));}
+	TextBuilder& put(const std::string& s) { return put(std::string_view(s));}
+	TextBuilder& put(const bool b) { return put(b ? '1' : '0');}
+
+	template<
+		typename X,
+		typename = std::enable_if_t<std::is_arithmetic<X>::value>
+	>
+	TextBuilder& put(const X x)
+	{
+		char digits[64];
+		const auto r = std::to_chars(digits, digits + sizeof(digits), x);
+		_buffer.append(digits, (std::size_t) (r.ptr - digits));
+		return spill();
+	}
+
+	template<typename... Xs>
+	TextBuilder& put(const std::tuple<Xs...>& xs, const Separators& s = tupleSeparators)
+	{
+		put(s.open);
+		putElements(xs, s.between, std::index_sequence_for<Xs...>());
+		return put(s.close);
+	}
+
+	template<typename X, typename Y>
+	TextBuilder& put(const std::pair<X, Y>& xy, const Separators& s = tupleSeparators)
+	{
+		return put(s.open).put(xy.first).put(s.between).put(xy.second).put(s.close);
+	}
+
+	//anything a range-for can walk, without a recursive call per element
+	template<typename Range>
+	TextBuilder& range(const Range& xs, const Separators& s = listSeparators)
+	{
+		put(s.open);
+		bool first = true;
+		for (const auto& x : xs) {
+			if (not first) put(s.between);
+			put(x);
+			first = false;
+		}
+		return put(s.close);
+	}
+
+	//the rows of a DataFrame or a TupleFrame, one per line
+	template<typename Frame>
+	TextBuilder& rows(Frame& frame, const Separators& fields = {"", "\t", "\n"})
+	{
+		for (uint32_t i = 0; i != frame.nrow(); ++i) put(frame[i], fields);
+		return *this;
+	}
+
+	template<typename X>
+	TextBuilder& operator<<(const X& x) { return put(x);}
+
+private:
+	template<typename Tuple, std::size_t... I>
+	void putElements(const Tuple& xs, const std::string_view between, std::index_sequence<I...>)
+	{
+		((I == 0 ? *this : put(between)).put(std::get<I>(xs)), ...);
+	}
+
+	TextBuilder& spill()
+	{
+		if ((_out or _fd >= 0) and _buffer.size() >= _block) flush();
+		return *this;
+	}
+
+	std::string _buffer;
+	std::ostream* _out = nullptr;
+	int _fd = -1;
+	std::size_t _block = defaultBlock;
+};
+
+} /* namespace Format */
@@ -0,0 +1,321 @@
+//grouped aggregation: the rows of a table grouped by a key, with the count,
+//sum, min, max and average of values over the rows of each group.
+//
+//  const auto groups = groupRows<int>(n, 1,
+//    [&] (std::size_t i) { return keys[i];},
+//    [&] (std::size_t, std::size_t i) { return values[i];});
+//
+//rows are split in chunks, one for each thread of the pool, and each chunk
+//is grouped into a table of its own, without locks. the tables are then
+//merged, in the order of the chunks, so that groups come in the order of
+//their first row, whatever the number of threads.
+//integer keys that fall in a small range are counted straight into an array
+//indexed by the key; other keys go into an open addressing hash table.
+
+#pragma once
+#include "threadpool.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+enum class AggregateOp { Count, Sum, Min, Max, Avg };
+
+//the count, sum, min and max of values.
+//over no values, sum is 0, and min, max and avg are NaN.
+struct Accumulator
+{
+  uint64_t count = 0;
+  double sum = 0;
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+
+  void add(const double x)
+  {
+    ++count;
+    sum += x;
+    min = std::min(min, x);
+    max = std::max(max, x);
+  }
+
+  //x, times over
+  void add(const double x, const uint64_t times)
+  {
+    if (times == 0) return;
+    count += times;
+    sum += x * (double) times;
+    min = std::min(min, x);
+    max = std::max(max, x);
+  }
+
+  void merge(const Accumulator& that)
+  {
+    count += that.count;
+    sum += that.sum;
+    min = std::min(min, that.min);
+    max = std::max(max, that.max);
+  }
+
+  double value(const AggregateOp op) const
+  {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    switch (op) {
+    case AggregateOp::Count: return (double) count;
+    case AggregateOp::Sum: return sum;
+    case AggregateOp::Min: return count == 0 ? nan : min;
+    case AggregateOp::Max: return count == 0 ? nan : max;
+    case AggregateOp::Avg: return count == 0 ? nan : sum / (double) count;
+    }
+    return nan;
+  }
+};
+
+//from keys to group numbers, given from 0 in the order the keys come in.
+//a slot holds the number of a group and the high bits of the hash
+//of its key, so that most slots are passed over without looking at keys.
+template <typename K, typename Hash = std::hash<K> >
+class GroupTable
+{
+public:
+  static constexpr uint32_t None = std::numeric_limits<uint32_t>::max();
+
+  explicit GroupTable(std::size_t capacity = 16)
+  {
+    std::size_t n = 16;
+    while (n < 2 * capacity) n <<= 1;
+    _slots.assign(n, Slot{0, None});
+  }
+
+  //the group of a key, a new one if it has none yet
+  uint32_t insert(const K& key)
+  {
+    const uint64_t h = hash(key);
+    std::size_t mask = _slots.size() - 1;
+    for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+      Slot& s = _slots[i];
+      if (s.group == None) {
+        const uint32_t g = (uint32_t) _keys.size();
+        s = Slot{(uint32_t) (h >> 32), g};
+        _keys.push_back(key);
+        _hashes.push_back(h);
+        if (2 * _keys.size() > _slots.size()) grow();
+        return g;
+      }
+      if (s.tag == (uint32_t) (h >> 32) and _keys[s.group] == key) return s.group;
+    }
+  }
+
+  std::size_t size() const { return _keys.size();}
+  const std::vector<K>& keys() const { return _keys;}
+
+  static uint64_t hash(const K& key)
+  {
+    uint64_t h = (uint64_t) Hash()(key);
+    //std::hash of an integer is the integer itself: the finalizer of murmur3 mixes its bits
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+private:
+  struct Slot
+  {
+    uint32_t tag;
+    uint32_t group;
+  };
+
+  void grow()
+  {
+    std::vector<Slot> slots(2 * _slots.size(), Slot{0, None});
+    const std::size_t mask = slots.size() - 1;
+    for (uint32_t g = 0; g != _keys.size(); ++g) {
+      std::size_t i = _hashes[g] & mask;
+      while (slots[i].group != None) i = (i + 1) & mask;
+      slots[i] = Slot{(uint32_t) (_hashes[g] >> 32), g};
+    }
+    _slots.swap(slots);
+  }
+
+  std::vector<Slot> _slots;
+  std::vector<K> _keys;
+  std::vector<uint64_t> _hashes;
+};
+
+//the groups of rows: the key of each group, its first row,
+//and its accumulators, those of group g from g * naggregates on
+template <typename K>
+struct Groups
+{
+  std::size_t naggregates = 0;
+  std::vector<K> keys;
+  std::vector<std::size_t> first;
+  std::vector<Accumulator> accumulators;
+
+  std::size_t size() const { return keys.size();}
+  const Accumulator& at(const std::size_t g, const std::size_t j) const
+  {
+    return accumulators[g * naggregates + j];
+  }
+};
+
+//integer keys within this many values of each other are indexed directly
+const std::size_t directGroupKeys = 1 << 16;
+//the fewest rows worth a chunk of their own
+const std::size_t groupChunkRows = 1 << 14;
+
+//rows [0, n) in chunks, and f(c, first, last) for each chunk c, in parallel
+template <typename F>
+std::size_t forGroupChunks(const std::size_t n, ThreadPool& pool, const F& f)
+{
+  const std::size_t nchunks = std::max<std::size_t>(
+    1, std::min<std::size_t>(pool.size() + 1, n / groupChunkRows));
+  const std::size_t length = (n + nchunks - 1) / nchunks;
+  pool.parallelFor(nchunks, [&] (const std::size_t c) {
+      f(c, std::min(n, c * length), std::min(n, (c + 1) * length));
+    });
+  return nchunks;
+}
+
+template <typename K, typename KeyOf, typename ValueOf>
+Groups<K> groupRowsHashed(
+  const std::size_t n, const std::size_t naggregates,
+  const KeyOf& key, const ValueOf& value, ThreadPool& pool)
+{
+  struct Partial
+  {
+    GroupTable<K> table;
+    std::vector<std::size_t> first;
+    std::vector<Accumulator> accumulators;
+  };
+  std::vector<Partial> partials(pool.size() + 1);
+  const std::size_t nchunks = forGroupChunks(n, pool,
+    [&] (const std::size_t c, const std::size_t begin, const std::size_t end) {
+      Partial& p = partials[c];
+      for (std::size_t i = begin; i != end; ++i) {
+        const uint32_t g = p.table.insert(key(i));
+        if (g == p.first.size()) {
+          p.first.push_back(i);
+          p.accumulators.resize(p.accumulators.size() + naggregates);
+        }
+        for (std::size_t j = 0; j != naggregates; ++j)
+          p.accumulators[g * naggregates + j].add(value(j, i));
+      }
+    });
+
+  Groups<K> groups;
+  groups.naggregates = naggregates;
+  GroupTable<K> merged(partials[0].table.size());
+  for (std::size_t c = 0; c != nchunks; ++c) {
+    const Partial& p = partials[c];
+    for (std::size_t h = 0; h != p.table.size(); ++h) {
+      const uint32_t g = merged.insert(p.table.keys()[h]);
+      if (g == groups.first.size()) {
+        groups.first.push_back(p.first[h]);
+        groups.accumulators.resize(groups.accumulators.size() + naggregates);
+      }
+      for (std::size_t j = 0; j != naggregates; ++j)
+        groups.accumulators[g * naggregates + j].merge(p.accumulators[h * naggregates + j]);
+    }
+  }
+  groups.keys = merged.keys();
+  return groups;
+}
+
+//k - low, that does not overflow when K is signed
+template <typename K>
+std::size_t keyOffset(const K k, const K low)
+{
+  using U = std::make_unsigned_t<K>;
+  return (std::size_t) (U) ((U) k - (U) low);
+}
+
+//keys from low to low + range - 1, each its own index
+template <typename K, typename KeyOf, typename ValueOf>
+Groups<K> groupRowsDirect(
+  const std::size_t n, const std::size_t naggregates,
+  const KeyOf& key, const ValueOf& value, const K low, const std::size_t range,
+  ThreadPool& pool)
+{
+  const std::size_t none = std::numeric_limits<std::size_t>::max();
+  struct Partial
+  {
+    std::vector<std::size_t> first;
+    std::vector<Accumulator> accumulators;
+  };
+  std::vector<Partial> partials(pool.size() + 1);
+  const std::size_t nchunks = forGroupChunks(n, pool,
+    [&] (const std::size_t c, const std::size_t begin, const std::size_t end) {
+      Partial& p = partials[c];
+      p.first.assign(range, none);
+      p.accumulators.resize(range * naggregates);
+      for (std::size_t i = begin; i != end; ++i) {
+        const std::size_t k = keyOffset(key(i), low);
+        if (p.first[k] == none) p.first[k] = i;
+        for (std::size_t j = 0; j != naggregates; ++j)
+          p.accumulators[k * naggregates + j].add(value(j, i));
+      }
+    });
+
+  //the chunks merged index by index, the groups then put in order
+  Partial& all = partials[0];
+  for (std::size_t c = 1; c != nchunks; ++c) {
+    const Partial& p = partials[c];
+    for (std::size_t k = 0; k != range; ++k) {
+      if (p.first[k] == none) continue;
+      if (all.first[k] == none) all.first[k] = p.first[k];
+      for (std::size_t j = 0; j != naggregates; ++j)
+        all.accumulators[k * naggregates + j].merge(p.accumulators[k * naggregates + j]);
+    }
+  }
+  std::vector<std::size_t> present;
+  for (std::size_t k = 0; k != range; ++k)
+    if (all.first[k] != none) present.push_back(k);
+  std::sort(present.begin(), present.end(), [&all] (const std::size_t a, const std::size_t b) {
+      return all.first[a] < all.first[b];
+    });
+
+  Groups<K> groups;
+  groups.naggregates = naggregates;
+  for (const std::size_t k : present) {
+    groups.keys.push_back((K) ((std::make_unsigned_t<K>) low + k));
+    groups.first.push_back(all.first[k]);
+    groups.accumulators.insert(
+      groups.accumulators.end(),
+      all.accumulators.begin() + k * naggregates,
+      all.accumulators.begin() + (k + 1) * naggregates);
+  }
+  return groups;
+}
+
+//the n rows grouped by key(i), with value(j, i) accumulated into
+//aggregate j of the group of row i, for j in [0, naggregates)
+template <typename K, typename KeyOf, typename ValueOf>
+Groups<K> groupRows(
+  const std::size_t n, const std::size_t naggregates,
+  const KeyOf& key, const ValueOf& value,
+  ThreadPool& pool = ThreadPool::shared())
+{
+  if constexpr (std::is_integral<K>::value and not std::is_same<K, bool>::value) {
+    if (n != 0) {
+      K low = key(0);
+      K high = low;
+      for (std::size_t i = 1; i != n; ++i) {
+        const K k = key(i);
+        low = std::min(low, k);
+        high = std::max(high, k);
+      }
+      //with no more slots than rows, so that sparse keys still hash
+      const std::size_t spread = keyOffset(high, low);
+      const std::size_t range = spread + 1;
+      if (spread < directGroupKeys and range <= std::max<std::size_t>(n, 1024))
+        return groupRowsDirect<K>(n, naggregates, key, value, low, range, pool);
+    }
+  }
+  return groupRowsHashed<K>(n, naggregates, key, value, pool);
+}
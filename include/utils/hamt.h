@@ -0,0 +1,650 @@
+//a persistent hash array mapped trie.
+//insert and erase return a new version of the map, that shares
+//all but the path to the changed entry with the old one.
+
+#pragma once
+#include "list.h"
+#include <functional>
+
+namespace Persistent {
+
+//a map from K to V. each level of the trie uses 5 bits of the hash,
+//so lookups, inserts and erases visit O(log32 n) nodes.
+//nodes and entries are reference counted, and come from pools:
+//a node is sized to the power of two that holds its slots.
+//a Transient edits the nodes it has created in place,
+//for fast bulk builds, and hands them over as a persistent map.
+template<
+	typename K,
+	typename V,
+	typename Hash = std::hash<K>,
+	typename Eq = std::equal_to<K>
+>
+class HashMap
+{
+public:
+	//entries with the same hash are chained
+	struct Entry
+	{
+		Entry(const std::size_t h, const K& k, const V& v, const Entry* n) :
+			hash(h),
+			key(k),
+			value(v),
+			next(n),
+			refs(1)
+		{}
+
+		const std::size_t hash;
+		const K key;
+		const V value;
+		const Entry* next;
+		mutable std::atomic<uint32_t> refs;
+
+		static void* operator new(std::size_t) { return NodePool<Entry>::allocate();}
+		static void operator delete(void* p) { NodePool<Entry>::deallocate(p);}
+	};
+
+private:
+	static constexpr unsigned bits = 5;
+	static constexpr unsigned mask = (1U << bits) - 1;
+
+	//a slot points to an entry (tagged with the low bit) or a node
+	using Slot = std::uintptr_t;
+
+	struct Node
+	{
+		Node(const uint32_t b, const uint8_t n, const uint8_t c, const uint64_t e) :
+			refs(1),
+			bitmap(b),
+			edit(e),
+			count(n),
+			capacity(c)
+		{}
+
+		Slot* slots() { return reinterpret_cast<Slot*>(this + 1);}
+		const Slot* slots() const { return reinterpret_cast<const Slot*>(this + 1);}
+
+		mutable std::atomic<uint32_t> refs;
+		uint32_t bitmap;
+		uint64_t edit; //the transient that may edit this node in place
+		uint8_t count;
+		uint8_t capacity;
+	};
+	static_assert(sizeof(Node) % alignof(Slot) == 0, "slots follow a node");
+
+	template<std::size_t Cap>
+	struct NodeBytes
+	{
+		alignas(Node) unsigned char bytes[sizeof(Node) + Cap * sizeof(Slot)];
+	};
+
+	static bool isEntry(const Slot s) { return s & 1U;}
+	static const Entry* entryOf(const Slot s) { return reinterpret_cast<const Entry*>(s & ~Slot(1));}
+	static Node* nodeOf(const Slot s) { return reinterpret_cast<Node*>(s);}
+	static Slot slotOf(const Entry* e) { return reinterpret_cast<Slot>(e) | 1U;}
+	static Slot slotOf(const Node* n) { return reinterpret_cast<Slot>(n);}
+
+	static unsigned index(const std::size_t h, const unsigned shift) { return (unsigned) (h >> shift) & mask;}
+	static unsigned position(const uint32_t bitmap, const uint32_t bit)
+	{
+		return (unsigned) __builtin_popcount(bitmap & (bit - 1));
+	}
+
+	//reference counting
+	static void retain(const Entry* e) { if (e) e->refs.fetch_add(1, std::memory_order_relaxed);}
+	static void retain(const Node* n) { n->refs.fetch_add(1, std::memory_order_relaxed);}
+	static void retain(const Slot s)
+	{
+		if (isEntry(s)) retain(entryOf(s)); else retain(nodeOf(s));
+	}
+	static void release(const Entry* e)
+	{
+		while (e and e->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			const Entry* n = e->next;
+			delete e;
+			e = n;
+		}
+	}
+	static void release(Node* n)
+	{
+		if (not n or n->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+		for (unsigned i = 0; i != n->count; ++i) release(n->slots()[i]);
+		const uint8_t capacity = n->capacity;
+		n->~Node();
+		deallocate(n, capacity);
+	}
+	static void release(const Slot s)
+	{
+		if (isEntry(s)) release(entryOf(s)); else release(nodeOf(s));
+	}
+
+	//node allocation, by size class
+	static uint8_t capacityFor(const unsigned n)
+	{
+		uint8_t c = 2;
+		while (c < n and c < 32) c = (uint8_t) (2 * c);
+		return c;
+	}
+	static void* allocate(const uint8_t capacity)
+	{
+		switch (capacity) {
+		case 2: return NodePool< NodeBytes<2> >::allocate();
+		case 4: return NodePool< NodeBytes<4> >::allocate();
+		case 8: return NodePool< NodeBytes<8> >::allocate();
+		case 16: return NodePool< NodeBytes<16> >::allocate();
+		default: return NodePool< NodeBytes<32> >::allocate();
+		}
+	}
+	static void deallocate(void* p, const uint8_t capacity)
+	{
+		switch (capacity) {
+		case 2: return NodePool< NodeBytes<2> >::deallocate(p);
+		case 4: return NodePool< NodeBytes<4> >::deallocate(p);
+		case 8: return NodePool< NodeBytes<8> >::deallocate(p);
+		case 16: return NodePool< NodeBytes<16> >::deallocate(p);
+		default: return NodePool< NodeBytes<32> >::deallocate(p);
+		}
+	}
+	static Node* makeNode(const uint32_t bitmap, const unsigned count, const uint64_t edit)
+	{
+		//a transient's nodes get room to grow
+		const uint8_t capacity = capacityFor(edit ? count + 1 : count);
+		return new (allocate(capacity)) Node(bitmap, (uint8_t) count, capacity, edit);
+	}
+
+	static bool editable(const Node* n, const uint64_t edit) { return edit != 0 and n->edit == edit;}
+
+	//the functions below return a new reference to the node that
+	//should replace node in its parent, which is node itself when
+	//it was edited in place.
+
+	//takes over the reference to s
+	static Node* insertSlot(
+		Node* node, const uint32_t bit, const unsigned pos, const Slot s, const uint64_t edit
+	)
+	{
+		Slot* from = node->slots();
+		if (editable(node, edit) and node->count < node->capacity) {
+			std::copy_backward(from + pos, from + node->count, from + node->count + 1);
+			from[pos] = s;
+			node->bitmap |= bit;
+			++node->count;
+			retain(node);
+			return node;
+		}
+		Node* n = makeNode(node->bitmap | bit, node->count + 1U, edit);
+		Slot* to = n->slots();
+		for (unsigned i = 0; i != pos; ++i) retain(to[i] = from[i]);
+		to[pos] = s;
+		for (unsigned i = pos; i != node->count; ++i) retain(to[i + 1] = from[i]);
+		return n;
+	}
+
+	//takes over the reference to s
+	static Node* replaceSlot(Node* node, const unsigned pos, const Slot s, const uint64_t edit)
+	{
+		if (editable(node, edit)) {
+			release(node->slots()[pos]);
+			node->slots()[pos] = s;
+			retain(node);
+			return node;
+		}
+		Node* n = makeNode(node->bitmap, node->count, edit);
+		for (unsigned i = 0; i != node->count; ++i)
+			if (i != pos) retain(n->slots()[i] = node->slots()[i]);
+		n->slots()[pos] = s;
+		return n;
+	}
+
+	static Node* removeSlot(Node* node, const uint32_t bit, const unsigned pos, const uint64_t edit)
+	{
+		if (node->count == 1) return nullptr;
+		Slot* from = node->slots();
+		if (editable(node, edit)) {
+			release(from[pos]);
+			std::copy(from + pos + 1, from + node->count, from + pos);
+			node->bitmap &= ~bit;
+			--node->count;
+			retain(node);
+			return node;
+		}
+		Node* n = makeNode(node->bitmap & ~bit, node->count - 1U, edit);
+		Slot* to = n->slots();
+		for (unsigned i = 0; i != pos; ++i) retain(to[i] = from[i]);
+		for (unsigned i = pos + 1; i != node->count; ++i) retain(to[i - 1] = from[i]);
+		return n;
+	}
+
+	//a node for two entries (references taken over) that differ in hash
+	static Node* merge(const Entry* e1, const Entry* e2, const unsigned shift, const uint64_t edit)
+	{
+		const unsigned i1 = index(e1->hash, shift);
+		const unsigned i2 = index(e2->hash, shift);
+		if (i1 == i2) {
+			Node* n = makeNode(1U << i1, 1, edit);
+			n->slots()[0] = slotOf(merge(e1, e2, shift + bits, edit));
+			return n;
+		}
+		Node* n = makeNode((1U << i1) | (1U << i2), 2, edit);
+		n->slots()[i1 < i2 ? 0 : 1] = slotOf(e1);
+		n->slots()[i1 < i2 ? 1 : 0] = slotOf(e2);
+		return n;
+	}
+
+	//a chain with k bound to v
+	static const Entry* chainInsert(
+		const Entry* chain, const std::size_t h, const K& k, const V& v, bool& added
+	)
+	{
+		const Entry* found = chain;
+		while (found and not Eq()(found->key, k)) found = found->next;
+		if (not found) {
+			added = true;
+			retain(chain);
+			return new Entry(h, k, v, chain);
+		}
+		retain(found->next);
+		const Entry* rest = new Entry(h, k, v, found->next);
+		return copyUpto(chain, found, rest);
+	}
+
+	//a chain without k, nullptr when nothing is left
+	static const Entry* chainErase(const Entry* chain, const K& k, bool& removed)
+	{
+		const Entry* found = chain;
+		while (found and not Eq()(found->key, k)) found = found->next;
+		if (not found) {
+			retain(chain);
+			return chain;
+		}
+		removed = true;
+		retain(found->next);
+		return copyUpto(chain, found, found->next);
+	}
+
+	//copies of the entries of chain before upto, followed by rest
+	static const Entry* copyUpto(const Entry* chain, const Entry* upto, const Entry* rest)
+	{
+		if (chain == upto) return rest;
+		return new Entry(chain->hash, chain->key, chain->value, copyUpto(chain->next, upto, rest));
+	}
+
+	static Node* insert(
+		Node* node, const std::size_t h, const K& k, const V& v,
+		const unsigned shift, const uint64_t edit, bool& added
+	)
+	{
+		const uint32_t bit = 1U << index(h, shift);
+		const unsigned pos = position(node->bitmap, bit);
+		if (not (node->bitmap & bit)) {
+			added = true;
+			return insertSlot(node, bit, pos, slotOf(new Entry(h, k, v, nullptr)), edit);
+		}
+		const Slot s = node->slots()[pos];
+		if (not isEntry(s))
+			return replaceSlot(node, pos, slotOf(insert(nodeOf(s), h, k, v, shift + bits, edit, added)), edit);
+		const Entry* e = entryOf(s);
+		if (e->hash == h)
+			return replaceSlot(node, pos, slotOf(chainInsert(e, h, k, v, added)), edit);
+		added = true;
+		retain(e);
+		Node* n = merge(e, new Entry(h, k, v, nullptr), shift + bits, edit);
+		return replaceSlot(node, pos, slotOf(n), edit);
+	}
+
+	static Node* erase(
+		Node* node, const std::size_t h, const K& k,
+		const unsigned shift, const uint64_t edit, bool& removed
+	)
+	{
+		const uint32_t bit = 1U << index(h, shift);
+		const unsigned pos = position(node->bitmap, bit);
+		const Slot s = (node->bitmap & bit) ? node->slots()[pos] : 0;
+		if (not s or (isEntry(s) and entryOf(s)->hash != h)) {
+			retain(node);
+			return node;
+		}
+		if (isEntry(s)) {
+			const Entry* chain = chainErase(entryOf(s), k, removed);
+			if (not removed) {
+				release(chain);
+				retain(node);
+				return node;
+			}
+			if (not chain) return removeSlot(node, bit, pos, edit);
+			return replaceSlot(node, pos, slotOf(chain), edit);
+		}
+		Node* child = erase(nodeOf(s), h, k, shift + bits, edit, removed);
+		if (not removed) {
+			release(child);
+			retain(node);
+			return node;
+		}
+		if (not child) return removeSlot(node, bit, pos, edit);
+		//a lone entry moves up
+		if (child->count == 1 and isEntry(child->slots()[0])) {
+			const Slot e = child->slots()[0];
+			retain(e);
+			release(child);
+			return replaceSlot(node, pos, e, edit);
+		}
+		return replaceSlot(node, pos, slotOf(child), edit);
+	}
+
+	static const Entry* find(const Node* node, const std::size_t h, const K& k)
+	{
+		for (unsigned shift = 0; node; shift += bits) {
+			const uint32_t bit = 1U << index(h, shift);
+			if (not (node->bitmap & bit)) return nullptr;
+			const Slot s = node->slots()[position(node->bitmap, bit)];
+			if (not isEntry(s)) {
+				node = nodeOf(s);
+				continue;
+			}
+			for (const Entry* e = entryOf(s); e; e = e->next)
+				if (e->hash == h and Eq()(e->key, k)) return e;
+			return nullptr;
+		}
+		return nullptr;
+	}
+
+	static uint64_t newEdit()
+	{
+		static std::atomic<uint64_t> edits {0};
+		return ++edits;
+	}
+
+	//takes over the reference to root
+	HashMap(Node* root, const std::size_t size) :
+		_root(root),
+		_size(size)
+	{}
+
+public:
+	using key_type = K;
+	using mapped_type = V;
+	using value_type = Entry;
+	using size_type = std::size_t;
+
+	class const_iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Entry;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Entry*;
+		using reference = const Entry&;
+
+		const_iterator() = default;
+		explicit const_iterator(const Node* root)
+		{
+			if (not root) return;
+			_stack[_depth++] = Frame{root, 0};
+			settle();
+		}
+
+		reference operator*() const { return *_entry;}
+		pointer operator->() const { return _entry;}
+		const_iterator& operator++()
+		{
+			if (_entry->next) {
+				_entry = _entry->next;
+				return *this;
+			}
+			++_stack[_depth - 1].pos;
+			settle();
+			return *this;
+		}
+		bool operator==(const const_iterator& that) const { return _entry == that._entry;}
+		bool operator!=(const const_iterator& that) const { return _entry != that._entry;}
+
+	private:
+		//walk down to the next entry, or up when a node is done
+		void settle()
+		{
+			while (_depth) {
+				Frame& f = _stack[_depth - 1];
+				if (f.pos == f.node->count) {
+					if (--_depth) ++_stack[_depth - 1].pos;
+					continue;
+				}
+				const Slot s = f.node->slots()[f.pos];
+				if (isEntry(s)) {
+					_entry = entryOf(s);
+					return;
+				}
+				_stack[_depth++] = Frame{nodeOf(s), 0};
+			}
+			_entry = nullptr;
+		}
+
+		struct Frame
+		{
+			const Node* node;
+			unsigned pos;
+		};
+		std::array<Frame, 8 * sizeof(std::size_t) / bits + 2> _stack;
+		unsigned _depth = 0;
+		const Entry* _entry = nullptr;
+	};
+	using iterator = const_iterator;
+
+	class Transient;
+
+	HashMap() = default;
+
+	HashMap(std::initializer_list< std::pair<K, V> > kvs)
+	{
+		Transient t(*this);
+		for (const auto& kv : kvs) t.insert(kv.first, kv.second);
+		*this = t.persistent();
+	}
+
+	HashMap(const HashMap& that) :
+		_root(that._root),
+		_size(that._size)
+	{
+		if (_root) retain(_root);
+	}
+
+	HashMap(HashMap&& that) noexcept :
+		_root(that._root),
+		_size(that._size)
+	{
+		that._root = nullptr;
+		that._size = 0;
+	}
+
+	HashMap& operator=(const HashMap& that)
+	{
+		if (that._root) retain(that._root);
+		release(_root);
+		_root = that._root;
+		_size = that._size;
+		return *this;
+	}
+
+	HashMap& operator=(HashMap&& that) noexcept
+	{
+		std::swap(_root, that._root);
+		std::swap(_size, that._size);
+		return *this;
+	}
+
+	~HashMap() { release(_root);}
+
+	bool empty() const { return _size == 0;}
+	size_type size() const { return _size;}
+
+	const V* find(const K& k) const
+	{
+		const Entry* e = find(_root, Hash()(k), k);
+		return e ? &(e->value) : nullptr;
+	}
+	bool contains(const K& k) const { return find(k) != nullptr;}
+	const V& at(const K& k) const
+	{
+		const V* v = find(k);
+		if (not v) throw std::out_of_range("key not found in a HashMap");
+		return *v;
+	}
+
+	HashMap insert(const K& k, const V& v) const
+	{
+		const std::size_t h = Hash()(k);
+		bool added = false;
+		if (not _root) {
+			Node* n = makeNode(1U << index(h, 0), 1, 0);
+			n->slots()[0] = slotOf(new Entry(h, k, v, nullptr));
+			return HashMap(n, 1);
+		}
+		Node* n = insert(_root, h, k, v, 0, 0, added);
+		return HashMap(n, _size + (added ? 1 : 0));
+	}
+
+	HashMap erase(const K& k) const
+	{
+		if (not _root) return *this;
+		bool removed = false;
+		Node* n = erase(_root, Hash()(k), k, 0, 0, removed);
+		return HashMap(n, _size - (removed ? 1 : 0));
+	}
+
+	Transient transient() const { return Transient(*this);}
+
+	const_iterator begin() const { return const_iterator(_root);}
+	const_iterator end() const { return const_iterator();}
+
+private:
+	Node* _root = nullptr;
+	size_type _size = 0;
+};
+
+//a transient edits its own nodes in place,
+//and copies the nodes it shares with the map it was made from
+template<typename K, typename V, typename Hash, typename Eq>
+class HashMap<K, V, Hash, Eq>::Transient
+{
+public:
+	explicit Transient(const HashMap& m) :
+		_root(m._root),
+		_size(m._size),
+		_edit(newEdit())
+	{
+		if (_root) retain(_root);
+	}
+	Transient(const Transient&) = delete;
+	Transient& operator=(const Transient&) = delete;
+	~Transient() { release(_root);}
+
+	size_type size() const { return _size;}
+
+	const V* find(const K& k) const
+	{
+		const Entry* e = HashMap::find(_root, Hash()(k), k);
+		return e ? &(e->value) : nullptr;
+	}
+
+	Transient& insert(const K& k, const V& v)
+	{
+		const std::size_t h = Hash()(k);
+		if (not _root) {
+			_root = makeNode(1U << index(h, 0), 1, _edit);
+			_root->slots()[0] = slotOf(new Entry(h, k, v, nullptr));
+			_size = 1;
+			return *this;
+		}
+		bool added = false;
+		Node* n = HashMap::insert(_root, h, k, v, 0, _edit, added);
+		release(_root);
+		_root = n;
+		if (added) ++_size;
+		return *this;
+	}
+
+	Transient& erase(const K& k)
+	{
+		if (not _root) return *this;
+		bool removed = false;
+		Node* n = HashMap::erase(_root, Hash()(k), k, 0, _edit, removed);
+		release(_root);
+		_root = n;
+		if (removed) --_size;
+		return *this;
+	}
+
+	//the nodes are handed over, and the transient is left empty
+	HashMap persistent()
+	{
+		_edit = newEdit();
+		HashMap m(_root, _size);
+		_root = nullptr;
+		_size = 0;
+		return m;
+	}
+
+private:
+	Node* _root;
+	size_type _size;
+	uint64_t _edit;
+};
+
+//a set is a map to nothing
+template<
+	typename K,
+	typename Hash = std::hash<K>,
+	typename Eq = std::equal_to<K>
+>
+class HashSet
+{
+	struct Nothing {};
+	using Map = HashMap<K, Nothing, Hash, Eq>;
+
+	explicit HashSet(Map&& m) : _map(std::move(m)) {}
+
+public:
+	using key_type = K;
+	using value_type = K;
+	using size_type = std::size_t;
+
+	class Transient
+	{
+	public:
+		explicit Transient(const HashSet& s) : _map(s._map) {}
+		Transient& insert(const K& k) { _map.insert(k, Nothing()); return *this;}
+		Transient& erase(const K& k) { _map.erase(k); return *this;}
+		bool contains(const K& k) const { return _map.find(k) != nullptr;}
+		size_type size() const { return _map.size();}
+		HashSet persistent() { return HashSet(_map.persistent());}
+	private:
+		typename Map::Transient _map;
+	};
+
+	HashSet() = default;
+	HashSet(std::initializer_list<K> ks)
+	{
+		Transient t(*this);
+		for (const auto& k : ks) t.insert(k);
+		*this = t.persistent();
+	}
+
+	bool empty() const { return _map.empty();}
+	size_type size() const { return _map.size();}
+	bool contains(const K& k) const { return _map.contains(k);}
+
+	HashSet insert(const K& k) const { return HashSet(_map.insert(k, Nothing()));}
+	HashSet erase(const K& k) const { return HashSet(_map.erase(k));}
+
+	Transient transient() const { return Transient(*this);}
+
+	template<typename F>
+	void for_each(const F& f) const
+	{
+		for (const auto& e : _map) f(e.key);
+	}
+
+private:
+	Map _map;
+};
+
+} /* namespace Persistent */
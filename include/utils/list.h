@@ -3,150 +3,464 @@
 
 #pragma once
 #include "util.h"
+#include "format.h"
+#include <atomic>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <iterator>
+#include <initializer_list>
 
-#if 0
-//a bit daunting because i do not understand the behavior of shared ptr
-//but a promising way to learn
+namespace Persistent {
+
+//a list's cells are not allocated one by one from the heap,
+//but are recycled from a pool of blocks.
+//a released cell goes to a thread local free-list. a thread keeps
+//at most 2 * BlockSize of them: past that, and when the thread exits,
+//it gives them back to a free-list shared by all threads, that threads
+//refill from before they take a new block. so cells allocated by a thread
+//and released by another go back to the pool, not to the thread alone.
+//the blocks themselves are owned by the pool, and live as long
+//as the program does.
+template<typename Node, std::size_t BlockSize = 256>
+class NodePool
+{
+public:
+	static void* allocate()
+	{
+		Local& local = localList();
+		if (not local.free) refill(local);
+		Slot* s = local.free;
+		local.free = s->next;
+		--local.count;
+		return s;
+	}
+
+	static void deallocate(void* p)
+	{
+		Local& local = localList();
+		if (not local.free) flushAtExit();
+		Slot* s = static_cast<Slot*>(p);
+		s->next = local.free;
+		local.free = s;
+		if (++local.count > 2 * BlockSize) flush(local, BlockSize);
+	}
+
+	//how many blocks the pool took from the heap
+	static std::size_t size()
+	{
+		Blocks& bs = blocks();
+		std::lock_guard<std::mutex> lock(bs.mutex);
+		return bs.store.size();
+	}
+
+private:
+	union Slot
+	{
+		Slot* next;
+		alignas(Node) unsigned char storage[sizeof(Node)];
+	};
+	using Block = std::array<Slot, BlockSize>;
+
+	//the cells a thread keeps, count of them
+	struct Local
+	{
+		Slot* free;
+		std::size_t count;
+	};
+
+	struct Blocks
+	{
+		std::mutex mutex;
+		std::vector< std::unique_ptr<Block> > store;
+		Slot* free = nullptr;
+	};
+
+	//never destroyed: cells may be released as the program exits
+	static Blocks& blocks()
+	{
+		static Blocks* bs = new Blocks;
+		return *bs;
+	}
+
+	//trivially destructible, so that it can still be used after the
+	//cells it holds were given back, as the thread exits
+	static Local& localList()
+	{
+		thread_local Local local{nullptr, 0};
+		return local;
+	}
+
+	//gives the cells of the thread back to the pool as it exits
+	struct Flusher
+	{
+		~Flusher() { flush(localList(), localList().count);}
+	};
+
+	static void flushAtExit()
+	{
+		thread_local Flusher flusher;
+		(void) flusher;
+	}
+
+	//n cells of a thread to the shared free-list
+	static void flush(Local& local, std::size_t n)
+	{
+		if (n == 0) return;
+		Slot* first = local.free;
+		Slot* last = first;
+		for (std::size_t i = 1; i != n; ++i) last = last->next;
+		local.free = last->next;
+		local.count -= n;
+		Blocks& bs = blocks();
+		std::lock_guard<std::mutex> lock(bs.mutex);
+		last->next = bs.free;
+		bs.free = first;
+	}
+
+	//cells from the shared free-list, or else from a new block
+	static void refill(Local& local)
+	{
+		flushAtExit();
+		Blocks& bs = blocks();
+		std::lock_guard<std::mutex> lock(bs.mutex);
+		if (not bs.free) {
+			bs.store.push_back(std::make_unique<Block>());
+			for (Slot& s : *bs.store.back()) {
+				s.next = bs.free;
+				bs.free = &s;
+			}
+		}
+		for (std::size_t i = 0; i != BlockSize and bs.free; ++i) {
+			Slot* s = bs.free;
+			bs.free = s->next;
+			s->next = local.free;
+			local.free = s;
+			++local.count;
+		}
+	}
+};
+
+template<typename T> class List;
+
+//a cell holds a datum, and an (intrusively) counted reference
+//to the next cell. cells are shared between lists,
+//and are never modified once they have been linked into a list.
 template<typename T>
 class Cell
 {
 public:
-	explicit Cell(const T& t) :
-		_datum(t),
-		_next(nullptr)
-	{}
-	explicit Cell(const T& t, const auto nptr) :
-		_datum(t),
-		_next(nptr)
+	template<typename... Xs>
+	explicit Cell(Xs&&... xs) :
+		_datum(std::forward<Xs>(xs)...),
+		_next(nullptr),
+		_refs(1)
 	{}
-	
-	const std::shared_ptr< Cell<T> >  next() const { return _next;}
-	Cell<T> link(const Cell<T>& c) { _next = &c;}
+
+	const T& datum() const { return _datum;}
+	const Cell<T>* next() const { return _next;}
+
+	static void retain(const Cell<T>* c)
+	{
+		if (c) c->_refs.fetch_add(1, std::memory_order_relaxed);
+	}
+	//release iteratively, a long list should not blow the stack
+	static void release(const Cell<T>* c)
+	{
+		while (c and c->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			const Cell<T>* n = c->_next;
+			delete c;
+			c = n;
+		}
+	}
+
+	static void* operator new(std::size_t) { return NodePool< Cell<T> >::allocate();}
+	static void operator delete(void* p) { NodePool< Cell<T> >::deallocate(p);}
 
 private:
-	T _datum;
-	std::shared_ptr< Cell<T> > _next;
-}
+	friend class List<T>;
+
+	const T _datum;
+	const Cell<T>* _next;
+	mutable std::atomic<uint32_t> _refs;
+};
 
+//an immutable cons list.
+//head, tail and cons (>>) are O(1), and a list shares its
+//cells with all the lists that were consed on to it.
 template<typename T>
 class List
 {
+public:
 	using type = T;
-	std::shared_ptr< Cell<T> > _root;
-	std::shared_ptr< Cell<T> > _tip;
+	using value_type = T;
+	using size_type = std::size_t;
+
+	class const_iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		const_iterator() = default;
+		explicit const_iterator(const Cell<T>* c) : _cell(c) {}
+
+		reference operator*() const { return _cell->datum();}
+		pointer operator->() const { return &(_cell->datum());}
+		const_iterator& operator++()
+		{
+			_cell = _cell->next();
+			return *this;
+		}
+		const_iterator operator++(int)
+		{
+			const_iterator it = *this;
+			_cell = _cell->next();
+			return it;
+		}
+		bool operator==(const const_iterator& that) const { return _cell == that._cell;}
+		bool operator!=(const const_iterator& that) const { return _cell != that._cell;}
+	private:
+		const Cell<T>* _cell = nullptr;
+	};
+	using iterator = const_iterator;
+
+	List() = default;
 
-public:
-	explicit List() :
-		_root { nullptr },
-		_tip { nullptr }
-	{}
-	explicit List(const Cell<T>& n, const Cell<T>& t) :
-		_root { &n },
-		_tip { &t }
-	{}
 	explicit List(const T& t) :
-		_root {std::make_shared< Cell<T> >(Cell<T>(t));}
-		_tip { _root}
+		_root(new Cell<T>(t)),
+		_size(1)
 	{}
-	explicit List(const T& t, const Cell<T>& c) :
-		List( std::make_shared< Cell<T> > (Cell<T>(t, _root)), _tip)
+
+	List(const T& t, const List<T>& tail) :
+		_root(link(new Cell<T>(t), tail._root)),
+		_size(tail._size + 1)
 	{}
 
-	
-	~List()
+	List(T&& t, const List<T>& tail) :
+		_root(link(new Cell<T>(std::move(t)), tail._root)),
+		_size(tail._size + 1)
 	{}
 
-	bool nil() {return (_root == nullptr);}
+	List(std::initializer_list<T> ts) :
+		List(std::begin(ts), std::end(ts))
+	{}
 
-	const Cell<T>& root() { return _root;}
-	const Cell<T>& tip() { return _tip;}
+	//cells are linked front to back,
+	//they are not visible to anyone before the list is complete.
+	//they are built into a list of their own, that releases
+	//those already built if a copy of a T throws
+	template<
+		typename It,
+		typename = typename std::iterator_traits<It>::value_type
+	>
+	List(It first, It last)
+	{
+		List<T> ts;
+		Cell<T>* tip = nullptr;
+		for (; first != last; ++first) tip = ts.append(tip, *first);
+		std::swap(_root, ts._root);
+		std::swap(_size, ts._size);
+	}
 
-	void push_front(const T& t)
+	List(const List<T>& that) :
+		_root(that._root),
+		_size(that._size)
 	{
-		_root = std::make_shared<Cell>(Cell(t, _root));
-		//std::unique_ptr<Cell> new_node(new Cell(t, _root));
-		//new_node->next = _root;
-		//_root = std::move(new_node);
+		Cell<T>::retain(_root);
 	}
-	void push_back(const T& t)
+
+	List(List<T>&& that) noexcept :
+		_root(that._root),
+		_size(that._size)
+	{
+		that._root = nullptr;
+		that._size = 0;
+	}
+
+	List<T>& operator=(const List<T>& that)
 	{
-		auto n = std::make_shared< Cell<T> >(Cell(t));
-		_tip->next = n;
-		_tip = n;
+		Cell<T>::retain(that._root);
+		Cell<T>::release(_root);
+		_root = that._root;
+		_size = that._size;
+		return *this;
 	}
 
-	void append(const List<T>& that)
+	List<T>& operator=(List<T>&& that) noexcept
 	{
-		if (that.nil()) return;
-		push_back(that.head());
-		return append(that.tail());
+		std::swap(_root, that._root);
+		std::swap(_size, that._size);
+		return *this;
 	}
 
-	T head() const { return _root->datum;}
-	const T& head() const {return _root->datum;}
+	~List() { Cell<T>::release(_root);}
+
+	bool nil() const { return _root == nullptr;}
+	bool empty() const { return _root == nullptr;}
+	size_type size() const { return _size;}
+
+	const T& head() const
+	{
+		if (not _root) throw std::out_of_range("head of an empty list");
+		return _root->datum();
+	}
 	List<T> tail() const
 	{
-		return List<T>(_root->next;)
+		if (not _root) throw std::out_of_range("tail of an empty list");
+		Cell<T>::retain(_root->next());
+		return List<T>(_root->next(), _size - 1);
 	}
 
-	//if we do not want a push_back function,
-	//we will need a method to reverse the List
+	const_iterator begin() const { return const_iterator(_root);}
+	const_iterator end() const { return const_iterator();}
+
 	List<T> reverse() const
 	{
-		List<T> rts();
-		auto n = _root;
-		while(n != nullptr) {
-			rts.push_front(n->datum);
-			n = n->next;
-		}
+		List<T> rts;
+		for (const auto& t : *this) rts = List<T>(t, rts);
 		return rts;
 	}
-	//monadic return
-	static unit(const T& t)
+
+	//a list with a copy of the cells of this one, followed by that.
+	//that is shared, not copied.
+	//as for map, the cells are built into ts, that releases them if a copy throws
+	List<T> concat(const List<T>& that) const
 	{
-		List<T> l();
-		l.push_front(t);
-		return l;
+		if (not _root) return that;
+		if (not that._root) return *this;
+		List<T> ts;
+		Cell<T>* tip = nullptr;
+		for (const auto& t : *this) tip = ts.append(tip, t);
+		link(tip, that._root);
+		ts._size += that._size;
+		return ts;
 	}
+
 	//map the list
 	template<
 		typename F,
 		typename S = typename std::result_of<F&(T)>::type
 	>
-	List<S> map(const F& f)
+	List<S> map(const F& f) const
 	{
 		List<S> ss;
-		auto n = _root;
-		while (n != nullptr) {
-			ss.push_back(f(n->datum));
-		}
+		Cell<S>* tip = nullptr;
+		for (const auto& t : *this) tip = ss.append(tip, f(t));
 		return ss;
 	}
-	//monadic bind
-	template<
-		typename F,
-		typename LS = typename std::result_of<F&(T)>::type,
-		typename S = typename LS::type
-	>
-	List<S> operator >>= (const F& f)
+
+private:
+	template<typename S> friend class List;
+
+	//takes over a reference to root, that should be retained by the caller
+	List(const Cell<T>* root, const size_type size) :
+		_root(root),
+		_size(size)
+	{}
+
+	static const Cell<T>* link(Cell<T>* c, const Cell<T>* next)
 	{
-		List<S> lss;
-		auto n = _root;
-		while (n != nullptr) {
-			lss.append(f(n->datum));
-		}
-		return lss;
+		Cell<T>::retain(next);
+		c->_next = next;
+		return c;
 	}
 
-}
+	//append to a list under construction, whose last cell is tip
+	template<typename X>
+	Cell<T>* append(Cell<T>* tip, X&& x)
+	{
+		Cell<T>* c = new Cell<T>(std::forward<X>(x));
+		if (tip) tip->_next = c; else _root = c;
+		++_size;
+		return c;
+	}
+
+	const Cell<T>* _root = nullptr;
+	size_type _size = 0;
+};
 
 template<typename T>
 const List<T> nil = List<T>();
 
+//monadic return
+template<typename T>
+inline List<T> unit(const T& t) { return List<T>(t);}
+
+//cons
+template<typename T>
+inline List<T> operator >> (const T& head, const List<T>& tail)
+{
+	return List<T>(head, tail);
+}
+
+template<typename T>
+inline const T& head(const List<T>& list) { return list.head();}
+
+template<typename T>
+inline List<T> tail(const List<T>& list) { return list.tail();}
+
+template<
+	typename T,
+	typename F,
+	typename S = typename std::result_of<F&(T)>::type
+>
+inline List<S> map(const F& f, const List<T>& ts)
+{
+	return ts.map(f);
+}
+
+//to flatten we share the last list, and copy the cells of the others
+template<typename T>
+inline List<T> flatten(const List< List<T> >& llt)
+{
+	List<T> ltout;
+	for (const auto& lt : llt.reverse()) ltout = lt.concat(ltout);
+	return ltout;
+}
+
+//bind
+template<
+	typename T,
+	typename F,
+	typename LS = typename std::result_of<F&(T)>::type,
+	typename S = typename LS::value_type
+>
+inline List<S> operator >>= (const List<T>& ts, const F& fst)
+{
+	return flatten(ts.map(fst));
+}
+
+template<typename T>
+inline bool operator==(const List<T>& l1, const List<T>& l2)
+{
+	if (l1.size() != l2.size()) return false;
+	return std::equal(std::begin(l1), std::end(l1), std::begin(l2));
+}
+
+template<typename T>
+inline bool operator!=(const List<T>& l1, const List<T>& l2)
+{
+	return not (l1 == l2);
+}
+
+template<typename T>
+inline void print(const List<T>& l)
+{
+	Format::TextBuilder(std::cout).range(l, {"", ", ", "\n"}).flush();
+	std::cout.flush();
+}
+
+//the elements written one after the other, each as std::to_string writes it
 template<typename T>
-List<T> operator >> (const T& t, const List<T>& ts)
+inline std::string to_string(const List<T>& l)
 {
-	return List<T>(t, ts.root());
+	Format::TextBuilder text;
+	for (const auto& t : l) text.put(std::to_string(t));
+	return text.str();
 }
 
-#endif
+} /* namespace Persistent */
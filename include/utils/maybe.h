@@ -0,0 +1,147 @@
+//Maybe and Either as plain values.
+//both are stored inline (no heap), and have no virtual functions,
+//so they can be returned by value, and used in inner loops.
+
+#pragma once
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <variant>
+
+//converts to an empty Maybe of any type
+struct None {};
+
+template<typename T>
+class Maybe
+{
+public:
+	using type = T;
+	using value_type = T;
+
+	Maybe() = default;
+	Maybe(None) {}
+	Maybe(const T& t) : _value(t) {}
+	Maybe(T&& t) : _value(std::move(t)) {}
+
+	bool isValid() const { return _value.has_value();}
+	explicit operator bool() const { return isValid();}
+
+	const T& get() const
+	{
+		if (not _value) throw std::invalid_argument("None does not contain any elements");
+		return *_value;
+	}
+
+	T getOrElse(const T& t) const { return _value ? *_value : t;}
+
+	//this if valid, otherwise that
+	Maybe<T> orElse(const Maybe<T>& that) const { return _value ? *this : that;}
+
+	template<
+		typename F,
+		typename S = typename std::result_of<F&(T)>::type
+	>
+	Maybe<S> map(const F& f) const
+	{
+		if (not _value) return Maybe<S>();
+		return Maybe<S>(f(*_value));
+	}
+
+	template<
+		typename F,
+		typename MS = typename std::result_of<F&(T)>::type
+	>
+	MS flatMap(const F& f) const
+	{
+		if (not _value) return MS();
+		return f(*_value);
+	}
+
+private:
+	std::optional<T> _value;
+};
+
+template<typename T>
+inline Maybe<T> Valid(const T& t) { return Maybe<T>(t);}
+
+template<typename T>
+inline bool operator==(const Maybe<T>& m1, const Maybe<T>& m2)
+{
+	if (not m1.isValid()) return not m2.isValid();
+	return m2.isValid() and m1.get() == m2.get();
+}
+
+//the two sides of an Either, before we know the other side's type
+template<typename E>
+struct LeftValue { E value;};
+
+template<typename T>
+struct RightValue { T value;};
+
+template<typename E>
+inline LeftValue<E> Left(const E& e) { return LeftValue<E>{e};}
+
+template<typename T>
+inline RightValue<T> Right(const T& t) { return RightValue<T>{t};}
+
+//either an error E (left), or a value T (right)
+template<typename E, typename T>
+class Either
+{
+public:
+	using error_type = E;
+	using type = T;
+	using value_type = T;
+
+	Either(const LeftValue<E>& l) : _value(std::in_place_index<0>, l.value) {}
+	Either(const RightValue<T>& r) : _value(std::in_place_index<1>, r.value) {}
+
+	bool isLeft() const { return _value.index() == 0;}
+	bool isRight() const { return _value.index() == 1;}
+	explicit operator bool() const { return isRight();}
+
+	const E& left() const
+	{
+		if (not isLeft()) throw std::invalid_argument("Either does not contain an error");
+		return std::get<0>(_value);
+	}
+	const T& right() const
+	{
+		if (not isRight()) throw std::invalid_argument("Either does not contain a value");
+		return std::get<1>(_value);
+	}
+	const T& get() const { return right();}
+
+	T getOrElse(const T& t) const { return isRight() ? std::get<1>(_value) : t;}
+
+	Either<E, T> orElse(const Either<E, T>& that) const { return isRight() ? *this : that;}
+
+	Maybe<T> toMaybe() const
+	{
+		if (isLeft()) return Maybe<T>();
+		return Maybe<T>(std::get<1>(_value));
+	}
+
+	template<
+		typename F,
+		typename S = typename std::result_of<F&(T)>::type
+	>
+	Either<E, S> map(const F& f) const
+	{
+		if (isLeft()) return Left(std::get<0>(_value));
+		return Right(f(std::get<1>(_value)));
+	}
+
+	template<
+		typename F,
+		typename ES = typename std::result_of<F&(T)>::type
+	>
+	ES flatMap(const F& f) const
+	{
+		if (isLeft()) return Left(std::get<0>(_value));
+		return f(std::get<1>(_value));
+	}
+
+private:
+	std::variant<E, T> _value;
+};
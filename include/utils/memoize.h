@@ -0,0 +1,223 @@
+// Memoization of pure functions, for the lambdas of category.h
+// memoize(f) remembers the results of f in a table shared by its copies,
+//that may be called from several threads at once.
+// memo_fix<R(A...)>(f) is the memoizing version of the Y combinator:
+//f is written as fact in category.h, receiving the function to call
+//for its recursive calls, and all of these calls go through the table.
+
+#pragma once
+#include "curry.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace category
+{
+
+struct MemoStats
+{
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+
+  double hitRate() const
+  {
+    const uint64_t calls = hits + misses;
+    return calls == 0 ? 0.0 : (double) hits / (double) calls;
+  }
+};
+
+template <typename... Ts>
+struct TupleHash
+{
+  std::size_t operator()(const std::tuple<Ts...>& key) const
+  {
+    std::size_t h = 0;
+    std::apply(
+      [&h] (const auto&... x) {
+        ((h ^= std::hash<std::decay_t<decltype(x)> >()(x)
+          + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)), ...);
+      },
+      key);
+    return h;
+  }
+};
+
+// A hash map split in shards, each with its own lock,
+//so that threads looking up different keys rarely wait for each other.
+// With a capacity, each shard keeps its entries in least recently used order,
+//and drops the oldest one beyond its share of the capacity.
+template <typename Key, typename Value, typename Hash>
+class MemoTable
+{
+public:
+  static constexpr std::size_t Shards = 16;
+
+  // capacity 0 is unbounded
+  explicit MemoTable(std::size_t capacity) :
+    _shardCapacity(capacity == 0 ? 0 : (capacity + Shards - 1) / Shards)
+  {}
+
+  // the value of a key, none on a miss
+  std::optional<Value> find(const Key& key)
+  {
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+      _misses.fetch_add(1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    if (_shardCapacity != 0)
+      shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    _hits.fetch_add(1, std::memory_order_relaxed);
+    return found->second->second;
+  }
+
+  // the first value stored for a key is kept
+  void insert(const Key& key, const Value& value)
+  {
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.index.count(key)) return;
+    shard.entries.emplace_front(key, value);
+    shard.index.emplace(key, shard.entries.begin());
+    if (_shardCapacity != 0 and shard.index.size() > _shardCapacity) {
+      shard.index.erase(shard.entries.back().first);
+      shard.entries.pop_back();
+      _evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  std::size_t size()
+  {
+    std::size_t n = 0;
+    for (auto& shard : _shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      n += shard.index.size();
+    }
+    return n;
+  }
+
+  void clear()
+  {
+    for (auto& shard : _shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.index.clear();
+      shard.entries.clear();
+    }
+  }
+
+  MemoStats stats() const
+  {
+    MemoStats s;
+    s.hits = _hits.load(std::memory_order_relaxed);
+    s.misses = _misses.load(std::memory_order_relaxed);
+    s.evictions = _evictions.load(std::memory_order_relaxed);
+    return s;
+  }
+
+private:
+  using Entries = std::list< std::pair<Key, Value> >;
+
+  struct Shard
+  {
+    std::mutex mutex;
+    Entries entries;
+    std::unordered_map<Key, typename Entries::iterator, Hash> index;
+  };
+
+  Shard& shardOf(const Key& key)
+  {
+    // the high bits of a multiplicative hash, the low bits go to the buckets
+    const uint64_t h = (uint64_t) Hash()(key) * 0x9e3779b97f4a7c15ULL;
+    return _shards[h >> 60];
+  }
+
+  const std::size_t _shardCapacity;
+  Shard _shards[Shards];
+  std::atomic<uint64_t> _hits {0};
+  std::atomic<uint64_t> _misses {0};
+  std::atomic<uint64_t> _evictions {0};
+};
+
+template <typename Signature, typename F, bool Recursive>
+class Memoized;
+
+// Copies share their table. Values are computed outside of the locks,
+//so recursive calls, and other threads, are not blocked meanwhile;
+//two threads missing the same key may both compute it.
+template <typename R, typename... A, typename F, bool Recursive>
+class Memoized<R(A...), F, Recursive>
+{
+public:
+  using Key = std::tuple< std::decay_t<A>... >;
+  using Value = std::decay_t<R>;
+  using Table = MemoTable< Key, Value, TupleHash< std::decay_t<A>... > >;
+
+  Memoized(F f, std::size_t capacity) :
+    _f(std::move(f)),
+    _table(std::make_shared<Table>(capacity))
+  {}
+
+  Value operator()(A... a) const
+  {
+    const Key key(a...);
+    if (auto found = _table->find(key)) return std::move(*found);
+    Value value = compute(a...);
+    _table->insert(key, value);
+    return value;
+  }
+
+  MemoStats stats() const { return _table->stats(); }
+  std::size_t size() const { return _table->size(); }
+  void clear() const { _table->clear(); }
+
+private:
+  // the value is built on a miss alone, it need not be default constructible
+  Value compute(A... a) const
+  {
+    if constexpr (Recursive) return _f(*this, a...);
+    else return _f(a...);
+  }
+
+  F _f;
+  std::shared_ptr<Table> _table;
+};
+
+// memoize<R(A...)>(f), for generic lambdas
+template <typename Signature, typename F>
+Memoized<Signature, F, false> memoize(F f, std::size_t capacity = 0)
+{
+  return Memoized<Signature, F, false>(std::move(f), capacity);
+}
+
+// memoize(f), the signature read from f
+template <
+  typename F,
+  typename = std::enable_if_t<std::is_class<F>::value or std::is_pointer<F>::value>
+  >
+auto memoize(F f, std::size_t capacity = 0)
+{
+  return memoize<typename signature<F>::type>(std::move(f), capacity);
+}
+
+// f(self, a...) calls self for its recursive calls, as in
+// memo_fix<long(int)>([] (const auto& fib, int n) -> long {
+//   return n < 2 ? n : fib(n - 1) + fib(n - 2); })
+template <typename Signature, typename F>
+Memoized<Signature, F, true> memo_fix(F f, std::size_t capacity = 0)
+{
+  return Memoized<Signature, F, true>(std::move(f), capacity);
+}
+
+} // end namespace category
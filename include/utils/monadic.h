@@ -1,5 +1,6 @@
 
 #include "util.h"
+#include "format.h"
 #include <list>
 //for the parser to be a monad we follow haskell
 
@@ -37,17 +38,38 @@ List<T> tail(const List<T>& list) { return List<T>(++begin(list), end(list));}
 
 
 
+//move the elements of ts to the end of out,
+//a std::list is spliced in O(1), other containers are moved into.
+template<typename T>
+inline void spliceBack(List<T>& out, List<T>&& ts)
+{
+	out.splice(std::end(out), ts);
+}
+template<typename C, typename Ts>
+inline void spliceBack(C& out, Ts&& ts)
+{
+	out.insert(
+		std::end(out),
+		std::make_move_iterator(std::begin(ts)),
+		std::make_move_iterator(std::end(ts))
+	);
+}
+
 //for a list monad we need to flatten a list of lists
+//the inner lists are moved out, and spliced in O(number of lists)
 template<typename T>
-List<T> flatten(List< List<T> >& llt)
+List<T> flatten(List< List<T> >&& llt)
 {
 	List<T> ltout;
-	auto it = ltout.begin();
-	for (const auto& lt : llt) {
-		ltout.insert(it, lt);
-	}
+	for (auto& lt : llt) spliceBack(ltout, std::move(lt));
 	return ltout;
 }
+//a const list of lists has to be copied first
+template<typename T>
+List<T> flatten(const List< List<T> >& llt)
+{
+	return flatten(List< List<T> >(llt));
+}
 //an explicit map
 template<
 	typename T,
@@ -58,42 +80,54 @@ inline List<S> map(const F f, const List<T>& ts)
 {
 	List<S> ss;
 	for (const auto& t : ts) ss.push_back(f(t));
-	return ts;
+	return ss;
+}
+//flatMap writes the results of f straight into out,
+//without a list of lists in between.
+//ts can be any iterable, and out any container with an insert
+template<
+	typename Ts,
+	typename F,
+	typename C
+>
+inline C& flatMap(const F& f, const Ts& ts, C& out)
+{
+	for (const auto& t : ts) spliceBack(out, f(t));
+	return out;
 }
 //bind
 template<
 	typename T,
 	typename F,
-	typename S = typename std::result_of<F&(T)>::value_type
+	typename LS = typename std::result_of<F&(T)>::type,
+	typename S = typename LS::value_type
 >
-inline List<S>& operator >>= (
-	List<T>& ts,
+inline List<S> operator >>= (
+	const List<T>& ts,
 	const F& fst
 )
 {
-	return flatten( map(fst, ts));
+	List<S> ss;
+	return flatMap(fst, ts, ss);
 }
 
 template<typename T>
 List<T> nil = List<T>();
 
+//tail copies a std::list, so we do not recurse on it here.
+//for O(1) head and tail use the persistent list in list.h
 template<typename T>
 bool operator==(const List<T>& l1, const List<T>& l2)
 {
-	if (l1.empty()) return l2.empty();
-	if (l2.empty()) return false;
-	return head(l1) == head(l2) and tail(l1) == tail(l2);
+	if (l1.size() != l2.size()) return false;
+	return std::equal(std::begin(l1), std::end(l1), std::begin(l2));
 }
 
 template<typename T>
 void print(const List<T>& l)
 {
-	if (l.empty()) {
-		std::cout << std::endl;
-		return;
-	}
-	std::cout << head(l) << ", ";
-	print(tail(l));
+	Format::TextBuilder(std::cout).range(l, {"", ", ", "\n"}).flush();
+	std::cout.flush();
 }
 
 
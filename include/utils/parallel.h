@@ -0,0 +1,126 @@
+//parallel versions of the monadic combinators.
+//work is split into chunks that run on the shared ThreadPool,
+//results come back in the order of the input,
+//and inputs smaller than a grain are done on the calling thread.
+
+#pragma once
+#include "util.h"
+#include "threadpool.h"
+#include "monadic.h"
+#include <iterator>
+
+namespace Monadic {
+
+//inputs upto this size are not worth the threads
+constexpr std::size_t defaultGrain = 1024;
+
+//[begin, end) iterators of the chunks of ts.
+//with random access iterators the chunks are cut in O(1) each,
+//other iterators are walked once.
+template<typename Ts>
+inline auto chunksOf(const Ts& ts, const std::size_t grain)
+{
+	using It = decltype(std::begin(ts));
+	const std::size_t n = (std::size_t) std::distance(std::begin(ts), std::end(ts));
+	const std::size_t nthreads = ThreadPool::shared().size() + 1;
+	//a few chunks per thread, to even out the load
+	const std::size_t size = std::max(grain, (n + 4 * nthreads - 1) / (4 * nthreads));
+	std::vector< std::pair<It, It> > chunks;
+	It it = std::begin(ts);
+	for (std::size_t i = 0; i < n; i += size) {
+		It next = std::next(it, (std::ptrdiff_t) std::min(size, n - i));
+		chunks.push_back(std::make_pair(it, next));
+		it = next;
+	}
+	return chunks;
+}
+
+//run f(chunk begin, chunk end, chunk's output) over the chunks of ts,
+//and concatenate the outputs in order
+template<typename S, typename Ts, typename F>
+inline std::vector<S> chunkwise(const Ts& ts, const std::size_t grain, const F& f)
+{
+	const auto chunks = chunksOf(ts, grain);
+	std::vector<S> out;
+	if (chunks.size() <= 1) {
+		for (const auto& c : chunks) f(c.first, c.second, out);
+		return out;
+	}
+	std::vector< std::vector<S> > outs(chunks.size());
+	ThreadPool::shared().parallelFor(chunks.size(), [&] (const std::size_t i) {
+			f(chunks[i].first, chunks[i].second, outs[i]);
+		}
+	);
+	std::size_t total = 0;
+	for (const auto& o : outs) total += o.size();
+	out.reserve(total);
+	for (auto& o : outs) spliceBack(out, std::move(o));
+	return out;
+}
+
+template<
+	typename Ts,
+	typename F,
+	typename T = typename Ts::value_type,
+	typename S = typename std::result_of<F&(T)>::type
+>
+inline std::vector<S> pmap(const F& f, const Ts& ts, const std::size_t grain = defaultGrain)
+{
+	return chunkwise<S>(ts, grain, [&f] (auto first, auto last, std::vector<S>& ss) {
+			ss.reserve((std::size_t) std::distance(first, last));
+			for (; first != last; ++first) ss.push_back(f(*first));
+		}
+	);
+}
+
+template<
+	typename Ts,
+	typename P,
+	typename T = typename Ts::value_type
+>
+inline std::vector<T> pfilter(const P& pred, const Ts& ts, const std::size_t grain = defaultGrain)
+{
+	return chunkwise<T>(ts, grain, [&pred] (auto first, auto last, std::vector<T>& out) {
+			for (; first != last; ++first) if (pred(*first)) out.push_back(*first);
+		}
+	);
+}
+
+template<
+	typename Ts,
+	typename F,
+	typename T = typename Ts::value_type,
+	typename CS = typename std::result_of<F&(T)>::type,
+	typename S = typename CS::value_type
+>
+inline std::vector<S> pflatMap(const F& f, const Ts& ts, const std::size_t grain = defaultGrain)
+{
+	return chunkwise<S>(ts, grain, [&f] (auto first, auto last, std::vector<S>& out) {
+			for (; first != last; ++first) spliceBack(out, f(*first));
+		}
+	);
+}
+
+//f should be associative. every chunk is folded from its first element,
+//and the folds of the chunks are combined in order, starting from init.
+//the fold is in the type of the elements, init is converted to it.
+template<
+	typename Ts,
+	typename F,
+	typename T = typename Ts::value_type
+>
+inline T preduce(const F& f, const typename Ts::value_type& init, const Ts& ts,
+                 const std::size_t grain = defaultGrain)
+{
+	const auto partials = chunkwise<T>(ts, grain, [&f] (auto first, auto last, std::vector<T>& out) {
+			T acc = *first;
+			for (++first; first != last; ++first) acc = f(acc, *first);
+			out.push_back(acc);
+		}
+	);
+	T acc = init;
+	for (const auto& p : partials) acc = f(acc, p);
+	return acc;
+}
+
+} /* namespace Monadic */
@@ -3,6 +3,8 @@
 
 #pragma once
 #include "monadic.h"
+#include "list.h"
+#include "trampoline.h"
 #include <regex>
 #include <algorithm>
 #include <stdexcept>
@@ -20,106 +22,19 @@ namespace Expression
 //using namespace Monadic;
 using String = std::string;
 
-//a const list can be a good example to design an immutable,
-//persistent data structure in C++.
-// a wrapper around std::list that employs monadic relationships
+//the parser returns its repeated matches in a persistent cons list
+//(see list.h), so that many and many1 cons in O(1).
 template <typename T>
-using List = std::list<T>;
-//we do not want to create a wrapper class, instead we use operators
-template< typename T>
-List<T> unit(const T& t) { return List<T>(t);}
+using List = Persistent::List<T>;
 
-//the list should be cons list, we will use the stream operator
-//this is not the ideal solution
-//ideally we would like >> to create a new (persistent, immutable) list
-//checkout implementation attempt in list.h
-template<typename T>
-inline List<T>& operator >> (const T& head, List<T>& tail)
-{
-	tail.push_front(head);
-	return tail;
-}
-
-template<typename T>
-inline const List<T>& operator >> (const T& head, List<T> tail)
-{
-	tail.push_front(head);
-	return std::move(tail);
-}
-
-template<typename T>
-inline const T& head(const List<T>& list) { return *begin(list);}
-
-template<typename T>
-inline List<T> tail(const List<T>& list) { return List<T>(++begin(list), end(list));}
-
-
-
-//for a list monad we need to flatten a list of lists
-template<typename T>
-inline List<T> flatten(List< List<T> >& llt)
-{
-	List<T> ltout;
-	auto it = ltout.begin();
-	for (const auto& lt : llt) {
-		ltout.insert(it, lt);
-	}
-	return ltout;
-}
-//an explicit map
-template<
-	typename T,
-	typename F,
-	typename S = typename std::result_of<F&(T)>::type
->
-inline List<S> map(const F f, const List<T>& ts)
-{
-	List<S> ss;
-	for (const auto& t : ts) ss.push_back(f(t));
-	return ts;
-}
-//bind
-template<
-	typename T,
-	typename F,
-	typename S = typename std::result_of<F&(T)>::value_type
->
-inline List<S>& operator >>= (
-	List<T>& ts,
-	const F& fst
-)
-{
-	return flatten( map(fst, ts));
-}
-
-template<typename T>
-List<T> nil = List<T>();
-
-template<typename T>
-inline bool operator==(const List<T>& l1, const List<T>& l2)
-{
-	if (l1.empty()) return l2.empty();
-	if (l2.empty()) return false;
-	return head(l1) == head(l2) and tail(l1) == tail(l2);
-}
-
-template<typename T>
-inline void print(const List<T>& l)
-{
-	if (l.empty()) {
-		std::cout << std::endl;
-		return;
-	}
-	std::cout << head(l) << ", ";
-	print(tail(l));
-}
-
-template<typename T>
-inline String to_string(const List<T>& l)
-{
-	if (l.empty())	return String();
-	return std::to_string(head(l)) + to_string(tail(l));
-}
+using Persistent::unit;
+using Persistent::head;
+using Persistent::tail;
+using Persistent::map;
+using Persistent::flatten;
+using Persistent::nil;
+using Persistent::print;
+using Persistent::to_string;
 
 
 
@@ -139,6 +54,9 @@ struct ParsedResult
 		empty(true)
 	{}
 
+	//the parsed value, when there is one
+	Maybe<T> toMaybe() const { return empty ? Maybe<T>() : Maybe<T>(value);}
+
 	T value;
 	String out;
 	bool empty;
@@ -170,7 +88,7 @@ ParsedResult<T> some(const T& t, const String& s)
 
 //i cannot specialize to template<>, compile errors
 //but i can overload
-ParsedResult<void> some(const String& s)
+inline ParsedResult<void> some(const String& s)
 {
 	return ParsedResult<void>(s);
 }
@@ -208,7 +126,7 @@ inline auto parse(const auto& pt, const String& in)
 
 //a parser that always fails
 template<typename T>
-const Parser<T> failure = Parser<T>([=] (const String& in) {
+const Parser<T> failure = Parser<T>([] (const String& in) {
 		in + "suppress unused variable warning";
 		return empty<T>;
 	}
@@ -230,7 +148,7 @@ inline const Parser<T> yield(const T& t)
 }
 //needs default constructor
 //template< >
-const Parser<void> yield() {
+inline const Parser<void> yield() {
 	return Parser<void> ( [=] (const String& in) {
 			return some(in);
 		}
@@ -551,13 +469,23 @@ inline Parser<void> drop(const Parser<T>& pt){ return pt >> yield(); }
 
 
 
-//many will be slow if it has to parse a large number of items
+//many as many1(pt) | yield(List<T>()) would nest a call per parsed item,
+//so it is trampolined: it parses item after item in constant stack,
+//consing them in reverse
 //passing non-const reference causes incomprehensible compile errors
-//use imperative several instead
 template<typename T>
 inline Parser< List<T> > many(const Parser<T>& pt)
 {
-	return many1(pt) | yield(List<T>());
+	return Parser< List<T> >([=] (const String& in) {
+			const auto step = [&pt] (const List<T>& ts, const String& out)
+				-> Bounce< ParsedResult< List<T> >, List<T>, String > {
+				const auto rt = parse(pt, out);
+				if (rt.empty) return done(some(ts.reverse(), out));
+				return again(rt.value >> ts, rt.out);
+			};
+			return run(step, List<T>(), in);
+		}
+	);
 }
 template<typename T>
 inline Parser< List<T> > many1(const Parser<T>& pt)
@@ -625,13 +553,15 @@ inline Parser<L> accumulate(const Parser<T>& pt, const F& f)
 template<typename T>
 inline Parser< List<T> > several(const Parser<T>& pt)
 {
+	//accumulate in reverse, a persistent list can only be consed
 	return accumulate< List<T> >(
 		pt,
-		[=] (List<T>& l, const T& t) {
-			l.push_back(t);
-			return l;
+		[=] (const List<T>& l, const T& t) {
+			return t >> l;
 		}
-	);
+	) >>= [=] (const List<T>& l) {
+		return yield(l.reverse());
+	};
 }
 
 template<typename T>
@@ -658,7 +588,7 @@ inline Parser<char> sat(const auto& pred)
 	};
 }
 
-const auto isSpace = [=] (const char c) { return c == ' ';};
+const auto isSpace = [] (const char c) { return c == ' ';};
 
 inline const auto char_(const char c)
 {
@@ -668,11 +598,20 @@ inline const auto char_(const char c)
 inline Parser<void> drop(const char c) {return char_(c) >> yield();}
 
 //and sometimes drop whole strings
-//and recursion makes it easier to think and define
+//recursion makes it easier to think and define,
+//as char_(s[0]) >> drop(s.substr(1)), but the trampoline keeps
+//the stack flat for long strings
 inline Parser<void> drop(const String& s)
 {
-	if (s.size() == 0) return yield();
-	return char_(s[0]) >> drop(s.substr(1));
+	return Parser<void>([=] (const String& in) {
+			const auto step = [&] (const std::size_t i) -> Bounce< ParsedResult<void>, std::size_t > {
+				if (i == s.size()) return done(some(in.substr(i)));
+				if (i == in.size() or in[i] != s[i]) return done(empty<void>);
+				return again(i + 1);
+			};
+			return run(step, std::size_t(0));
+		}
+	);
 }
 
 const auto space = many(sat(isSpace)) >> yield();
@@ -0,0 +1,233 @@
+// fmap over runtime containers, with the syntax of category.h
+// List(1, 2, 3) > f > g maps over a parameter pack known at compile time.
+//The same syntax, xs > f > g, works on containers: std::vector, std::array,
+//std::list, persistent lists, DataFrame columns.
+//It builds a Pipeline, that composes f and g into a single function,
+//and evaluates it in one pass over xs when it is collected into a vector:
+//
+//	std::vector<double> ys = xs > f > g;
+//	auto zs = (par(xs) > f > g).collect();
+//
+//A stage that returns nothing, such as a print, ends the pipeline:
+//it runs right away, over all the elements.
+// Pipelines evaluate sequentially, or in parallel chunks on the shared
+//ThreadPool when started with par or par_unseq, for containers
+//with random access. A pipeline refers to the container it was started on,
+//that should outlive it, unless that container was a temporary.
+
+#pragma once
+#include "threadpool.h"
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace category
+{
+
+// Pipelines derive from Pipelined, to keep them apart
+//from the lambda lists of category.h
+struct Pipelined {};
+
+template <typename C, typename = void>
+struct is_range : std::false_type {};
+
+template <typename C>
+struct is_range<
+  C,
+  std::void_t<
+    decltype(std::begin(std::declval<const C&>())),
+    decltype(std::end(std::declval<const C&>()))
+    >
+  > : std::true_type {};
+
+template <typename Source, typename Fn, typename Policy>
+class Pipeline;
+
+// what a pipeline starts with
+struct Identity
+{
+  template <typename X>
+  X&& operator()(X&& x) const { return std::forward<X>(x); }
+};
+
+// Execution policies: par(xs) and par_unseq(xs) start a parallel pipeline.
+//par_unseq also lets the compiler vectorize the loop over each chunk.
+template <typename Self>
+struct Policy
+{
+  template <typename C>
+  auto operator()(C&& xs) const
+  {
+    using Source = std::conditional_t<
+      std::is_lvalue_reference<C>::value,
+      const std::remove_reference_t<C>&,
+      std::decay_t<C>
+      >;
+    return Pipeline<Source, Identity, Self>(std::forward<C>(xs), Identity());
+  }
+};
+
+struct Sequenced : Policy<Sequenced> {};
+struct Parallel : Policy<Parallel> {};
+struct ParallelUnsequenced : Policy<ParallelUnsequenced> {};
+
+inline constexpr Sequenced seq {};
+inline constexpr Parallel par {};
+inline constexpr ParallelUnsequenced par_unseq {};
+
+template <typename Source, typename Fn, typename P>
+class Pipeline : public Pipelined
+{
+public:
+  using source_type = std::decay_t<Source>;
+  using iterator = decltype(std::begin(std::declval<const source_type&>()));
+  using element_type = decltype(*std::declval<iterator>());
+  using result_type = std::invoke_result_t<const Fn&, element_type>;
+  using value_type = std::decay_t<result_type>;
+
+  // elements per chunk of a parallel pipeline
+  static constexpr std::size_t Grain = 4096;
+
+  template <typename S>
+  Pipeline(S&& source, Fn fn) :
+    _source(std::forward<S>(source)),
+    _fn(std::move(fn))
+  {}
+
+  // the same pipeline, to run with another policy
+  template <typename Q>
+  Pipeline<Source, Fn, Q> on(const Q&) const
+  {
+    return Pipeline<Source, Fn, Q>(_source, _fn);
+  }
+
+  // g after the functions of the pipeline, fused into one
+  template <typename G>
+  auto then(G g) const &
+  {
+    return Pipeline<Source, Composed<G>, P>(_source, compose(_fn, std::move(g)));
+  }
+
+  // a temporary container moves on to the next stage
+  template <typename G>
+  auto then(G g) &&
+  {
+    return Pipeline<Source, Composed<G>, P>(
+      std::forward<Source>(_source), compose(std::move(_fn), std::move(g)));
+  }
+
+  std::vector<value_type> collect() const
+  {
+    std::vector<value_type> ys;
+    if constexpr (parallel() and std::is_default_constructible<value_type>::value) {
+      ys.resize(size());
+      run([this, &ys] (const std::size_t i, element_type x) { ys[i] = _fn(x); });
+    } else {
+      ys.reserve(size());
+      for (auto&& x : _source) ys.push_back(_fn(x));
+    }
+    return ys;
+  }
+
+  operator std::vector<value_type>() const { return collect(); }
+
+  // g(y) for each result y, in no particular order if the pipeline is parallel
+  template <typename G>
+  void for_each(const G& g) const
+  {
+    run([this, &g] (std::size_t, element_type x) { g(_fn(x)); });
+  }
+
+  std::size_t size() const
+  {
+    return (std::size_t) std::distance(std::begin(_source), std::end(_source));
+  }
+
+private:
+  template <typename G>
+  static auto compose(Fn f, G g)
+  {
+    return [f = std::move(f), g = std::move(g)] (auto&& x) {
+      return g(f(std::forward<decltype(x)>(x)));
+    };
+  }
+
+  template <typename G>
+  using Composed = decltype(compose(std::declval<Fn>(), std::declval<G>()));
+
+  static constexpr bool parallel()
+  {
+    return not std::is_same<P, Sequenced>::value and std::is_base_of<
+      std::random_access_iterator_tag,
+      typename std::iterator_traits<iterator>::iterator_category
+      >::value;
+  }
+
+  // body(i, x) for each element x at index i
+  template <typename Body>
+  void run(const Body& body) const
+  {
+    if constexpr (parallel()) {
+      const auto first = std::begin(_source);
+      const std::size_t n = size();
+      const std::size_t nchunks = (n + Grain - 1) / Grain;
+      ThreadPool::shared().parallelFor(nchunks, [&] (const std::size_t c) {
+          const std::size_t end = std::min(n, (c + 1) * Grain);
+          if constexpr (std::is_same<P, ParallelUnsequenced>::value) {
+#pragma GCC ivdep
+            for (std::size_t i = c * Grain; i < end; ++i) body(i, first[i]);
+          } else {
+            for (std::size_t i = c * Grain; i < end; ++i) body(i, first[i]);
+          }
+        }
+      );
+    } else {
+      std::size_t i = 0;
+      for (auto&& x : _source) body(i++, x);
+    }
+  }
+
+  Source _source;
+  Fn _fn;
+};
+
+template <typename C>
+using is_container = std::integral_constant<
+  bool,
+  is_range<std::decay_t<C> >::value and
+  not std::is_base_of<Pipelined, std::decay_t<C> >::value
+  >;
+
+// xs > f starts a sequential pipeline
+template <
+  typename C,
+  typename F,
+  typename = std::enable_if_t<is_container<C>::value>,
+  typename = std::enable_if_t<
+    std::is_invocable<const F&, decltype(*std::begin(std::declval<const C&>()))>::value
+    >
+  >
+auto operator > (C&& xs, F f)
+{
+  return seq(std::forward<C>(xs)) > std::move(f);
+}
+
+template <
+  typename Source,
+  typename Fn,
+  typename P,
+  typename G,
+  typename = std::enable_if_t<
+    std::is_invocable<const G&, typename Pipeline<Source, Fn, P>::result_type>::value
+    >
+  >
+auto operator > (Pipeline<Source, Fn, P> p, G g)
+{
+  using R = std::invoke_result_t<const G&, typename Pipeline<Source, Fn, P>::result_type>;
+  if constexpr (std::is_void<R>::value) p.for_each(g);
+  else return std::move(p).then(std::move(g));
+}
+
+} // end namespace category
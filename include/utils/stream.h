@@ -0,0 +1,201 @@
+//a lazy stream, haskell style
+//the head of a stream is a value, its tail a thunk that is evaluated
+//at most once, when the tail is asked for, and remembered after that.
+
+#pragma once
+#include "monadic.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace Monadic {
+
+template<typename T>
+class Stream
+{
+public:
+	using type = T;
+	using value_type = T;
+	using Thunk = std::function< Stream<T>() >;
+
+	class const_iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		const_iterator() = default;
+		explicit const_iterator(const Stream<T>& s) : _s(s) {}
+
+		reference operator*() const { return _s.head();}
+		pointer operator->() const { return &(_s.head());}
+		const_iterator& operator++()
+		{
+			_s = _s.tail();
+			return *this;
+		}
+		bool operator==(const const_iterator& that) const { return _s._cell == that._s._cell;}
+		bool operator!=(const const_iterator& that) const { return _s._cell != that._s._cell;}
+	private:
+		Stream<T> _s;
+	};
+
+	Stream() = default;
+	Stream(const T& head, Thunk tail) :
+		_cell(std::make_shared<Cell>(head, std::move(tail)))
+	{}
+
+	bool empty() const { return not _cell;}
+
+	const T& head() const
+	{
+		if (not _cell) throw std::out_of_range("head of an empty stream");
+		return _cell->head;
+	}
+	Stream<T> tail() const
+	{
+		if (not _cell) throw std::out_of_range("tail of an empty stream");
+		return _cell->force();
+	}
+	//has the tail been evaluated
+	bool forced() const { return _cell and _cell->forced.load(std::memory_order_acquire);}
+
+	//iterating over an infinite stream will not end
+	const_iterator begin() const { return const_iterator(*this);}
+	const_iterator end() const { return const_iterator();}
+
+private:
+	struct Cell;
+	std::shared_ptr<Cell> _cell;
+};
+
+template<typename T>
+struct Stream<T>::Cell
+{
+	Cell(const T& h, Thunk t) :
+		head(h),
+		thunk(std::move(t))
+	{}
+
+	//unlink the forced cells that only we hold on to one by one,
+	//a long stream should not be destroyed recursively
+	~Cell()
+	{
+		auto next = std::move(tail._cell);
+		while (next and next.use_count() == 1) next = std::move(next->tail._cell);
+	}
+
+	const Stream<T>& force()
+	{
+		std::call_once(once, [this] () {
+				tail = thunk();
+				thunk = nullptr;
+				forced.store(true, std::memory_order_release);
+			}
+		);
+		return tail;
+	}
+
+	const T head;
+	Thunk thunk;
+	Stream<T> tail;
+	std::once_flag once;
+	//set once tail is there, that forced() reads
+	//while another thread may be forcing the cell
+	std::atomic<bool> forced{false};
+};
+
+//an infinite stream x, f(x), f(f(x)), ...
+template<typename T, typename F>
+inline Stream<T> iterate(const T& x, const F& f)
+{
+	return Stream<T>(x, [=] () { return iterate(f(x), f);});
+}
+
+//a stream over the elements of a container,
+//that should outlive the stream
+template<typename It>
+inline Stream<typename std::iterator_traits<It>::value_type> stream(It first, It last)
+{
+	using T = typename std::iterator_traits<It>::value_type;
+	if (first == last) return Stream<T>();
+	return Stream<T>(*first, [=] () { return stream(std::next(first), last);});
+}
+
+template<
+	typename T,
+	typename F,
+	typename S = typename std::result_of<F&(T)>::type
+>
+inline Stream<S> map(const F f, const Stream<T>& ts)
+{
+	if (ts.empty()) return Stream<S>();
+	return Stream<S>(f(ts.head()), [=] () { return map(f, ts.tail());});
+}
+
+//filter evaluates the stream upto its first match
+template<typename T, typename P>
+inline Stream<T> filter(const P pred, Stream<T> ts)
+{
+	while (not ts.empty() and not pred(ts.head())) ts = ts.tail();
+	if (ts.empty()) return ts;
+	return Stream<T>(ts.head(), [=] () { return filter(pred, ts.tail());});
+}
+
+template<typename T>
+inline Stream<T> take(const std::size_t n, const Stream<T>& ts)
+{
+	if (n == 0 or ts.empty()) return Stream<T>();
+	//the last element taken should not force the rest
+	return Stream<T>(ts.head(), [=] () {
+			return n == 1 ? Stream<T>() : take(n - 1, ts.tail());
+		}
+	);
+}
+
+template<typename T, typename S>
+inline Stream< std::pair<T, S> > zip(const Stream<T>& ts, const Stream<S>& ss)
+{
+	if (ts.empty() or ss.empty()) return Stream< std::pair<T, S> >();
+	return Stream< std::pair<T, S> >(
+		std::make_pair(ts.head(), ss.head()),
+		[=] () { return zip(ts.tail(), ss.tail());}
+	);
+}
+
+//the elements of ts, followed by those of the stream that rest evaluates to
+template<typename T>
+inline Stream<T> append(const Stream<T>& ts, const typename Stream<T>::Thunk& rest)
+{
+	if (ts.empty()) return rest();
+	return Stream<T>(ts.head(), [=] () { return append(ts.tail(), rest);});
+}
+
+//bind
+template<
+	typename T,
+	typename F,
+	typename SS = typename std::result_of<F&(T)>::type,
+	typename S = typename SS::value_type
+>
+inline Stream<S> operator >>= (Stream<T> ts, const F& fst)
+{
+	//skip the elements that bind to nothing, without recursion
+	Stream<S> ss;
+	while (not ts.empty() and (ss = fst(ts.head())).empty()) ts = ts.tail();
+	if (ts.empty()) return ss;
+	return append(ss, [=] () { return ts.tail() >>= fst;});
+}
+
+//evaluate a (finite) stream into a strict list
+template<typename T>
+inline List<T> toList(const Stream<T>& ts)
+{
+	return List<T>(std::begin(ts), std::end(ts));
+}
+
+} /* namespace Monadic */
@@ -0,0 +1,306 @@
+//tasks: values computed in the background, on a ThreadPool.
+//a Task is a monad, with unit, fmap and bind (>>=), and tasks started
+//independently can be joined with when_all. each stage is a job of its own
+//type, started by the task it depends on when that is done,
+//without a thread waiting in between, and without a std::function.
+//an exception thrown by a stage is passed on to the stages after it,
+//and rethrown by get().
+
+#pragma once
+#include "threadpool.h"
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace Async {
+
+template<typename T>
+class Task;
+
+//the result of a task, and the stages to start when it is there.
+//a stage is given the state when it runs, and holds no reference to it
+//before that, so that the stages of a task that is never done
+//are freed with it
+template<typename T>
+struct TaskState : std::enable_shared_from_this< TaskState<T> >
+{
+	struct Continuation
+	{
+		virtual ~Continuation() = default;
+		virtual void run(TaskState& from) = 0;
+	};
+
+	explicit TaskState(ThreadPool& p) : pool(p) {}
+
+	//f(*this) runs on the pool once the task is done
+	template<typename F>
+	void then(F f)
+	{
+		std::unique_ptr<Continuation> c(new Call<F>(std::move(f)));
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (not ready) {
+				continuations.push_back(std::move(c));
+				return;
+			}
+		}
+		start(std::move(c));
+	}
+
+	void set(T x)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		value.emplace(std::move(x));
+		finish(lock);
+	}
+
+	void fail(std::exception_ptr e)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		error = e;
+		finish(lock);
+	}
+
+	void finish(std::unique_lock<std::mutex>& lock)
+	{
+		ready = true;
+		std::vector< std::unique_ptr<Continuation> > next;
+		next.swap(continuations);
+		lock.unlock();
+		pool.wake();
+		for (auto& c : next) start(std::move(c));
+	}
+
+	bool done()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return ready;
+	}
+
+	ThreadPool& pool;
+	std::mutex mutex;
+	bool ready = false;
+	std::optional<T> value;
+	std::exception_ptr error;
+	std::vector< std::unique_ptr<Continuation> > continuations;
+
+private:
+	template<typename F>
+	struct Call : Continuation
+	{
+		explicit Call(F g) : f(std::move(g)) {}
+		void run(TaskState& from) override { f(from);}
+		F f;
+	};
+
+	void start(std::unique_ptr<Continuation> c)
+	{
+		pool.submit([self = this->shared_from_this(), c = std::move(c)] () { c->run(*self);});
+	}
+};
+
+template<typename T>
+class Task
+{
+public:
+	static_assert(not std::is_void<T>::value, "a Task needs a value");
+	using type = T;
+	using State = TaskState<T>;
+
+	Task() = default;
+	explicit Task(std::shared_ptr<State> state) : _state(std::move(state)) {}
+
+	bool valid() const { return bool(_state);}
+
+	bool ready() const { return _state->done();}
+
+	//wait for the value, running other jobs of the pool while there are
+	//some, so that get() may be called from inside a task
+	const T& get() const
+	{
+		State& s = *_state;
+		s.pool.helpUntil([&s] () { return s.done();});
+		if (s.error) std::rethrow_exception(s.error);
+		return *s.value;
+	}
+
+	//fmap
+	template<
+		typename F,
+		typename S = std::decay_t< std::invoke_result_t<F&, const T&> >
+	>
+	Task<S> map(F f) const
+	{
+		auto next = std::make_shared< TaskState<S> >(_state->pool);
+		_state->then([next, f = std::move(f)] (State& from) mutable {
+				if (from.error) return next->fail(from.error);
+				try {
+					next->set(f(*from.value));
+				} catch (...) {
+					next->fail(std::current_exception());
+				}
+			}
+		);
+		return Task<S>(next);
+	}
+
+	//bind, f returns a Task
+	template<
+		typename F,
+		typename TS = std::invoke_result_t<F&, const T&>,
+		typename S = typename TS::type
+	>
+	Task<S> then(F f) const
+	{
+		auto next = std::make_shared< TaskState<S> >(_state->pool);
+		_state->then([next, f = std::move(f)] (State& from) mutable {
+				if (from.error) return next->fail(from.error);
+				try {
+					const Task<S> inner = f(*from.value);
+					if (not inner.valid())
+						throw std::invalid_argument("a stage returned a Task with no state");
+					inner._state->then([next] (TaskState<S>& last) {
+							if (last.error) next->fail(last.error);
+							else next->set(*last.value);
+						}
+					);
+				} catch (...) {
+					next->fail(std::current_exception());
+				}
+			}
+		);
+		return Task<S>(next);
+	}
+
+private:
+	template<typename S>
+	friend class Task;
+
+	template<typename... Ts>
+	friend Task< std::tuple<Ts...> > when_all(const Task<Ts>&... ts);
+
+	template<typename S>
+	friend Task< std::vector<S> > when_all(const std::vector< Task<S> >& ts);
+
+	std::shared_ptr<State> _state;
+};
+
+//f() in the background
+template<
+	typename F,
+	typename T = std::decay_t< std::invoke_result_t<F&> >
+>
+inline Task<T> async(F f, ThreadPool& pool = ThreadPool::shared())
+{
+	auto state = std::make_shared< TaskState<T> >(pool);
+	pool.submit([state, f = std::move(f)] () mutable {
+			try {
+				state->set(f());
+			} catch (...) {
+				state->fail(std::current_exception());
+			}
+		}
+	);
+	return Task<T>(state);
+}
+
+//a task that is already done
+template<typename T>
+inline Task< std::decay_t<T> > unit(T&& x, ThreadPool& pool = ThreadPool::shared())
+{
+	auto state = std::make_shared< TaskState< std::decay_t<T> > >(pool);
+	state->value.emplace(std::forward<T>(x));
+	state->ready = true;
+	return Task< std::decay_t<T> >(state);
+}
+
+template<typename F, typename T>
+inline auto fmap(F f, const Task<T>& t)
+{
+	return t.map(std::move(f));
+}
+
+template<typename T, typename F>
+inline auto operator >>= (const Task<T>& t, F f)
+{
+	return t.then(std::move(f));
+}
+
+//the values of tasks joined, or their errors, as they are done,
+//held apart from the tasks so that a task never done is not kept alive
+//by the stages it starts
+template<typename... Ts>
+struct Joined
+{
+	using R = std::tuple<Ts...>;
+
+	explicit Joined(ThreadPool& pool) : next(std::make_shared< TaskState<R> >(pool)) {}
+
+	template<std::size_t I, typename T>
+	void take(TaskState<T>& from)
+	{
+		if (from.error) errors[I] = from.error;
+		else std::get<I>(values).emplace(*from.value);
+		if (--remaining != 0) return;
+		for (const auto& e : errors)
+			if (e) return next->fail(e);
+		next->set(std::apply([] (auto&... v) { return R(std::move(*v)...);}, values));
+	}
+
+	std::tuple< std::optional<Ts>... > values;
+	std::exception_ptr errors[sizeof...(Ts)];
+	std::atomic<std::size_t> remaining {sizeof...(Ts)};
+	const std::shared_ptr< TaskState<R> > next;
+};
+
+template<typename... Ts, std::size_t... Is>
+inline void joinEach(const std::shared_ptr< Joined<Ts...> >& joined, std::index_sequence<Is...>,
+                     const std::shared_ptr< TaskState<Ts> >&... states)
+{
+	(states->then([joined] (TaskState<Ts>& from) { joined->template take<Is>(from);}), ...);
+}
+
+//the values of all the tasks, once they are all done.
+//the first error found, in argument order, fails the whole
+template<typename... Ts>
+inline Task< std::tuple<Ts...> > when_all(const Task<Ts>&... ts)
+{
+	static_assert(sizeof...(Ts) > 0, "when_all of no task");
+	ThreadPool& pool = std::get<0>(std::forward_as_tuple(ts...))._state->pool;
+	auto joined = std::make_shared< Joined<Ts...> >(pool);
+	joinEach(joined, std::index_sequence_for<Ts...>(), ts._state...);
+	return Task< std::tuple<Ts...> >(joined->next);
+}
+
+template<typename T>
+inline Task< std::vector<T> > when_all(const std::vector< Task<T> >& ts)
+{
+	if (ts.empty()) return unit(std::vector<T>());
+	struct Values
+	{
+		explicit Values(const std::size_t n) : values(n), errors(n), remaining(n) {}
+		std::vector< std::optional<T> > values;
+		std::vector<std::exception_ptr> errors;
+		std::atomic<std::size_t> remaining;
+	};
+	auto next = std::make_shared< TaskState< std::vector<T> > >(ts.front()._state->pool);
+	auto joined = std::make_shared<Values>(ts.size());
+	for (std::size_t i = 0; i != ts.size(); ++i)
+		ts[i]._state->then([joined, next, i] (TaskState<T>& from) {
+				if (from.error) joined->errors[i] = from.error;
+				else joined->values[i].emplace(*from.value);
+				if (--joined->remaining != 0) return;
+				for (const auto& e : joined->errors)
+					if (e) return next->fail(e);
+				std::vector<T> values;
+				values.reserve(joined->values.size());
+				for (auto& v : joined->values) values.push_back(std::move(*v));
+				next->set(std::move(values));
+			}
+		);
+	return Task< std::vector<T> >(next);
+}
+
+} /* namespace Async */
@@ -0,0 +1,149 @@
+//a pool of worker threads, shared by the parallel combinators
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	//a unit of work, run once by the pool and deleted after that
+	struct Job
+	{
+		virtual ~Job() = default;
+		virtual void run() = 0;
+	};
+
+	explicit ThreadPool(const unsigned nthreads);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	//one pool for the whole program,
+	//with as many workers as there are hardware threads
+	static ThreadPool& shared();
+
+	unsigned size() const { return (unsigned) _workers.size();}
+
+	//a job that calls f, without going through a std::function
+	template<typename F>
+	static Job* job(F f) { return new Call<F>(std::move(f));}
+
+	template<typename F>
+	void submit(F f) { push(job(std::move(f)));}
+
+	//each worker has a queue of its own. jobs pushed from a worker
+	//go to its queue, that it runs last in first out, others go round
+	//the queues; a worker with nothing left steals the oldest job of another
+	void push(Job* job);
+
+	//run one waiting job, if there is any, on the calling thread.
+	//a thread that waits for a result can help instead of blocking.
+	bool runPending();
+
+	//run waiting jobs on the calling thread until done() holds,
+	//and sleep while there are none, instead of polling.
+	//whatever makes done() hold calls wake() after that.
+	template<typename Done>
+	void helpUntil(const Done& done);
+
+	//have the threads in helpUntil look at their condition again
+	void wake();
+
+	//run f(i) for each i in [0, n), and wait for all of them.
+	//the calling thread works on the indexes too, so a parallelFor
+	//called from inside a worker does not deadlock the pool.
+	//the first exception thrown by f is rethrown here.
+	template<typename F>
+	void parallelFor(const std::size_t n, const F& f);
+
+private:
+	template<typename F>
+	struct Call : Job
+	{
+		explicit Call(F g) : f(std::move(g)) {}
+		void run() override { f();}
+		F f;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Job*> jobs;
+	};
+
+	unsigned home() const;
+	Job* take(const unsigned home);
+	void work(const unsigned index);
+
+	std::vector<std::thread> _workers;
+	std::vector<Queue> _queues;
+	std::atomic<unsigned> _next {0};
+	//jobs pushed and not yet taken
+	std::atomic<std::size_t> _pending {0};
+	std::mutex _mutex;
+	std::condition_variable _ready;
+	bool _stopping = false;
+	//threads asleep in helpUntil
+	unsigned _helping = 0;
+};
+
+template<typename Done>
+void ThreadPool::helpUntil(const Done& done)
+{
+	while (not done()) {
+		if (runPending()) continue;
+		std::unique_lock<std::mutex> lock(_mutex);
+		++_helping;
+		_ready.wait(lock, [this, &done] () { return _pending > 0 or done();});
+		--_helping;
+	}
+}
+
+template<typename F>
+void ThreadPool::parallelFor(const std::size_t n, const F& f)
+{
+	if (n == 0) return;
+
+	struct State
+	{
+		std::atomic<std::size_t> next {0};
+		std::atomic<std::size_t> done {0};
+		std::mutex mutex;
+		std::condition_variable finished;
+		std::exception_ptr error;
+	};
+	//helpers that start late find nothing left to do,
+	//but may still look at the state after we have returned
+	auto state = std::make_shared<State>();
+
+	auto run = [state, n, &f] () {
+		for (std::size_t i = state->next++; i < n; i = state->next++) {
+			try {
+				f(i);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(state->mutex);
+				if (not state->error) state->error = std::current_exception();
+			}
+			if (++state->done == n) {
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->finished.notify_all();
+			}
+		}
+	};
+
+	const std::size_t nhelpers = std::min<std::size_t>(n - 1, size());
+	for (std::size_t h = 0; h != nhelpers; ++h) submit(run);
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state, n] () { return state->done == n;});
+	if (state->error) std::rethrow_exception(state->error);
+}
@@ -0,0 +1,85 @@
+//a trampoline, to run tail recursive functions in constant stack.
+//instead of calling itself, a function returns again(args...),
+//the arguments of its next call, or done(x), its result.
+//run calls the function in a loop until it is done:
+//
+//	const auto factorial = [] (int n, long acc) -> Bounce<long, int, long> {
+//		if (n == 0) return done(acc);
+//		return again(n - 1, n * acc);
+//	};
+//	run(factorial, 20, 1L);
+//
+//a bounce holds the arguments in place, so a step allocates nothing.
+//recursions that are not tail calls, such as n * fact(n - 1),
+//move what is left to do into an accumulating argument first.
+
+#pragma once
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+template<typename T>
+struct Done
+{
+	T value;
+};
+
+template<typename... Args>
+struct Again
+{
+	std::tuple<Args...> args;
+};
+
+template<typename T>
+inline Done< std::decay_t<T> > done(T&& x)
+{
+	return Done< std::decay_t<T> >{std::forward<T>(x)};
+}
+
+template<typename... Args>
+inline Again< std::decay_t<Args>... > again(Args&&... args)
+{
+	return Again< std::decay_t<Args>... >{
+		std::tuple< std::decay_t<Args>... >(std::forward<Args>(args)...)
+	};
+}
+
+//the result T of a function of Args...,
+//or the arguments to call it with once more
+template<typename T, typename... Args>
+class Bounce
+{
+public:
+	using type = T;
+
+	template<typename S>
+	Bounce(Done<S>&& d) :
+		_state(std::in_place_index<0>, std::move(d.value))
+	{}
+
+	template<typename... Ss>
+	Bounce(Again<Ss...>&& a) :
+		_state(std::in_place_index<1>, std::move(a.args))
+	{}
+
+	bool finished() const { return _state.index() == 0;}
+
+	T& result() { return std::get<0>(_state);}
+	std::tuple<Args...>& arguments() { return std::get<1>(_state);}
+
+private:
+	std::variant< T, std::tuple<Args...> > _state;
+};
+
+template<typename F, typename... Args>
+inline auto run(const F& f, Args&&... args)
+{
+	auto bounce = f(std::forward<Args>(args)...);
+	while (not bounce.finished()) {
+		//the arguments are moved out before the bounce is overwritten
+		auto next = std::move(bounce.arguments());
+		bounce = std::apply(f, std::move(next));
+	}
+	return std::move(bounce.result());
+}
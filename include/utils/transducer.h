@@ -0,0 +1,175 @@
+//transducers: map / filter / take, composed before they are applied.
+//a chain such as mapping(f) | filtering(p) | taking(n) runs over
+//its source as a single loop, without an intermediate container
+//between the stages, and stops as soon as a stage is done.
+
+#pragma once
+#include "util.h"
+#include <type_traits>
+
+namespace Monadic {
+
+//a transducer wraps a step function into another step function.
+//a step is called as step(acc, x), and returns false
+//when no more input is wanted.
+//steps may hold state (taking counts), and are created afresh
+//for every run, so a transducer itself can be reused.
+struct TransducerTag {};
+
+template<typename X>
+using is_transducer = std::is_base_of<TransducerTag, X>;
+
+template<typename F>
+struct Mapping : TransducerTag
+{
+	F f;
+
+	template<typename Step>
+	auto wrap(Step step) const
+	{
+		return [f = f, step] (auto& acc, auto&& x) mutable {
+			return step(acc, f(std::forward<decltype(x)>(x)));
+		};
+	}
+};
+
+template<typename P>
+struct Filtering : TransducerTag
+{
+	P pred;
+
+	template<typename Step>
+	auto wrap(Step step) const
+	{
+		return [pred = pred, step] (auto& acc, auto&& x) mutable {
+			if (not pred(x)) return true;
+			return step(acc, std::forward<decltype(x)>(x));
+		};
+	}
+};
+
+struct Taking : TransducerTag
+{
+	std::size_t n;
+
+	template<typename Step>
+	auto wrap(Step step) const
+	{
+		return [n = n, step] (auto& acc, auto&& x) mutable {
+			if (n == 0) return false;
+			--n;
+			return step(acc, std::forward<decltype(x)>(x)) and n > 0;
+		};
+	}
+};
+
+template<typename P>
+struct TakingWhile : TransducerTag
+{
+	P pred;
+
+	template<typename Step>
+	auto wrap(Step step) const
+	{
+		return [pred = pred, step] (auto& acc, auto&& x) mutable {
+			if (not pred(x)) return false;
+			return step(acc, std::forward<decltype(x)>(x));
+		};
+	}
+};
+
+//first applies to the input, and passes its output to second
+template<typename First, typename Second>
+struct Composed : TransducerTag
+{
+	First first;
+	Second second;
+
+	template<typename Step>
+	auto wrap(Step step) const
+	{
+		return first.wrap(second.wrap(step));
+	}
+};
+
+template<typename F>
+inline Mapping<F> mapping(const F& f) { return Mapping<F>{{}, f};}
+
+template<typename P>
+inline Filtering<P> filtering(const P& pred) { return Filtering<P>{{}, pred};}
+
+inline Taking taking(const std::size_t n) { return Taking{{}, n};}
+
+template<typename P>
+inline TakingWhile<P> taking_while(const P& pred) { return TakingWhile<P>{{}, pred};}
+
+template<
+	typename First,
+	typename Second,
+	typename = std::enable_if_t<
+		is_transducer<First>::value and is_transducer<Second>::value
+	>
+>
+inline Composed<First, Second> operator | (const First& first, const Second& second)
+{
+	return Composed<First, Second>{{}, first, second};
+}
+
+//run a transducer over any source that a range-for can walk:
+//std containers, List, Chunked, Stream, View, Kmer, DataFrame columns.
+//sources are taken by forwarding reference, some of them
+//(View, Kmer) can only be iterated when they are not const.
+template<
+	typename Xf,
+	typename Step,
+	typename Acc,
+	typename Source
+>
+inline Acc transduce(const Xf& xf, const Step& step, Acc acc, Source&& source)
+{
+	auto run = xf.wrap(step);
+	for (auto&& x : source)
+		if (not run(acc, x)) break;
+	return acc;
+}
+
+//fold with f(acc, x) -> acc
+template<
+	typename Xf,
+	typename F,
+	typename Acc,
+	typename Source
+>
+inline Acc fold(const Xf& xf, const F& f, Acc acc, Source&& source)
+{
+	return transduce(
+		xf,
+		[&f] (Acc& a, auto&& x) {
+			a = f(std::move(a), std::forward<decltype(x)>(x));
+			return true;
+		},
+		std::move(acc),
+		std::forward<Source>(source)
+	);
+}
+
+//collect into a container
+template<
+	typename Container,
+	typename Xf,
+	typename Source
+>
+inline Container into(Container out, const Xf& xf, Source&& source)
+{
+	return transduce(
+		xf,
+		[] (Container& c, auto&& x) {
+			c.insert(std::end(c), std::forward<decltype(x)>(x));
+			return true;
+		},
+		std::move(out),
+		std::forward<Source>(source)
+	);
+}
+
+} /* namespace Monadic */
@@ -7,14 +7,19 @@
 #include <iostream>
 #include <sstream>
 #include <map>
+#include <memory>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <algorithm>
 #include <numeric>
 #include <string>
+#include <string_view>
 #include <limits>
 #include <tuple>
 #include<unordered_map>
+#include "maybe.h"
 
 using uint = uint32_t;
 
@@ -165,6 +170,38 @@ static std::tuple<> getTupleValue(ResType, uint) {
 	return std::tuple<>();
 }
 
+//results that can be read a batch of rows at a time,
+//with a nextBatch(n) as that of the database simulator (see RdbBatch)
+template<class ResType, typename = void>
+struct has_batches : std::false_type {};
+
+template<class ResType>
+struct has_batches<
+	ResType,
+	std::void_t<decltype(std::declval<ResType&>()->nextBatch(1U))>
+> : std::true_type {};
+
+//rows read per batch by the loaders
+const uint defaultBatchRows = 4096;
+
+//append the rows of a batch to a vector of tuples, a column at a time
+template<typename... Args, class Batch, std::size_t... J>
+void appendBatchRows(
+	std::vector< std::tuple<Args...> >& rows,
+	const Batch& batch,
+	std::index_sequence<J...>
+) {
+	const std::size_t first = rows.size();
+	rows.resize(first + batch.nrow);
+	const auto fill = [&] (auto j) {
+		using T = typename std::tuple_element<decltype(j)::value, std::tuple<Args...> >::type;
+		const auto& column = batch.columns[decltype(j)::value];
+		for (std::size_t i = 0; i != batch.nrow; ++i)
+			std::get<decltype(j)::value>(rows[first + i]) = column.template get<T>(i);
+	};
+	(fill(std::integral_constant<std::size_t, J>()), ...);
+}
+
 
 template<typename... Args>
 struct ValueType {
@@ -219,29 +256,6 @@ auto extended_tuple(std::tuple<T> t) {
 template < typename T >
 T trivial() ;
 
-template < typename T >
-class Maybe {
-	virtual bool isValid() = 0;
-	virtual T get() = 0;
-};
-
-template < typename T >
-class None : public Maybe<T> {
-public:
-	bool isValid() { return false;}
-	T get() { throw std::invalid_argument("None does not contain any elements"); }
-};
-
-template < typename T >
-class Valid : public Maybe<T> {
-public:
-	Valid(const T& e) : _elem(e) {}
-	bool isValid() {return true;}
-	const T get() const { return _elem; }
-private:
-	const T _elem;
-};
-
 template<typename... As> struct Tower;
 
 template<typename A> struct Tower<A> {
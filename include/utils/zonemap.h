@@ -0,0 +1,106 @@
+//zone maps: the smallest and the largest value, and the number of nulls,
+//of each block of rows of a column, of a fixed number of rows.
+//
+//  ZoneMap<double> zones(1 << 16);
+//  for (const double x: prices) zones.append(x);
+//  for (std::size_t b = 0; b != zones.size(); ++b)
+//    if (zones.mayHold(b, 100.0, true, 200.0, false)) ...scan block b
+//
+//a scan with a range, or an equality, then skips the blocks that hold no
+//value in it, without reading them. rows appended in the order of a column,
+//as those of a time series are, leave few blocks with a range of their own
+//that overlaps that of a scan.
+//a null is a NaN, equal to nothing, and in no range.
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+//the rows of a block of a zone map, unless it is given another number
+const std::size_t defaultZoneRows = std::size_t(1) << 16;
+
+template <typename T>
+class ZoneMap
+{
+public:
+  //the values of a block of rows, of which min and max are
+  //those of the values that are not null, when there are some
+  struct Zone
+  {
+    T min{};
+    T max{};
+    std::size_t nulls = 0;
+    std::size_t rows = 0;
+
+    bool empty() const { return nulls == rows;}
+  };
+
+  explicit ZoneMap(const std::size_t blockRows = defaultZoneRows) :
+    _blockRows(std::max<std::size_t>(blockRows, 1)) {}
+
+  //the value of the next row
+  void append(const T& x)
+  {
+    if (_rows % _blockRows == 0) _zones.emplace_back();
+    ++_rows;
+    Zone& z = _zones.back();
+    ++z.rows;
+    if constexpr (std::is_floating_point<T>::value)
+      if (x != x) {
+        ++z.nulls;
+        return;
+      }
+    if (z.rows == z.nulls + 1) {
+      z.min = z.max = x;
+      return;
+    }
+    if (x < z.min) z.min = x;
+    if (z.max < x) z.max = x;
+  }
+
+  void clear()
+  {
+    _zones.clear();
+    _rows = 0;
+  }
+
+  std::size_t blockRows() const { return _blockRows;}
+  //how many values were appended
+  std::size_t rows() const { return _rows;}
+  //how many blocks they take
+  std::size_t size() const { return _zones.size();}
+  const Zone& zone(const std::size_t block) const { return _zones[block];}
+  //the rows of a block, from first to 1 past its last one
+  std::size_t first(const std::size_t block) const { return block * _blockRows;}
+  std::size_t last(const std::size_t block) const { return first(block) + _zones[block].rows;}
+
+  //whether a block may hold values from low to high, with no bound
+  //on a side without one, as the range of a sorted index (see RdbKeyIndex)
+  bool mayHold(const std::size_t block, const std::optional<T>& low, const bool lowIncluded,
+               const std::optional<T>& high, const bool highIncluded) const
+  {
+    const Zone& z = _zones[block];
+    if (z.empty()) return false;
+    if (low and (lowIncluded ? z.max < *low : not (*low < z.max))) return false;
+    if (high and (highIncluded ? *high < z.min : not (z.min < *high))) return false;
+    return true;
+  }
+
+  //the blocks that may hold values from low to high
+  std::vector<std::size_t> blocks(const std::optional<T>& low, const bool lowIncluded,
+                                  const std::optional<T>& high, const bool highIncluded) const
+  {
+    std::vector<std::size_t> found;
+    for (std::size_t b = 0; b != _zones.size(); ++b)
+      if (mayHold(b, low, lowIncluded, high, highIncluded)) found.push_back(b);
+    return found;
+  }
+
+private:
+  std::size_t _blockRows;
+  std::size_t _rows = 0;
+  std::vector<Zone> _zones;
+};
@@ -0,0 +1,275 @@
+#include "util.h"
+#include "datatypes.h"
+#include "RelationalDatabaseSim.h"
+#include "RdbEncoding.h"
+#include <cstring>
+#include <unordered_map>
+
+
+namespace {
+  //the bytes of the values of a plain column
+  std::size_t plainBytes(const RdbColumn& c) {
+    switch (c.type) {
+    case ColumnType::Double: return c.doubles.size() * sizeof(double);
+    case ColumnType::Int: return c.ints.size() * sizeof(int);
+    case ColumnType::UInt: return c.uints.size() * sizeof(uint);
+    case ColumnType::String: return c.blob.size() + c.offsets.size() * sizeof(std::size_t);
+    }
+    return 0;
+  }
+
+  //the bytes of a code, for codes up to largest
+  uint codeWidth(const uint64_t largest) {
+    if (largest <= 0xff) return 1;
+    if (largest <= 0xffff) return 2;
+    return 4;
+  }
+
+  //whether row i of a plain column and row j of another have the same value.
+  //doubles are the same when their bits are, so that they decode as they were.
+  bool sameValue(const RdbColumn& c, const std::size_t i,
+                 const RdbColumn& d, const std::size_t j) {
+    switch (c.type) {
+    case ColumnType::Double: return std::memcmp(&c.doubles[i], &d.doubles[j], sizeof(double)) == 0;
+    case ColumnType::Int: return c.ints[i] == d.ints[j];
+    case ColumnType::UInt: return c.uints[i] == d.uints[j];
+    case ColumnType::String: return c.stringView(i) == d.stringView(j);
+    }
+    return false;
+  }
+
+  //the value at v of a plain column, count times
+  void appendRepeated(RdbColumn& out, const RdbColumn& values, const std::size_t v,
+                      const std::size_t count) {
+    switch (out.type) {
+    case ColumnType::Double: out.doubles.insert(out.doubles.end(), count, values.doubles[v]); break;
+    case ColumnType::Int: out.ints.insert(out.ints.end(), count, values.ints[v]); break;
+    case ColumnType::UInt: out.uints.insert(out.uints.end(), count, values.uints[v]); break;
+    case ColumnType::String: {
+      const std::string_view x = values.stringView(v);
+      for (std::size_t i = 0; i != count; ++i) {
+        out.blob.append(x);
+        out.offsets.push_back(out.blob.size());
+      }
+      break;
+    }
+    }
+  }
+}
+
+std::shared_ptr<const RdbEncodedColumn>
+RdbEncodedColumn::encode(const RdbColumn& column) {
+  if (column.encoded) return column.encoded;
+  const std::size_t n = column.size();
+  if (n == 0) return nullptr;
+  const std::size_t plain = plainBytes(column);
+
+  //runs, and the first row of each of them
+  std::vector<uint> ends;
+  std::vector<uint> starts{0};
+  for (uint i = 1; i != n; ++i)
+    if (not sameValue(column, i - 1, column, i)) {
+      ends.push_back(i);
+      starts.push_back(i);
+    }
+  ends.push_back((uint) n);
+  const std::size_t nruns = ends.size();
+  std::size_t runBytes = nruns * sizeof(uint);
+  switch (column.type) {
+  case ColumnType::Double: runBytes += nruns * sizeof(double); break;
+  case ColumnType::Int: runBytes += nruns * sizeof(int); break;
+  case ColumnType::UInt: runBytes += nruns * sizeof(uint); break;
+  case ColumnType::String:
+    runBytes += (nruns + 1) * sizeof(std::size_t);
+    for (const uint r: starts) runBytes += column.stringView(r).size();
+    break;
+  }
+
+  //a dictionary of the strings, with codes in the order they first come in
+  std::vector<uint32_t> codes;
+  std::vector<uint> firsts;
+  std::size_t dictionaryBytes = std::numeric_limits<std::size_t>::max();
+  if (column.type == ColumnType::String) {
+    std::unordered_map<std::string_view, uint32_t> dictionary;
+    codes.reserve(n);
+    std::size_t blob = 0;
+    for (uint i = 0; i != n; ++i) {
+      const std::string_view x = column.stringView(i);
+      const auto found = dictionary.emplace(x, (uint32_t) firsts.size());
+      if (found.second) {
+        firsts.push_back(i);
+        blob += x.size();
+      }
+      codes.push_back(found.first->second);
+    }
+    dictionaryBytes = blob + (firsts.size() + 1) * sizeof(std::size_t) +
+      n * codeWidth(firsts.size() - 1);
+  }
+
+  //integers as offsets from the smallest of them
+  int64_t low = 0, high = 0;
+  std::size_t offsetBytes = std::numeric_limits<std::size_t>::max();
+  if (column.type == ColumnType::Int or column.type == ColumnType::UInt) {
+    const auto value = [&column] (const std::size_t i) {
+      return column.type == ColumnType::Int ? (int64_t) column.ints[i] : (int64_t) column.uints[i];
+    };
+    low = high = value(0);
+    for (std::size_t i = 1; i != n; ++i) {
+      low = std::min(low, value(i));
+      high = std::max(high, value(i));
+    }
+    const uint width = codeWidth((uint64_t) (high - low));
+    if (width < 4) {
+      offsetBytes = n * width;
+      codes.resize(n);
+      for (std::size_t i = 0; i != n; ++i) codes[i] = (uint32_t) (value(i) - low);
+    }
+  }
+
+  const std::size_t best = std::min({runBytes, dictionaryBytes, offsetBytes});
+  if (best >= plain) return nullptr;
+  std::shared_ptr<RdbEncodedColumn> e;
+  if (best == runBytes) {
+    e.reset(new RdbEncodedColumn(ColumnEncoding::RunLength, column.type, n));
+    e->_ends = std::move(ends);
+    e->_values.gather(column.span(0, n), starts.data(), starts.size());
+  } else if (best == dictionaryBytes) {
+    e.reset(new RdbEncodedColumn(ColumnEncoding::Dictionary, column.type, n));
+    e->_values.gather(column.span(0, n), firsts.data(), firsts.size());
+    e->setCodes(codes, (uint32_t) (firsts.size() - 1));
+  } else {
+    e.reset(new RdbEncodedColumn(ColumnEncoding::FrameOfReference, column.type, n));
+    e->_base = low;
+    e->setCodes(codes, (uint32_t) (high - low));
+  }
+  return e;
+}
+
+void
+RdbEncodedColumn::setCodes(const std::vector<uint32_t>& codes, const uint32_t largest) {
+  _width = codeWidth(largest);
+  switch (_width) {
+  case 1: _codes8.assign(codes.begin(), codes.end()); break;
+  case 2: _codes16.assign(codes.begin(), codes.end()); break;
+  default: _codes32 = codes; break;
+  }
+}
+
+std::size_t
+RdbEncodedColumn::bytes() const {
+  return plainBytes(_values) + _ends.size() * sizeof(uint) +
+    _codes8.size() + _codes16.size() * sizeof(uint16_t) + _codes32.size() * sizeof(uint32_t);
+}
+
+std::string_view
+RdbEncodedColumn::stringView(const std::size_t row) const {
+  return _values.stringView(valueIndex(row));
+}
+
+std::string
+RdbEncodedColumn::getString(const std::size_t row) const {
+  if (_encoding != ColumnEncoding::FrameOfReference) return _values.getString(valueIndex(row));
+  if (_type == ColumnType::Int) return DataType::convert<std::string, int>(getInt(row));
+  return DataType::convert<std::string, uint>(getUInt(row));
+}
+
+double
+RdbEncodedColumn::getDouble(const std::size_t row) const {
+  if (_encoding != ColumnEncoding::FrameOfReference) return _values.getDouble(valueIndex(row));
+  return (double) (_base + (int64_t) code(row));
+}
+
+int
+RdbEncodedColumn::getInt(const std::size_t row) const {
+  if (_encoding != ColumnEncoding::FrameOfReference) return _values.getInt(valueIndex(row));
+  return (int) (_base + (int64_t) code(row));
+}
+
+uint
+RdbEncodedColumn::getUInt(const std::size_t row) const {
+  if (_encoding != ColumnEncoding::FrameOfReference) return _values.getUInt(valueIndex(row));
+  return (uint) (_base + (int64_t) code(row));
+}
+
+void
+RdbEncodedColumn::decode(const std::size_t first, const uint* rows, const std::size_t n,
+                         RdbColumn& out) const {
+  if (out.type != _type or out.encoded)
+    throw std::invalid_argument("an encoded column decodes into a plain column of its type");
+  const auto row = [first, rows] (const std::size_t i) { return first + (rows ? rows[i] : i);};
+  switch (_encoding) {
+  case ColumnEncoding::FrameOfReference:
+    withCodes([&] (const auto* codes) {
+        if (_type == ColumnType::Int)
+          for (std::size_t i = 0; i != n; ++i) out.ints.push_back((int) (_base + codes[row(i)]));
+        else
+          for (std::size_t i = 0; i != n; ++i) out.uints.push_back((uint) (_base + codes[row(i)]));
+      });
+    break;
+  case ColumnEncoding::Dictionary:
+    withCodes([&] (const auto* codes) {
+        for (std::size_t i = 0; i != n; ++i) appendRepeated(out, _values, codes[row(i)], 1);
+      });
+    break;
+  case ColumnEncoding::RunLength:
+    if (not rows) {
+      //whole runs at a time
+      std::size_t r = run(first);
+      for (std::size_t i = first; i < first + n; ++r) {
+        const std::size_t end = std::min<std::size_t>(_ends[r], first + n);
+        appendRepeated(out, _values, r, end - i);
+        i = end;
+      }
+    } else if (n != 0) {
+      //rows mostly in order, mostly in the run of the row before
+      std::size_t r = run(row(0));
+      for (std::size_t i = 0; i != n; ++i) {
+        const std::size_t x = row(i);
+        if (x >= _ends[r] or (r != 0 and x < _ends[r - 1])) r = run(x);
+        appendRepeated(out, _values, r, 1);
+      }
+    }
+    break;
+  case ColumnEncoding::Plain:
+    break;
+  }
+}
+
+int64_t
+RdbEncodedColumn::codeOf(const RdbColumn& from, const std::size_t row) const {
+  if (_encoding == ColumnEncoding::Dictionary) {
+    if (_dictionary.empty())
+      for (uint32_t c = 0; c != _values.size(); ++c) _dictionary.emplace(_values.getString(c), c);
+    const auto found = _dictionary.find(std::string(from.stringView(row)));
+    return found == _dictionary.end() ? -1 : (int64_t) found->second;
+  }
+  if (_encoding == ColumnEncoding::FrameOfReference) {
+    const int64_t x = _type == ColumnType::Int ? (int64_t) from.ints[row] : (int64_t) from.uints[row];
+    const int64_t largest = _width == 1 ? 0xff : 0xffff;
+    return x < _base or x - _base > largest ? -1 : x - _base;
+  }
+  return -1;
+}
+
+bool
+RdbEncodedColumn::accepts(const RdbColumn& from, const std::size_t row) const {
+  if (from.type != _type or from.encoded) return false;
+  if (_encoding == ColumnEncoding::RunLength)
+    return sameValue(_values, _values.size() - 1, from, row);
+  return codeOf(from, row) >= 0;
+}
+
+void
+RdbEncodedColumn::append(const RdbColumn& from, const std::size_t row) {
+  if (_encoding == ColumnEncoding::RunLength) {
+    ++_ends.back();
+  } else {
+    const uint32_t c = (uint32_t) codeOf(from, row);
+    switch (_width) {
+    case 1: _codes8.push_back((uint8_t) c); break;
+    case 2: _codes16.push_back((uint16_t) c); break;
+    default: _codes32.push_back(c); break;
+    }
+  }
+  ++_size;
+}
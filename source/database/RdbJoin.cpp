@@ -0,0 +1,131 @@
+#include "util.h"
+#include "datatypes.h"
+#include "RelationalDatabaseSim.h"
+#include "RdbJoin.h"
+
+
+namespace {
+  //lookups issued ahead of the one being done
+  const uint PrefetchDistance = 8;
+
+  //the key of a row of a column, as a number or as a string
+  template<typename K>
+  K keyOf(const RdbColumnSpan& s, const uint r) {
+    if constexpr (std::is_same<K, std::string_view>::value) {
+      return s.stringView(r);
+    } else {
+      switch (s.type) {
+      case ColumnType::Double: return s.doubles[r];
+      case ColumnType::Int: return (double) s.ints[r];
+      case ColumnType::UInt: return (double) s.uints[r];
+      case ColumnType::String: return s.get<double>(r);
+      }
+      return 0;
+    }
+  }
+
+  template<typename K>
+  RdbHashIndex<K> buildIndex(const RdbColumnSpan& s, const uint* rows, const uint n) {
+    std::vector<K> keys(n);
+    std::vector<uint> indexes(n);
+    for (uint i = 0; i != n; ++i) {
+      indexes[i] = rows ? rows[i] : i;
+      keys[i] = keyOf<K>(s, indexes[i]);
+    }
+    return RdbHashIndex<K>(keys, indexes);
+  }
+
+  //the keys and their hashes first, in a loop of their own,
+  //then the lookups, by partition, with the slots of the next ones prefetched
+  template<typename K>
+  void probeIndex(const RdbHashIndex<K>& index, const RdbColumnSpan& s,
+                  const uint* rows, const uint n,
+                  std::vector<uint>& probeRows, std::vector<uint>& buildRows) {
+    std::vector<K> keys(n);
+    std::vector<uint64_t> hashes(n);
+    for (uint i = 0; i != n; ++i) keys[i] = keyOf<K>(s, rows ? rows[i] : i);
+    for (uint i = 0; i != n; ++i) hashes[i] = RdbHashIndex<K>::hash(keys[i]);
+
+    std::vector<uint> order(n);
+    if (index.partitions() == 1) {
+      std::iota(order.begin(), order.end(), 0U);
+    } else {
+      std::vector<uint> start(index.partitions() + 1, 0);
+      for (uint i = 0; i != n; ++i) ++start[index.partition(hashes[i]) + 1];
+      for (uint p = 0; p != index.partitions(); ++p) start[p + 1] += start[p];
+      for (uint i = 0; i != n; ++i) order[start[index.partition(hashes[i])]++] = i;
+    }
+
+    for (uint j = 0; j != n; ++j) {
+      if (j + PrefetchDistance < n) index.prefetch(hashes[order[j + PrefetchDistance]]);
+      const uint i = order[j];
+      const uint row = rows ? rows[i] : i;
+      index.find(keys[i], hashes[i], [&] (const uint b) {
+          probeRows.push_back(row);
+          buildRows.push_back(b);
+        });
+    }
+  }
+
+  void checkKey(const uint key, const std::size_t ncol) {
+    if (key == 0 or key > ncol)
+      throw std::invalid_argument (
+          "the key of a join, column " +
+          DataType::convert<std::string, uint>(key) +
+          ", is not in a table of " +
+          DataType::convert<std::string, std::size_t>(ncol) + " columns");
+  }
+}
+
+RdbJoinTable::RdbJoinTable(const RdbColumnSpan& keys, const uint* rows, const uint n,
+                           const bool text) : _text(text) {
+  if (text) _strings = buildIndex<std::string_view>(keys, rows, n);
+  else _numbers = buildIndex<double>(keys, rows, n);
+}
+
+void
+RdbJoinTable::probe(const RdbColumnSpan& keys, const uint* rows, const uint n,
+                    std::vector<uint>& probeRows, std::vector<uint>& buildRows) const {
+  if (_text) probeIndex(_strings, keys, rows, n, probeRows, buildRows);
+  else probeIndex(_numbers, keys, rows, n, probeRows, buildRows);
+}
+
+ColumnRdbTable
+hashJoin(const RdbBatch& left, const RdbBatch& right, const uint leftKey, const uint rightKey) {
+  checkKey(leftKey, left.columns.size());
+  checkKey(rightKey, right.columns.size());
+  const RdbColumnSpan& lk = left.columns[leftKey - 1];
+  const RdbColumnSpan& rk = right.columns[rightKey - 1];
+  const bool text = lk.type == ColumnType::String and rk.type == ColumnType::String;
+
+  //built on the smaller side, probed by the other, a batch of rows at a time
+  const bool buildLeft = left.nrow < right.nrow;
+  const RdbBatch& build = buildLeft ? left : right;
+  const RdbBatch& probe = buildLeft ? right : left;
+  const RdbJoinTable table(buildLeft ? lk : rk, nullptr, build.nrow, text);
+
+  std::vector<RdbColumn> columns;
+  for (const auto& c: left.columns) columns.emplace_back(c.type);
+  for (const auto& c: right.columns) columns.emplace_back(c.type);
+
+  std::vector<uint> rows;
+  std::vector<uint> probeRows;
+  std::vector<uint> buildRows;
+  for (uint first = 0; first < probe.nrow; first += defaultBatchRows) {
+    const uint n = std::min(defaultBatchRows, probe.nrow - first);
+    rows.resize(n);
+    std::iota(rows.begin(), rows.end(), first);
+    probeRows.clear();
+    buildRows.clear();
+    table.probe(buildLeft ? rk : lk, rows.data(), n, probeRows, buildRows);
+
+    const std::vector<uint>& leftRows = buildLeft ? buildRows : probeRows;
+    const std::vector<uint>& rightRows = buildLeft ? probeRows : buildRows;
+    const std::size_t nleft = left.columns.size();
+    for (std::size_t j = 0; j != nleft; ++j)
+      columns[j].gather(left.columns[j], leftRows.data(), leftRows.size());
+    for (std::size_t j = 0; j != right.columns.size(); ++j)
+      columns[nleft + j].gather(right.columns[j], rightRows.data(), rightRows.size());
+  }
+  return ColumnRdbTable(std::move(columns));
+}
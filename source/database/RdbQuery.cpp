@@ -0,0 +1,804 @@
+#include "util.h"
+#include "datatypes.h"
+#include "RelationalDatabaseSim.h"
+#include "RdbQuery.h"
+#include "RdbEncoding.h"
+#include <cmath>
+#include <cstring>
+
+
+namespace {
+  //keep the rows of sel for which keep(row), in order
+  template<typename Keep>
+  uint refine(uint* sel, const uint n, const Keep& keep) {
+    uint k = 0;
+    for (uint i = 0; i != n; ++i) {
+      const uint r = sel[i];
+      sel[k] = r;
+      k += keep(r) ? 1 : 0;
+    }
+    return k;
+  }
+
+  template<typename Get, typename X>
+  uint refine(uint* sel, const uint n, const Get& get, const CompareOp op, const X& x) {
+    switch (op) {
+    case CompareOp::Eq: return refine(sel, n, [&] (uint r) { return get(r) == x;});
+    case CompareOp::Ne: return refine(sel, n, [&] (uint r) { return get(r) != x;});
+    case CompareOp::Lt: return refine(sel, n, [&] (uint r) { return get(r) < x;});
+    case CompareOp::Le: return refine(sel, n, [&] (uint r) { return get(r) <= x;});
+    case CompareOp::Gt: return refine(sel, n, [&] (uint r) { return get(r) > x;});
+    case CompareOp::Ge: return refine(sel, n, [&] (uint r) { return get(r) >= x;});
+    }
+    return n;
+  }
+
+  uint refine(uint* sel, const uint n, const RdbColumnSpan& s, const RdbPredicate& p) {
+    if (s.type == ColumnType::String) {
+      if (p.text) {
+        const std::string_view x(p.string);
+        return refine(sel, n, [&s] (uint r) { return s.stringView(r);}, p.op, x);
+      }
+      return refine(sel, n, [&s] (uint r) { return s.get<double>(r);}, p.op, p.number);
+    }
+    //a number compared with a string, that is read as a number
+    const double x = p.text ? DataType::convert<double, std::string>(p.string) : p.number;
+    switch (s.type) {
+    case ColumnType::Double:
+      return refine(sel, n, [d = s.doubles.data] (uint r) { return d[r];}, p.op, x);
+    case ColumnType::Int:
+      return refine(sel, n, [d = s.ints.data] (uint r) { return (double) d[r];}, p.op, x);
+    case ColumnType::UInt:
+      return refine(sel, n, [d = s.uints.data] (uint r) { return (double) d[r];}, p.op, x);
+    case ColumnType::String: break;
+    }
+    return n;
+  }
+
+  //the rows of sel whose values, in an encoded column, pass a predicate.
+  //the predicate is tested on a value of the dictionary, or of a run, once:
+  //passing keeps what it found for each code of a dictionary, 1 or 0,
+  //and -1 for those it was not tested on yet, from one batch to the next.
+  uint refineEncoded(uint* sel, const uint n, const RdbColumnSpan& s, const RdbPredicate& p,
+                     std::vector<int8_t>& passing) {
+    const RdbEncodedColumn& e = *s.encoded;
+    const RdbColumnSpan values = e.values().span(0, e.values().size());
+    const auto passes = [&values, &p] (const std::size_t v) {
+      uint one = (uint) v;
+      return refine(&one, 1, values, p) == 1;
+    };
+    uint k = n;
+    switch (e.encoding()) {
+    case ColumnEncoding::Dictionary:
+      passing.resize(values.size, -1);
+      e.withCodes([&] (const auto* codes) {
+          k = refine(sel, n, [&] (const uint r) {
+              int8_t& x = passing[codes[s.first + r]];
+              if (x < 0) x = passes(codes[s.first + r]) ? 1 : 0;
+              return x == 1;
+            });
+        });
+      break;
+    case ColumnEncoding::RunLength: {
+      const std::vector<uint>& ends = e.ends();
+      std::size_t run = ends.size();
+      bool keep = false;
+      k = refine(sel, n, [&] (const uint r) {
+          const std::size_t row = s.first + r;
+          if (run == ends.size() or row >= ends[run] or (run != 0 and row < ends[run - 1])) {
+            run = e.run(row);
+            keep = passes(run);
+          }
+          return keep;
+        });
+      break;
+    }
+    case ColumnEncoding::FrameOfReference: {
+      const double x = p.text ? DataType::convert<double, std::string>(p.string) : p.number;
+      e.withCodes([&] (const auto* codes) {
+          k = refine(sel, n, [&codes, &s, base = e.base()] (const uint r) {
+              return (double) (base + (int64_t) codes[s.first + r]);
+            }, p.op, x);
+        });
+      break;
+    }
+    case ColumnEncoding::Plain:
+      break;
+    }
+    return k;
+  }
+
+  //add the values of the rows of an encoded column to an accumulator:
+  //the value of a run once for its rows, and the strings of a dictionary
+  //read as numbers once, into numbers, from one batch to the next
+  void accumulateEncoded(const RdbColumnSpan& s, const uint* rows, const uint n,
+                         Accumulator& acc, std::vector< std::optional<double> >& numbers) {
+    const RdbEncodedColumn& e = *s.encoded;
+    switch (e.encoding()) {
+    case ColumnEncoding::Dictionary:
+      numbers.resize(e.values().size());
+      e.withCodes([&] (const auto* codes) {
+          for (uint i = 0; i != n; ++i) {
+            std::optional<double>& x = numbers[codes[s.first + rows[i]]];
+            if (not x) x = e.values().getDouble(codes[s.first + rows[i]]);
+            acc.add(*x);
+          }
+        });
+      break;
+    case ColumnEncoding::RunLength: {
+      const std::vector<uint>& ends = e.ends();
+      for (uint i = 0; i != n;) {
+        const std::size_t run = e.run(s.first + rows[i]);
+        const std::size_t start = run == 0 ? 0 : ends[run - 1];
+        uint j = i + 1;
+        while (j != n and s.first + rows[j] >= start and s.first + rows[j] < ends[run]) ++j;
+        acc.add(e.values().getDouble(run), j - i);
+        i = j;
+      }
+      break;
+    }
+    case ColumnEncoding::FrameOfReference: {
+      if (n == 0) break;
+      //offsets summed as integers
+      uint64_t sum = 0;
+      uint32_t low = std::numeric_limits<uint32_t>::max(), high = 0;
+      e.withCodes([&] (const auto* codes) {
+          for (uint i = 0; i != n; ++i) {
+            const uint32_t c = codes[s.first + rows[i]];
+            sum += c;
+            low = std::min(low, c);
+            high = std::max(high, c);
+          }
+        });
+      Accumulator a;
+      a.count = n;
+      a.sum = (double) e.base() * n + (double) sum;
+      a.min = (double) (e.base() + low);
+      a.max = (double) (e.base() + high);
+      acc.merge(a);
+      break;
+    }
+    case ColumnEncoding::Plain:
+      break;
+    }
+  }
+
+  //f(x) for the value x at each selected row, as a double
+  template<typename F>
+  void forSelected(const RdbColumnSpan& s, const uint* sel, const uint n, const F& f) {
+    switch (s.type) {
+    case ColumnType::Double: for (uint i = 0; i != n; ++i) f(s.doubles[sel[i]]); break;
+    case ColumnType::Int: for (uint i = 0; i != n; ++i) f((double) s.ints[sel[i]]); break;
+    case ColumnType::UInt: for (uint i = 0; i != n; ++i) f((double) s.uints[sel[i]]); break;
+    case ColumnType::String: for (uint i = 0; i != n; ++i) f(s.get<double>(sel[i])); break;
+    }
+  }
+
+  //the rows of a batch that pass all the predicates, the first ones of sel.
+  //passing is what predicates on encoded columns found of their dictionaries.
+  uint selectRows(const RdbBatch& batch, const std::vector<RdbPredicate>& predicates,
+                  std::vector<uint>& sel,
+                  std::vector< std::vector<int8_t> >* passing = nullptr) {
+    sel.resize(batch.nrow);
+    std::iota(sel.begin(), sel.end(), 0U);
+    uint n = batch.nrow;
+    std::vector<int8_t> once;
+    if (passing) passing->resize(predicates.size());
+    for (uint j = 0; j != predicates.size(); ++j) {
+      if (n == 0) break;
+      const RdbPredicate& p = predicates[j];
+      const RdbColumnSpan& s = batch.columns[p.column - 1];
+      if (s.encoded) n = refineEncoded(sel.data(), n, s, p, passing ? (*passing)[j] : once);
+      else n = refine(sel.data(), n, s, p);
+    }
+    return n;
+  }
+
+  //the rows of an index for the filters on its column: those with the value
+  //of an equality, or in the range of the others, for a sorted index.
+  //none when it cannot find them.
+  template<typename K, typename KeyOf>
+  std::optional< std::vector<uint> > indexedRows(const RdbIndex& index, const uint column,
+                                                 const std::vector<RdbPredicate>& filters,
+                                                 const KeyOf& keyOf) {
+    std::optional<K> low, high;
+    bool lowIncluded = true, highIncluded = true;
+    for (const auto& p: filters) {
+      if (p.column != column) continue;
+      const std::optional<K> x = keyOf(p);
+      if (not x) continue;
+      switch (p.op) {
+      case CompareOp::Eq:
+        return index.equal(*x);
+      case CompareOp::Ne:
+        break;
+      case CompareOp::Gt:
+      case CompareOp::Ge:
+        if (not low or *x > *low or (*x == *low and p.op == CompareOp::Gt)) {
+          low = x;
+          lowIncluded = p.op == CompareOp::Ge;
+        }
+        break;
+      case CompareOp::Lt:
+      case CompareOp::Le:
+        if (not high or *x < *high or (*x == *high and p.op == CompareOp::Lt)) {
+          high = x;
+          highIncluded = p.op == CompareOp::Le;
+        }
+        break;
+      }
+    }
+    if (index.kind() != IndexKind::Sorted or (not low and not high)) return std::nullopt;
+    return index.range(low, lowIncluded, high, highIncluded);
+  }
+
+  //an index of strings for the strings of predicates,
+  //an index of numbers for their numbers, or their strings read as numbers
+  std::optional< std::vector<uint> > indexedRows(const RdbIndex& index, const uint column,
+                                                 const std::vector<RdbPredicate>& filters) {
+    if (index.text())
+      return indexedRows<std::string>(index, column, filters, [] (const RdbPredicate& p) {
+          return p.text ? std::optional<std::string>(p.string) : std::nullopt;
+        });
+    return indexedRows<double>(index, column, filters, [] (const RdbPredicate& p) {
+        return std::optional<double>(
+          p.text ? DataType::convert<double, std::string>(p.string) : p.number);
+      });
+  }
+
+  //whether a block of a zone map may hold a value that passes a comparison
+  template<typename K>
+  bool mayPass(const RdbZoneMap& zones, const std::size_t block, const CompareOp op, const K& x) {
+    switch (op) {
+    case CompareOp::Eq: return zones.mayHold(block, std::optional<K>(x), true, std::optional<K>(x), true);
+    case CompareOp::Ne: return true;
+    case CompareOp::Lt:
+    case CompareOp::Le: return zones.mayHold(block, std::nullopt, true, std::optional<K>(x), op == CompareOp::Le);
+    case CompareOp::Gt:
+    case CompareOp::Ge: return zones.mayHold(block, std::optional<K>(x), op == CompareOp::Ge, std::nullopt, true);
+    }
+    return true;
+  }
+
+  //the blocks of a zone map no row of which passes a predicate.
+  //strings compared with a number are read as numbers, and have no zones for them.
+  void ruleOut(const RdbZoneMap& zones, const RdbPredicate& p, std::vector<bool>& ruledOut) {
+    if (zones.text() and not p.text) return;
+    ruledOut.resize(std::max(ruledOut.size(), zones.size()), false);
+    if (zones.text()) {
+      for (std::size_t b = 0; b != zones.size(); ++b)
+        if (not mayPass(zones, b, p.op, p.string)) ruledOut[b] = true;
+      return;
+    }
+    const double x = p.text ? DataType::convert<double, std::string>(p.string) : p.number;
+    for (std::size_t b = 0; b != zones.size(); ++b)
+      if (not mayPass(zones, b, p.op, x)) ruledOut[b] = true;
+  }
+
+  void checkColumn(const uint index, const uint ncol) {
+    if (index == 0 or index > ncol)
+      throw std::invalid_argument (
+          "a query asks for column " +
+          DataType::convert<std::string, uint>(index) +
+          " of a table of " +
+          DataType::convert<std::string, uint>(ncol) + " columns");
+  }
+}
+
+RdbQueryResult
+RdbQuery::open(const DbSim& db) const {
+  return RdbQueryResult(*this, db);
+}
+
+ColumnRdbTable
+RdbQuery::execute(const DbSim& db) const {
+  RdbQueryResult result = open(db);
+  ColumnRdbTable table(result.schema());
+  for (auto batch = result.nextBatch(defaultBatchRows); batch.nrow != 0;
+       batch = result.nextBatch(defaultBatchRows))
+    table.append(batch);
+  return table;
+}
+
+RdbQueryResult::Source::Source(const DbSim& db, const std::string& table) : name(table) {
+  if (db.hasColumnTable(name)) {
+    columns = db.columnTable(name);
+    nrow = columns->nrow();
+    schema = columns->schema();
+  } else {
+    rows = db.table(name);
+    nrow = rows->size();
+    schema.assign(rows->ncol(), ColumnType::String);
+  }
+}
+
+RdbBatch
+RdbQueryResult::Source::batch(const uint first, const uint n) const {
+  if (columns) return columns->batch(first, n);
+  return rows->batch(first, n);
+}
+
+RdbBatch
+RdbQueryResult::Source::encodedBatch(const uint first, const uint n) const {
+  if (columns) return columns->encodedBatch(first, n);
+  return rows->batch(first, n);
+}
+
+RdbBatch
+RdbQueryResult::Source::gather(const uint* indexes, const uint n) const {
+  if (columns) return columns->gather(indexes, n);
+  return rows->gather(indexes, n);
+}
+
+RdbQueryResult::RdbQueryResult(const RdbQuery& query, const DbSim& db) :
+  _query(query), _scan(db, query.table()) {
+  if (not query.orderedBy().empty()) {
+    //the rows to sort are those of the query, all of them
+    RdbQuery inner = query;
+    inner.orderBy({}).limit(std::numeric_limits<uint>::max());
+    _input = std::make_shared<RdbQueryResult>(inner, db);
+    _schema = _input->schema();
+    for (const auto& o: query.orderedBy()) checkColumn(o.column, (uint) _schema.size());
+    _sorted = std::make_shared<ExternalSort>(query.sortBudget());
+    return;
+  }
+  if (not query.groupedBy().empty()) {
+    //the rows to group are those of the query without its aggregates,
+    //with the keys and the aggregated columns alone
+    std::vector<uint> columns = query.groupedBy();
+    for (const auto& a: query.aggregates())
+      if (a.op != AggregateOp::Count) columns.push_back(a.column);
+    RdbQuery inner = query;
+    inner.groupBy({}).aggregate({}).limit(std::numeric_limits<uint>::max()).project(columns);
+    _input = std::make_shared<RdbQueryResult>(inner, db);
+    const auto& types = _input->schema();
+    _schema.assign(types.begin(), types.begin() + query.groupedBy().size());
+    for (const auto& a: query.aggregates())
+      _schema.push_back(a.op == AggregateOp::Count ? ColumnType::UInt : ColumnType::Double);
+    return;
+  }
+  ColumnRdbTable::Schema schema = _scan.schema;
+  _leftColumns = (uint) schema.size();
+  std::optional<Source> build;
+  uint buildKey = 0;
+  if (query.joined()) {
+    const RdbJoinClause& j = *query.joined();
+    build.emplace(db, j.table);
+    checkColumn(j.leftKey, _leftColumns);
+    checkColumn(j.rightKey, (uint) build->schema.size());
+    schema.insert(schema.end(), build->schema.begin(), build->schema.end());
+    //the smaller table is the build side
+    _scanIsLeft = _scan.nrow >= build->nrow;
+    if (not _scanIsLeft) std::swap(_scan, *build);
+    _scanKey = _scanIsLeft ? j.leftKey : j.rightKey;
+    buildKey = _scanIsLeft ? j.rightKey : j.leftKey;
+  }
+  const uint ncol = (uint) schema.size();
+
+  //each filter is on a column of one of the tables, and applies to it alone
+  std::vector<RdbPredicate> buildFilters;
+  for (const auto& p: query.predicates()) {
+    checkColumn(p.column, ncol);
+    const Place at = place(p.column);
+    RdbPredicate q = p;
+    q.column = at.index + 1;
+    (at.scanned ? _filters : buildFilters).push_back(q);
+  }
+  if (build) {
+    _build = build->batch(0, build->nrow);
+    std::vector<uint> sel;
+    const uint k = selectRows(_build, buildFilters, sel);
+    const RdbColumnSpan& keys = _build.columns[buildKey - 1];
+    const bool text = keys.type == ColumnType::String and
+      _scan.schema[_scanKey - 1] == ColumnType::String;
+    _joinTable = std::make_shared<const RdbJoinTable>(keys, sel.data(), k, text);
+  }
+  findIndexed(db);
+  findZones(db);
+
+  if (not query.aggregates().empty()) {
+    for (const auto& a: query.aggregates()) {
+      if (a.op != AggregateOp::Count) {
+        checkColumn(a.column, ncol);
+        _aggregated.push_back(place(a.column));
+      } else {
+        _aggregated.push_back(Place{true, 0});
+      }
+      _schema.push_back(a.op == AggregateOp::Count ? ColumnType::UInt : ColumnType::Double);
+    }
+    return;
+  }
+  std::vector<uint> columns = query.columns();
+  if (columns.empty()) {
+    columns.resize(ncol);
+    std::iota(columns.begin(), columns.end(), 1);
+  }
+  for (const uint c: columns) {
+    checkColumn(c, ncol);
+    _output.push_back(place(c));
+    _schema.push_back(schema[c - 1]);
+  }
+}
+
+RdbQueryResult::Place
+RdbQueryResult::place(const uint column) const {
+  if (not _query.joined()) return Place{true, column - 1};
+  const bool left = column <= _leftColumns;
+  return Place{left == _scanIsLeft, left ? column - 1 : column - 1 - _leftColumns};
+}
+
+void
+RdbQueryResult::findIndexed(const DbSim& db) {
+  std::vector<uint> tried;
+  for (const auto& p: _filters) {
+    const RdbIndex* index = db.index(_scan.name, p.column);
+    if (not index or std::find(tried.begin(), tried.end(), p.column) != tried.end()) continue;
+    tried.push_back(p.column);
+    auto found = indexedRows(*index, p.column, _filters);
+    if (found and (not _indexed or found->size() < _indexed->size())) _indexed = std::move(found);
+  }
+}
+
+void
+RdbQueryResult::findZones(const DbSim& db) {
+  if (_indexed or _scan.nrow == 0) return;
+  std::vector<bool> ruledOut;
+  for (const auto& p: _filters) {
+    const RdbZoneMap* zones = db.zoneMap(_scan.name, p.column);
+    if (not zones) continue;
+    _zoneRows = (uint) zones->blockRows();
+    ruleOut(*zones, p, ruledOut);
+  }
+  if (std::find(ruledOut.begin(), ruledOut.end(), true) != ruledOut.end()) _ruledOut.swap(ruledOut);
+}
+
+bool
+RdbQueryResult::scan(const uint n) {
+  const uint nrow = _indexed ? (uint) _indexed->size() : _scan.nrow;
+  uint count = n;
+  if (not _ruledOut.empty()) {
+    //the blocks ruled out are skipped, and a batch is in a single block
+    std::size_t block = _position / _zoneRows;
+    while (_position < nrow and block < _ruledOut.size() and _ruledOut[block]) {
+      const uint next = std::min<uint>(nrow, (uint) (block + 1) * _zoneRows);
+      _skipped += next - _position;
+      _position = next;
+      ++block;
+    }
+    count = std::min<uint>(count, (uint) (block + 1) * _zoneRows - _position);
+  }
+  if (_position >= nrow) return false;
+  _first = _position;
+  count = std::min(count, nrow - _first);
+  _batch = _indexed ? _scan.gather(_indexed->data() + _first, count) :
+    _scan.encodedBatch(_first, count);
+  _position += _batch.nrow;
+  _matches = selectRows(_batch, _filters, _selection, &_passing);
+  if (_joinTable) {
+    //the keys are hashed as they are
+    RdbColumnSpan& key = _batch.columns[_scanKey - 1];
+    if (key.encoded) {
+      auto decoded = std::make_shared< std::vector<RdbColumn> >(1, RdbColumn(key.type));
+      decoded->back().gather(key, nullptr, _batch.nrow);
+      key = decoded->back().span(0, _batch.nrow);
+      _batch.owned = decoded;
+    }
+    std::vector<uint> probeRows;
+    _buildRows.clear();
+    _joinTable->probe(_batch.columns[_scanKey - 1], _selection.data(), _matches,
+                      probeRows, _buildRows);
+    _selection.swap(probeRows);
+    _matches = (uint) _selection.size();
+  }
+  _next = 0;
+  return true;
+}
+
+RdbBatch
+RdbQueryResult::nextBatch(const uint n) {
+  if (_sorted) return nextSorted(n);
+  if (_input) return nextGroups(n);
+  if (not _query.aggregates().empty()) return aggregateAll();
+
+  auto columns = std::make_shared< std::vector<RdbColumn> >();
+  for (const auto t: _schema) columns->emplace_back(t);
+  const uint wanted = std::min(n, _query.rowLimit() - _returned);
+  uint produced = 0;
+  while (produced < wanted) {
+    if (_next == _matches) {
+      if (not scan(n)) break;
+      continue;
+    }
+    const uint m = std::min(wanted - produced, _matches - _next);
+    if (not _joinTable and _next + m < _matches) {
+      //the rest of the batch is read again by the next call
+      _position = _first + _selection[_next + m - 1] + 1;
+      _matches = _next + m;
+    }
+    for (uint j = 0; j != _output.size(); ++j)
+      (*columns)[j].gather(values(_output[j]), rows(_output[j]) + _next, m);
+    _next += m;
+    produced += m;
+  }
+  _returned += produced;
+
+  RdbBatch out;
+  out.nrow = produced;
+  for (const auto& c: *columns) out.columns.push_back(c.span(0, produced));
+  out.owned = columns;
+  return out;
+}
+
+RdbBatch
+RdbQueryResult::aggregateAll() {
+  RdbBatch out;
+  if (_returned != 0) return out;
+  std::vector<Accumulator> acc(_query.aggregates().size());
+  _numbers.resize(acc.size());
+  while (scan(defaultBatchRows)) {
+    for (uint j = 0; j != acc.size(); ++j) {
+      Accumulator& s = acc[j];
+      if (_query.aggregates()[j].op == AggregateOp::Count) {
+        s.count += _matches;
+        continue;
+      }
+      const Place& at = _aggregated[j];
+      if (values(at).encoded)
+        accumulateEncoded(values(at), rows(at), _matches, s, _numbers[j]);
+      else
+        forSelected(values(at), rows(at), _matches, [&s] (const double x) { s.add(x);});
+    }
+  }
+  //a single row, unless the limit is 0
+  _returned = 1;
+  if (_query.rowLimit() == 0) return out;
+  auto columns = std::make_shared< std::vector<RdbColumn> >();
+  for (uint j = 0; j != acc.size(); ++j) {
+    const AggregateOp op = _query.aggregates()[j].op;
+    columns->emplace_back(_schema[j]);
+    if (op == AggregateOp::Count) columns->back().uints.push_back((uint) acc[j].count);
+    else columns->back().doubles.push_back(acc[j].value(op));
+  }
+  out.nrow = 1;
+  for (const auto& c: *columns) out.columns.push_back(c.span(0, 1));
+  out.owned = columns;
+  return out;
+}
+
+RdbBatch
+RdbQueryResult::nextGroups(const uint n) {
+  if (not _groups) {
+    ColumnRdbTable input(_input->schema());
+    for (auto batch = _input->nextBatch(defaultBatchRows); batch.nrow != 0;
+         batch = _input->nextBatch(defaultBatchRows))
+      input.append(batch);
+    const uint nkeys = (uint) _query.groupedBy().size();
+    std::vector<uint> keys(nkeys);
+    std::iota(keys.begin(), keys.end(), 1);
+    std::vector<RdbAggregate> aggregates = _query.aggregates();
+    uint column = nkeys;
+    for (auto& a: aggregates)
+      if (a.op != AggregateOp::Count) a.column = ++column;
+    _groups = std::make_shared<const ColumnRdbTable>(groupBy(input, keys, aggregates));
+  }
+  const uint last = std::min(_query.rowLimit(), _groups->nrow());
+  const uint first = std::min(_returned, last);
+  const uint count = std::min(n, last - first);
+  _returned = first + count;
+  return _groups->batch(first, count);
+}
+
+namespace {
+  //the key columns of a row, one after the other, as bytes
+  void appendKey(std::string& key, const RdbColumnSpan& s, const uint r) {
+    switch (s.type) {
+    case ColumnType::Double:
+      key.append((const char*) &s.doubles[r], sizeof(double));
+      break;
+    case ColumnType::Int:
+      key.append((const char*) &s.ints[r], sizeof(int));
+      break;
+    case ColumnType::UInt:
+      key.append((const char*) &s.uints[r], sizeof(uint));
+      break;
+    case ColumnType::String: {
+      const std::string_view x = s.stringView(r);
+      const uint32_t size = (uint32_t) x.size();
+      key.append((const char*) &size, sizeof(size));
+      key.append(x);
+      break;
+    }
+    }
+  }
+
+  //the inverse of appendKey, into a column
+  void readKey(RdbColumn& c, const char*& p) {
+    switch (c.type) {
+    case ColumnType::Double: {
+      double x;
+      std::memcpy(&x, p, sizeof(x));
+      c.doubles.push_back(x);
+      p += sizeof(x);
+      break;
+    }
+    case ColumnType::Int: {
+      int x;
+      std::memcpy(&x, p, sizeof(x));
+      c.ints.push_back(x);
+      p += sizeof(x);
+      break;
+    }
+    case ColumnType::UInt: {
+      uint x;
+      std::memcpy(&x, p, sizeof(x));
+      c.uints.push_back(x);
+      p += sizeof(x);
+      break;
+    }
+    case ColumnType::String: {
+      uint32_t size;
+      std::memcpy(&size, p, sizeof(size));
+      p += sizeof(size);
+      c.blob.append(p, size);
+      c.offsets.push_back(c.blob.size());
+      p += size;
+      break;
+    }
+    }
+  }
+
+  template<typename K, typename KeyOf>
+  ColumnRdbTable groupWith(const RdbBatch& batch, const std::vector<uint>& keys,
+                           const std::vector<RdbAggregate>& aggregates, const KeyOf& key) {
+    //the aggregated values as numbers first, in a loop for each column
+    std::vector< std::vector<double> > values(aggregates.size());
+    std::vector<uint> all(batch.nrow);
+    std::iota(all.begin(), all.end(), 0U);
+    for (uint j = 0; j != aggregates.size(); ++j) {
+      if (aggregates[j].op == AggregateOp::Count) continue;
+      values[j].reserve(batch.nrow);
+      forSelected(batch.columns[aggregates[j].column - 1], all.data(), batch.nrow,
+                  [&v = values[j]] (const double x) { v.push_back(x);});
+    }
+    const Groups<K> groups = groupRows<K>(
+      batch.nrow, aggregates.size(), key,
+      [&values] (const std::size_t j, const std::size_t i) {
+        return values[j].empty() ? 0.0 : values[j][i];
+      });
+
+    const std::vector<uint> first(groups.first.begin(), groups.first.end());
+    std::vector<RdbColumn> columns;
+    for (const uint k: keys) {
+      columns.emplace_back(batch.columns[k - 1].type);
+      columns.back().gather(batch.columns[k - 1], first.data(), first.size());
+    }
+    for (uint j = 0; j != aggregates.size(); ++j) {
+      const AggregateOp op = aggregates[j].op;
+      if (op == AggregateOp::Count) {
+        columns.emplace_back(ColumnType::UInt);
+        for (std::size_t g = 0; g != groups.size(); ++g)
+          columns.back().uints.push_back((uint) groups.at(g, j).count);
+      } else {
+        columns.emplace_back(ColumnType::Double);
+        for (std::size_t g = 0; g != groups.size(); ++g)
+          columns.back().doubles.push_back(groups.at(g, j).value(op));
+      }
+    }
+    return ColumnRdbTable(std::move(columns));
+  }
+}
+
+ColumnRdbTable
+groupBy(const RdbBatch& batch, const std::vector<uint>& keys,
+        const std::vector<RdbAggregate>& aggregates) {
+  const uint ncol = (uint) batch.columns.size();
+  if (keys.empty()) throw std::invalid_argument("a group by needs a key column");
+  for (const uint k: keys) checkColumn(k, ncol);
+  for (const auto& a: aggregates)
+    if (a.op != AggregateOp::Count) checkColumn(a.column, ncol);
+
+  if (keys.size() > 1) {
+    std::vector<std::string> encoded(batch.nrow);
+    for (uint r = 0; r != batch.nrow; ++r)
+      for (const uint k: keys) appendKey(encoded[r], batch.columns[k - 1], r);
+    return groupWith<std::string>(batch, keys, aggregates,
+                                  [&encoded] (const std::size_t i) -> const std::string& {
+                                    return encoded[i];
+                                  });
+  }
+  //a single key column is read as it is, integers may be indexed directly
+  const RdbColumnSpan& s = batch.columns[keys[0] - 1];
+  switch (s.type) {
+  case ColumnType::Double:
+    return groupWith<double>(batch, keys, aggregates,
+                             [&s] (const std::size_t i) { return s.doubles[i];});
+  case ColumnType::Int:
+    return groupWith<int>(batch, keys, aggregates,
+                          [&s] (const std::size_t i) { return s.ints[i];});
+  case ColumnType::UInt:
+    return groupWith<uint>(batch, keys, aggregates,
+                           [&s] (const std::size_t i) { return s.uints[i];});
+  case ColumnType::String:
+    break;
+  }
+  return groupWith<std::string_view>(batch, keys, aggregates,
+                                     [&s] (const std::size_t i) { return s.stringView(i);});
+}
+
+namespace {
+  //the sort key of the rows of a batch, in keys
+  void sortKeys(const RdbBatch& batch, const std::vector<RdbOrder>& orders,
+                std::vector<std::string>& keys) {
+    keys.assign(batch.nrow, std::string());
+    for (const auto& o: orders) {
+      const RdbColumnSpan& s = batch.columns[o.column - 1];
+      for (uint r = 0; r != batch.nrow; ++r) {
+        switch (s.type) {
+        case ColumnType::Double: appendSortKey(keys[r], s.doubles[r], o.descending); break;
+        case ColumnType::Int: appendSortKey(keys[r], s.ints[r], o.descending); break;
+        case ColumnType::UInt: appendSortKey(keys[r], s.uints[r], o.descending); break;
+        case ColumnType::String: appendSortKey(keys[r], s.stringView(r), o.descending); break;
+        }
+      }
+    }
+  }
+}
+
+RdbBatch
+RdbQueryResult::nextSorted(const uint n) {
+  if (_input) {
+    //the rows of the result, each with all of its columns
+    std::vector<std::string> keys;
+    for (auto batch = _input->nextBatch(defaultBatchRows); batch.nrow != 0;
+         batch = _input->nextBatch(defaultBatchRows)) {
+      sortKeys(batch, _query.orderedBy(), keys);
+      for (uint r = 0; r != batch.nrow; ++r) {
+        std::string row;
+        for (const auto& s: batch.columns) appendKey(row, s, r);
+        _sorted->add(std::move(keys[r]), std::move(row));
+      }
+    }
+    _input.reset();
+  }
+
+  auto columns = std::make_shared< std::vector<RdbColumn> >();
+  for (const auto t: _schema) columns->emplace_back(t);
+  const uint wanted = std::min(n, _query.rowLimit() - _returned);
+  uint produced = 0;
+  for (const SortRecord* r = nullptr; produced < wanted and (r = _sorted->next()); ++produced) {
+    const char* p = r->payload.data();
+    for (auto& c: *columns) readKey(c, p);
+  }
+  _returned += produced;
+
+  RdbBatch out;
+  out.nrow = produced;
+  for (const auto& c: *columns) out.columns.push_back(c.span(0, produced));
+  out.owned = columns;
+  return out;
+}
+
+ColumnRdbTable
+orderBy(const RdbBatch& batch, const std::vector<RdbOrder>& orders, const std::size_t budget) {
+  for (const auto& o: orders) checkColumn(o.column, (uint) batch.columns.size());
+  //the keys, with the rows they are of
+  ExternalSort sort(budget);
+  std::vector<std::string> keys;
+  sortKeys(batch, orders, keys);
+  for (uint r = 0; r != batch.nrow; ++r)
+    sort.add(std::move(keys[r]), std::string((const char*) &r, sizeof(r)));
+  std::vector<uint> rows;
+  rows.reserve(batch.nrow);
+  for (const SortRecord* r = sort.next(); r; r = sort.next()) {
+    uint row;
+    std::memcpy(&row, r->payload.data(), sizeof(row));
+    rows.push_back(row);
+  }
+
+  std::vector<RdbColumn> columns;
+  for (const auto& s: batch.columns) {
+    columns.emplace_back(s.type);
+    columns.back().gather(s, rows.data(), rows.size());
+  }
+  return ColumnRdbTable(std::move(columns));
+}
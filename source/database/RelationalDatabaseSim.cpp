@@ -1,6 +1,8 @@
 #include "util.h"
 #include "datatypes.h"
 #include "RelationalDatabaseSim.h"
+#include "RdbEncoding.h"
+#include <charconv>
 
 
 DbQuerySim&
@@ -14,3 +16,443 @@ DbconnClassSim::~DbconnClassSim() {
     if (q.ptr()) delete q.ptr();
   }
 }
+
+namespace {
+  template<typename T>
+  T parseField(const std::string& field) {
+    T x;
+    const char* last = field.data() + field.size();
+    const auto r = std::from_chars(field.data(), last, x);
+    if (r.ec != std::errc() or r.ptr != last)
+      throw std::invalid_argument("invalid data string: " + field);
+    return x;
+  }
+}
+
+std::size_t
+RdbColumn::size() const {
+  if (encoded) return encoded->size();
+  switch (type) {
+  case ColumnType::Double: return doubles.size();
+  case ColumnType::Int: return ints.size();
+  case ColumnType::UInt: return uints.size();
+  case ColumnType::String: return offsets.size() - 1;
+  }
+  return 0;
+}
+
+void
+RdbColumn::append(const std::string& field) {
+  if (encoded) {
+    RdbColumn value(type);
+    value.append(field);
+    if (encoded->accepts(value, 0)) {
+      //copies of a table share its encoded columns, until one of them changes
+      if (encoded.use_count() != 1) encoded = std::make_shared<RdbEncodedColumn>(*encoded);
+      std::const_pointer_cast<RdbEncodedColumn>(encoded)->append(value, 0);
+      return;
+    }
+    decode();
+  }
+  switch (type) {
+  case ColumnType::Double: doubles.push_back(parseField<double>(field)); break;
+  case ColumnType::Int: ints.push_back(parseField<int>(field)); break;
+  case ColumnType::UInt: uints.push_back(parseField<uint>(field)); break;
+  case ColumnType::String:
+    blob.append(field);
+    offsets.push_back(blob.size());
+    break;
+  }
+}
+
+void
+RdbColumn::truncate(std::size_t n) {
+  decode();
+  doubles.resize(std::min(n, doubles.size()));
+  ints.resize(std::min(n, ints.size()));
+  uints.resize(std::min(n, uints.size()));
+  if (n + 1 < offsets.size()) {
+    offsets.resize(n + 1);
+    blob.resize(offsets[n]);
+  }
+}
+
+void
+RdbColumn::encode() {
+  encoded = RdbEncodedColumn::encode(*this);
+  if (not encoded) return;
+  doubles = std::vector<double>();
+  ints = std::vector<int>();
+  uints = std::vector<uint>();
+  blob = std::string();
+  offsets = std::vector<std::size_t>{0};
+}
+
+void
+RdbColumn::decode() {
+  if (not encoded) return;
+  const auto values = encoded;
+  encoded.reset();
+  values->decode(0, nullptr, values->size(), *this);
+}
+
+ColumnEncoding
+RdbColumn::encoding() const {
+  return encoded ? encoded->encoding() : ColumnEncoding::Plain;
+}
+
+std::string_view
+RdbColumn::stringView(std::size_t i) const {
+  if (encoded) return encoded->stringView(i);
+  return std::string_view(blob.data() + offsets[i], offsets[i + 1] - offsets[i]);
+}
+
+RdbColumnSpan
+RdbColumn::span(std::size_t first, std::size_t n) const {
+  RdbColumnSpan s;
+  s.type = type;
+  s.size = n;
+  if (encoded) {
+    s.encoded = encoded.get();
+    s.first = first;
+    return s;
+  }
+  switch (type) {
+  case ColumnType::Double: s.doubles = Span<double>{doubles.data() + first, n}; break;
+  case ColumnType::Int: s.ints = Span<int>{ints.data() + first, n}; break;
+  case ColumnType::UInt: s.uints = Span<uint>{uints.data() + first, n}; break;
+  case ColumnType::String:
+    s.blob = blob.data();
+    s.offsets = offsets.data() + first;
+    break;
+  }
+  return s;
+}
+
+void
+RdbColumn::gather(const RdbColumnSpan& from, const uint* rows, std::size_t n) {
+  decode();
+  if (from.encoded) return from.encoded->decode(from.first, rows, n, *this);
+  const auto row = [rows] (std::size_t i) { return rows ? rows[i] : (uint) i;};
+  switch (type) {
+  case ColumnType::Double:
+    for (std::size_t i = 0; i != n; ++i) doubles.push_back(from.doubles[row(i)]);
+    break;
+  case ColumnType::Int:
+    for (std::size_t i = 0; i != n; ++i) ints.push_back(from.ints[row(i)]);
+    break;
+  case ColumnType::UInt:
+    for (std::size_t i = 0; i != n; ++i) uints.push_back(from.uints[row(i)]);
+    break;
+  case ColumnType::String:
+    for (std::size_t i = 0; i != n; ++i) {
+      blob.append(from.stringView(row(i)));
+      offsets.push_back(blob.size());
+    }
+    break;
+  }
+}
+
+std::string
+RdbColumn::getString(std::size_t i) const {
+  if (encoded) return encoded->getString(i);
+  switch (type) {
+  case ColumnType::Double: return DataType::convert<std::string, double>(doubles[i]);
+  case ColumnType::Int: return DataType::convert<std::string, int>(ints[i]);
+  case ColumnType::UInt: return DataType::convert<std::string, uint>(uints[i]);
+  case ColumnType::String: return std::string(stringView(i));
+  }
+  return std::string();
+}
+
+double
+RdbColumn::getDouble(std::size_t i) const {
+  if (encoded) return encoded->getDouble(i);
+  switch (type) {
+  case ColumnType::Double: return doubles[i];
+  case ColumnType::Int: return (double) ints[i];
+  case ColumnType::UInt: return (double) uints[i];
+  case ColumnType::String: return DataType::convert<double, std::string>(getString(i));
+  }
+  return 0.0;
+}
+
+int
+RdbColumn::getInt(std::size_t i) const {
+  if (encoded) return encoded->getInt(i);
+  switch (type) {
+  case ColumnType::Double: return (int) doubles[i];
+  case ColumnType::Int: return ints[i];
+  case ColumnType::UInt: return (int) uints[i];
+  case ColumnType::String: return DataType::convert<int, std::string>(getString(i));
+  }
+  return 0;
+}
+
+uint
+RdbColumn::getUInt(std::size_t i) const {
+  if (encoded) return encoded->getUInt(i);
+  switch (type) {
+  case ColumnType::Double: return (uint) doubles[i];
+  case ColumnType::Int: return (uint) ints[i];
+  case ColumnType::UInt: return uints[i];
+  case ColumnType::String: return DataType::convert<uint, std::string>(getString(i));
+  }
+  return 0;
+}
+
+ColumnRdbTable::ColumnRdbTable(const Schema& schema) : _schema(schema) {
+  for (const auto t: schema) _columns.emplace_back(t);
+}
+
+ColumnRdbTable::ColumnRdbTable(const Schema& schema,
+                               const std::vector< std::vector<std::string> >& table) :
+  ColumnRdbTable(schema) {
+  for (const auto& row: table) insert(row);
+}
+
+ColumnRdbTable::ColumnRdbTable(const Schema& schema, const StrRowRdbTable& table) :
+  ColumnRdbTable(schema) {
+  std::vector<std::string> fields(schema.size());
+  for (const auto& row: table.data()) {
+    for (uint j = 0; j != fields.size(); ++j) fields[j] = row.getString(j + 1);
+    insert(fields);
+  }
+}
+
+ColumnRdbTable::ColumnRdbTable(std::vector<RdbColumn> columns) :
+  _columns(std::move(columns)) {
+  for (const auto& c: _columns) _schema.push_back(c.type);
+  _nrow = _columns.empty() ? 0 : (uint) _columns[0].size();
+  for (const auto& c: _columns)
+    if (c.size() != _nrow)
+      throw std::invalid_argument("the columns of a table should all have the same size");
+}
+
+void
+ColumnRdbTable::insert(const std::vector<std::string>& row) {
+  if (row.size() != _schema.size())
+    throw std::invalid_argument(
+      "A row of " + DataType::convert<std::string, uint>(ncol()) +
+      " cannot be extracted from a vector of length " +
+      DataType::convert<std::string, std::size_t>(row.size()));
+  const std::size_t encoded = encodedColumns();
+  try {
+    for (uint j = 0; j != row.size(); ++j) _columns[j].append(row[j]);
+  } catch (...) {
+    //a row is inserted whole, or not at all
+    for (auto& c: _columns) c.truncate(_nrow);
+    inserted(encoded, 0);
+    throw;
+  }
+  ++_nrow;
+  inserted(encoded, 1);
+}
+
+void
+ColumnRdbTable::append(const RdbBatch& batch) {
+  if (batch.columns.size() != _schema.size())
+    throw std::invalid_argument(
+      "A batch of " + DataType::convert<std::string, std::size_t>(batch.columns.size()) +
+      " columns cannot be appended to a table of " +
+      DataType::convert<std::string, uint>(ncol()));
+  for (uint j = 0; j != ncol(); ++j)
+    if (batch.columns[j].type != _schema[j])
+      throw std::invalid_argument(
+        "column " + DataType::convert<std::string, uint>(j + 1) +
+        " of a batch does not have the type of the table's");
+  const std::size_t encoded = encodedColumns();
+  for (uint j = 0; j != ncol(); ++j) _columns[j].gather(batch.columns[j], nullptr, batch.nrow);
+  _nrow += batch.nrow;
+  inserted(encoded, batch.nrow);
+}
+
+std::size_t
+ColumnRdbTable::encodedColumns() const {
+  std::size_t n = 0;
+  for (const auto& c: _columns) n += c.encoded ? 1 : 0;
+  return n;
+}
+
+void
+ColumnRdbTable::inserted(const std::size_t encoded, const uint n) {
+  //the columns decoded by inserts are encoded again once there are
+  //enough rows inserted after that, rather than at each of them
+  if (encodedColumns() < encoded) _dirty = true;
+  if (_dirty) {
+    _dirtyRows += n;
+    if (_dirtyRows >= std::max(reencodeRows, _nrow / 8)) {
+      encode();
+      _dirty = false;
+      _dirtyRows = 0;
+    }
+  }
+  _encoded = encodedColumns() != 0;
+}
+
+void
+ColumnRdbTable::encode() {
+  for (auto& c: _columns) {
+    c.encode();
+    _encoded = _encoded or c.encoded;
+  }
+}
+
+RdbBatch
+ColumnRdbTable::decodedBatch(const uint first, const uint n) const {
+  RdbBatch b = encodedBatch(first, n);
+  auto columns = std::make_shared< std::vector<RdbColumn> >();
+  for (const auto& s: b.columns)
+    if (s.encoded) columns->emplace_back(s.type);
+  std::size_t k = 0;
+  for (auto& s: b.columns) {
+    if (not s.encoded) continue;
+    RdbColumn& c = (*columns)[k++];
+    c.gather(s, nullptr, n);
+    s = c.span(0, n);
+  }
+  b.owned = columns;
+  return b;
+}
+
+namespace {
+  //n rows of strings, the i-th of which is data[row(i)]
+  template<typename Row>
+  RdbBatch stringBatch(const std::vector<StrRdbRow>& data, const uint ncol,
+                       const uint n, const Row& row) {
+    auto columns = std::make_shared< std::vector<RdbColumn> >(ncol, RdbColumn(ColumnType::String));
+    for (uint i = 0; i != n; ++i) {
+      const StrRdbRow& r = data[row(i)];
+      for (uint j = 0; j != ncol; ++j) {
+        RdbColumn& c = (*columns)[j];
+        c.blob.append(r.getString(j + 1));
+        c.offsets.push_back(c.blob.size());
+      }
+    }
+    RdbBatch b;
+    b.nrow = n;
+    for (const auto& c: *columns) b.columns.push_back(c.span(0, n));
+    b.owned = columns;
+    return b;
+  }
+}
+
+RdbBatch
+StrRowRdbTable::batch(const uint first, const uint n) const {
+  return stringBatch(_data, _ncol, n, [first] (const uint i) { return first + i;});
+}
+
+RdbBatch
+StrRowRdbTable::gather(const uint* indexes, const uint n) const {
+  return stringBatch(_data, _ncol, n, [indexes] (const uint i) { return indexes[i];});
+}
+
+RdbBatch
+ColumnRdbTable::gather(const uint* indexes, const uint n) const {
+  auto columns = std::make_shared< std::vector<RdbColumn> >();
+  for (const auto& c: _columns) {
+    columns->emplace_back(c.type);
+    columns->back().gather(c.span(0, _nrow), indexes, n);
+  }
+  RdbBatch b;
+  b.nrow = n;
+  for (const auto& c: *columns) b.columns.push_back(c.span(0, n));
+  b.owned = columns;
+  return b;
+}
+
+void
+RdbIndex::insert(const RdbColumnSpan& values, const uint first) {
+  if (text()) {
+    std::vector< RdbKeyIndex<std::string>::Entry > entries;
+    entries.reserve(values.size);
+    for (uint i = 0; i != values.size; ++i)
+      entries.emplace_back(std::string(values.stringView(i)), first + i);
+    _strings.insert(std::move(entries));
+  } else {
+    std::vector< RdbKeyIndex<double>::Entry > entries;
+    entries.reserve(values.size);
+    for (uint i = 0; i != values.size; ++i) entries.emplace_back(values.get<double>(i), first + i);
+    _numbers.insert(std::move(entries));
+  }
+}
+
+void
+RdbZoneMap::insert(const RdbColumnSpan& values) {
+  if (text())
+    for (uint i = 0; i != values.size; ++i) _strings.append(std::string(values.stringView(i)));
+  else
+    for (uint i = 0; i != values.size; ++i) _numbers.append(values.get<double>(i));
+}
+
+RdbBatch
+DbSim::batch(const std::string& table, const uint first, const uint n) const {
+  if (hasColumnTable(table)) return columnTable(table)->batch(first, n);
+  return this->table(table)->batch(first, n);
+}
+
+void
+DbSim::createIndex(const std::string& table, const uint column, const IndexKind kind) {
+  if (not hasTable(table) and not hasColumnTable(table))
+    throw std::invalid_argument("there is no table " + table + " to index");
+  const uint nrow = hasColumnTable(table) ? columnTable(table)->size() : this->table(table)->size();
+  const RdbBatch all = batch(table, 0, nrow);
+  if (column == 0 or column > all.columns.size())
+    throw std::invalid_argument (
+        "an index of column " +
+        DataType::convert<std::string, uint>(column) +
+        " of a table of " +
+        DataType::convert<std::string, std::size_t>(all.columns.size()) + " columns");
+  RdbIndex index(kind, all.columns[column - 1].type);
+  index.insert(all.columns[column - 1], 0);
+  auto& indexes = _indexes[table];
+  indexes.erase(column);
+  indexes.emplace(column, std::move(index));
+}
+
+const RdbIndex*
+DbSim::index(const std::string& table, const uint column) const {
+  const auto t = _indexes.find(table);
+  if (t == _indexes.end()) return nullptr;
+  const auto c = t->second.find(column);
+  return c == t->second.end() ? nullptr : &c->second;
+}
+
+void
+DbSim::insertRow(const std::string& table, const std::vector<std::string>& row) {
+  uint last = 0;
+  if (hasColumnTable(table)) {
+    ColumnRdbTable& t = _columnTables.at(table);
+    t.insert(row);
+    last = t.size() - 1;
+  } else {
+    StrRowRdbTable& t = _tables.at(table);
+    t.insert(row);
+    last = t.size() - 1;
+  }
+  const RdbBatch added = batch(table, last, 1);
+  for (uint j = 0; j != added.columns.size(); ++j) _zones.at(table)[j].insert(added.columns[j]);
+  const auto indexes = _indexes.find(table);
+  if (indexes == _indexes.end()) return;
+  for (auto& [column, index]: indexes->second) index.insert(added.columns[column - 1], last);
+}
+
+const RdbZoneMap*
+DbSim::zoneMap(const std::string& table, const uint column) const {
+  const auto t = _zones.find(table);
+  if (t == _zones.end() or column == 0 or column > t->second.size()) return nullptr;
+  return &t->second[column - 1];
+}
+
+void
+DbSim::mapZones(const std::string& table) {
+  const uint nrow = hasColumnTable(table) ? columnTable(table)->size() : this->table(table)->size();
+  std::vector<RdbZoneMap> zones;
+  for (const auto& c: batch(table, 0, 0).columns) zones.emplace_back(c.type, _zoneRows);
+  //a block at a time, decoded
+  for (uint first = 0; first < nrow; first += (uint) _zoneRows) {
+    const RdbBatch rows = batch(table, first, std::min<uint>(nrow - first, (uint) _zoneRows));
+    for (uint j = 0; j != zones.size(); ++j) zones[j].insert(rows.columns[j]);
+  }
+  _zones[table] = std::move(zones);
+}
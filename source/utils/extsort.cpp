@@ -0,0 +1,108 @@
+#include "extsort.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+  //the fewest records worth sorting as a chunk of their own
+  const std::size_t sortChunkRecords = 1 << 12;
+  //the buffer of each run file
+  const std::size_t runBufferBytes = 1 << 16;
+
+  std::shared_ptr<std::FILE> temporaryFile() {
+    std::FILE* f = std::tmpfile();
+    if (not f) throw std::runtime_error("a sort could not open a temporary file for its runs");
+    std::setvbuf(f, nullptr, _IOFBF, runBufferBytes);
+    return std::shared_ptr<std::FILE>(f, std::fclose);
+  }
+
+  //a record is the sizes of its key and payload, then their bytes
+  void writeRecord(std::FILE* f, const SortRecord& r) {
+    const uint32_t sizes[2] = {(uint32_t) r.key.size(), (uint32_t) r.payload.size()};
+    if (std::fwrite(sizes, sizeof(sizes), 1, f) != 1 or
+        std::fwrite(r.key.data(), 1, r.key.size(), f) != r.key.size() or
+        std::fwrite(r.payload.data(), 1, r.payload.size(), f) != r.payload.size())
+      throw std::runtime_error("a sort could not write a run to a temporary file");
+  }
+
+  bool readRecord(std::FILE* f, SortRecord& r) {
+    uint32_t sizes[2];
+    if (std::fread(sizes, sizeof(sizes), 1, f) != 1) return false;
+    r.key.resize(sizes[0]);
+    r.payload.resize(sizes[1]);
+    if (std::fread(&r.key[0], 1, sizes[0], f) != sizes[0] or
+        std::fread(&r.payload[0], 1, sizes[1], f) != sizes[1])
+      throw std::runtime_error("a sort could not read a run back from a temporary file");
+    return true;
+  }
+}
+
+bool ExternalSort::Run::advance() {
+  if (file) return readRecord(file.get(), head);
+  return ++position != records.size();
+}
+
+ExternalSort::ExternalSort(const std::size_t budget, ThreadPool& pool) :
+  _budget(budget), _pool(&pool) {}
+
+void ExternalSort::add(std::string key, std::string payload) {
+  if (_merging) throw std::logic_error("records cannot be added to a sort once it is read");
+  _buffered += key.size() + payload.size() + sizeof(SortRecord);
+  _buffer.push_back(SortRecord{std::move(key), std::move(payload)});
+  ++_size;
+  if (_buffered >= _budget) spill();
+}
+
+std::vector<ExternalSort::Run> ExternalSort::sortBuffer() {
+  const std::size_t n = _buffer.size();
+  const std::size_t nchunks = std::max<std::size_t>(
+    1, std::min<std::size_t>(_pool->size() + 1, n / sortChunkRecords));
+  const std::size_t length = (n + nchunks - 1) / nchunks;
+  std::vector<Run> runs(nchunks);
+  _pool->parallelFor(nchunks, [&] (const std::size_t c) {
+      const auto first = _buffer.begin() + (std::ptrdiff_t) std::min(n, c * length);
+      const auto last = _buffer.begin() + (std::ptrdiff_t) std::min(n, (c + 1) * length);
+      std::vector<SortRecord>& records = runs[c].records;
+      records.assign(std::make_move_iterator(first), std::make_move_iterator(last));
+      std::stable_sort(records.begin(), records.end(),
+                       [] (const SortRecord& a, const SortRecord& b) { return a.key < b.key;});
+    });
+  _buffer.clear();
+  _buffered = 0;
+  runs.erase(std::remove_if(runs.begin(), runs.end(),
+                            [] (const Run& r) { return r.records.empty();}),
+             runs.end());
+  return runs;
+}
+
+void ExternalSort::spill() {
+  std::vector<Run> runs = sortBuffer();
+  if (runs.empty()) return;
+  const std::shared_ptr<std::FILE> file = temporaryFile();
+  LoserTree<RunsBefore> tree(runs.size(), RunsBefore{&runs});
+  for (std::size_t r = tree.top(); r != tree.None; r = tree.top()) {
+    writeRecord(file.get(), runs[r].current());
+    tree.replay(not runs[r].advance());
+  }
+  _files.push_back(file);
+}
+
+const SortRecord* ExternalSort::next() {
+  if (not _merging) {
+    _merging = true;
+    //the runs in the order of their records, the files then the buffer
+    for (const auto& f: _files) {
+      if (std::fseek(f.get(), 0, SEEK_SET) != 0)
+        throw std::runtime_error("a sort could not read a run back from a temporary file");
+      Run run;
+      run.file = f;
+      if (run.advance()) _runs.push_back(std::move(run));
+    }
+    for (auto& run: sortBuffer()) _runs.push_back(std::move(run));
+    _tree.emplace(_runs.size(), RunsBefore{&_runs});
+  } else if (_tree->top() != _tree->None) {
+    //the record returned last is done with
+    _tree->replay(not _runs[_tree->top()].advance());
+  }
+  const std::size_t r = _tree->top();
+  return r == _tree->None ? nullptr : &_runs[r].current();
+}
@@ -0,0 +1,106 @@
+#include "threadpool.h"
+#include <algorithm>
+
+namespace {
+  //the pool and queue of the worker running on this thread
+  thread_local const ThreadPool* currentPool = nullptr;
+  thread_local unsigned currentQueue = 0;
+}
+
+ThreadPool::ThreadPool(const unsigned nthreads) :
+  _queues(std::max(1U, nthreads)) {
+  for (unsigned i = 0; i != nthreads; ++i)
+    _workers.emplace_back([this, i] () { work(i); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _ready.notify_all();
+  for (auto& w: _workers) w.join();
+  for (auto& q: _queues)
+    for (auto job: q.jobs) delete job;
+}
+
+ThreadPool& ThreadPool::shared() {
+  static ThreadPool pool(std::max(1U, std::thread::hardware_concurrency()));
+  return pool;
+}
+
+unsigned ThreadPool::home() const {
+  if (currentPool == this) return currentQueue;
+  return _next.load(std::memory_order_relaxed) % (unsigned) _queues.size();
+}
+
+void ThreadPool::push(Job* job) {
+  const unsigned q = currentPool == this ?
+    currentQueue : _next++ % (unsigned) _queues.size();
+  //counted before it can be taken, the count never goes below zero
+  ++_pending;
+  {
+    std::lock_guard<std::mutex> lock(_queues[q].mutex);
+    _queues[q].jobs.push_back(job);
+  }
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+  }
+  _ready.notify_one();
+}
+
+void ThreadPool::wake() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_helping == 0) return;
+  }
+  _ready.notify_all();
+}
+
+ThreadPool::Job* ThreadPool::take(const unsigned home) {
+  const unsigned n = (unsigned) _queues.size();
+  {
+    Queue& own = _queues[home];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (not own.jobs.empty()) {
+      Job* job = own.jobs.back();
+      own.jobs.pop_back();
+      --_pending;
+      return job;
+    }
+  }
+  for (unsigned k = 1; k != n; ++k) {
+    Queue& other = _queues[(home + k) % n];
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (not other.jobs.empty()) {
+      Job* job = other.jobs.front();
+      other.jobs.pop_front();
+      --_pending;
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+bool ThreadPool::runPending() {
+  Job* job = take(home());
+  if (not job) return false;
+  job->run();
+  delete job;
+  return true;
+}
+
+void ThreadPool::work(const unsigned index) {
+  currentPool = this;
+  currentQueue = index;
+  while (true) {
+    if (Job* job = take(index)) {
+      job->run();
+      delete job;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(_mutex);
+    _ready.wait(lock, [this] () { return _stopping or _pending > 0; });
+    if (_stopping and _pending == 0) return;
+  }
+}
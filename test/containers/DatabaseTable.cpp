@@ -9,6 +9,7 @@
 #include "DatabaseTable.h"
 #include "DataFrame.h"
 #include "TupleFrame.h"
+#include "format.h"
 #include "catch.hpp"
 
 TEST_CASE("Database Table typed using a parameter pack", "[DatabaseTable]") {
@@ -82,6 +83,23 @@ TEST_CASE("Database Table typed using a parameter pack", "[DatabaseTable]") {
         REQUIRE( std::get<2>(tup) == wordyInteger(i));        i += 1;
       }      //delete query;
     }
+
+    SECTION ("load two queries at once") {
+      DbSim dbsim;
+      dbsim.insert("table", StrRowRdbTable(3, table));
+      DbconnClassSim conn(dbsim);
+      DbQuerySim query = conn.query();
+      query << "table";
+      //the same table, scanned by a cursor of its own
+      DbQuerySim copyQuery = conn.query();
+      copyQuery << "table";
+      DatabaseTable< double, int, std::string > dbt("test");
+      DatabaseTable< double, int, std::string > dbc("copy");
+      const auto loaded = Async::when_all(dbt.loadQueryAsync(query), dbc.loadQueryAsync(copyQuery));
+      REQUIRE(loaded.get() == std::make_tuple((uint) table.size(), (uint) table.size()));
+      REQUIRE(dbt.data() == dbc.data());
+      REQUIRE( std::get<2>(dbc.data()[42]) == wordyInteger(42));
+    }
 }
 
 TEST_CASE("A tuple of vectors ", "[VectorizedTuple]") {
@@ -225,3 +243,144 @@ TEST_CASE("Read a result", "[ReadResult]") {
   }
 
 }
+
+TEST_CASE("Load frames from a result read in batches", "[DatabaseTable], [DataFrame], [RDBbatch]") {
+  using string = std::string;
+  std::vector<std::vector<string> > table;
+  for (uint i = 0; i != 10000; ++i) {
+    std::vector<string> row{
+      DataType::convert<string, double>((double) i),
+        DataType::convert<string, uint>(i),
+        wordyInteger(i % 1000) };
+    table.push_back(row);
+  }
+  const ColumnRdbTable columns(
+    {ColumnType::Double, ColumnType::Int, ColumnType::String}, table);
+
+  SECTION("a DataFrame, a column at a time") {
+    const auto c = columns.cursor();
+    DataFrame< double, int, std::string > df(&c);
+    REQUIRE( df.nrow() == table.size());
+    for (uint x = 0; x < df.nrow(); x += 97) {
+      REQUIRE(df.element<0>(x) == (double) x);
+      REQUIRE(df.element<1>(x) == (int) x);
+      REQUIRE(df.element<2>(x) == wordyInteger(x % 1000));
+    }
+  }
+
+  SECTION("a TupleFrame, the same rows as a table of strings") {
+    const auto c = columns.cursor();
+    TupleFrame< double, int, std::string > fromColumns(&c);
+    StrRowRdbTable strings(3, table);
+    TupleFrame< double, int, std::string > fromStrings(&strings);
+    REQUIRE( fromColumns.nrow() == table.size());
+    REQUIRE( fromColumns() == fromStrings());
+  }
+
+  SECTION("the rows of a TupleFrame, as text") {
+    StrRowRdbTable strings(3, {table[0], table[1]});
+    TupleFrame< double, int, std::string > tf(&strings);
+    Format::TextBuilder text;
+    text.rows(tf);
+    CHECK( text.str() == "0\t0\t\n1\t1\tone\n");
+    Format::TextBuilder csv;
+    csv.rows(tf, {"", ",", ";"});
+    CHECK( csv.str() == "0,0,;1,1,one;");
+  }
+
+  SECTION("a TupleFrame, N rows at a time") {
+    const auto c = columns.cursor();
+    TupleFrame< double, int, std::string > tf;
+    tf.loadNext(&c, 4000);
+    REQUIRE( tf.nrow() == 4000);
+    tf.loadNext(&c, 4000);
+    REQUIRE( tf.nrow() == 8000);
+    REQUIRE( std::get<1>(tf[4000]) == 4000);
+  }
+
+  SECTION("a DatabaseTable") {
+    const auto c = columns.cursor();
+    DatabaseTable< double, int, std::string > dbt("columns");
+    dbt.loadResult(&c);
+    REQUIRE( dbt.data().size() == table.size());
+    REQUIRE( std::get<2>(dbt.data()[1234]) == wordyInteger(234));
+  }
+}
+
+TEST_CASE("Group the rows of a DataFrame", "[DataFrame], [groupby]") {
+  using string = std::string;
+  std::vector<std::vector<string> > table;
+  for (uint i = 0; i != 1000; ++i) {
+    std::vector<string> row{
+      DataType::convert<string, double>(i / 10.0),
+        DataType::convert<string, int>((int) (i % 7)),
+        wordyInteger(i % 5) };
+    table.push_back(row);
+  }
+  StrRowRdbTable res(3, table);
+  DataFrame< double, int, std::string > df(&res);
+
+  const auto counts = df.groupBy<2, 0>(AggregateOp::Count);
+  REQUIRE( counts.size() == 5);
+  REQUIRE( counts[0].first == wordyInteger(0));
+  REQUIRE( counts[0].second == 200);
+
+  const auto sums = df.groupBy<1, 0>(AggregateOp::Sum);
+  REQUIRE( sums.size() == 7);
+  double sum = 0;
+  for (uint i = 3; i < 1000; i += 7) sum += i / 10.0;
+  REQUIRE( sums[3].first == 3);
+  REQUIRE( sums[3].second == Approx(sum));
+}
+
+TEST_CASE("Sort the rows of a DataFrame", "[DataFrame], [extsort]") {
+  using string = std::string;
+  std::vector<std::vector<string> > table;
+  for (uint i = 0; i != 5000; ++i) {
+    std::vector<string> row{
+      DataType::convert<string, double>((double) ((i * 37) % 100) / 4),
+        DataType::convert<string, int>((int) i),
+        wordyInteger(i % 3 + 1) };
+    table.push_back(row);
+  }
+  StrRowRdbTable res(3, table);
+  DataFrame< double, int, std::string > df(&res);
+
+  df.orderBy<2, 0>({false, true}, 1 << 14);
+  REQUIRE( df.nrow() == 5000);
+  REQUIRE( df.element<2>(0) == "one");
+  REQUIRE( df.element<2>(4999) == "two");
+  for (uint i = 1; i != df.nrow(); ++i) {
+    REQUIRE( df.element<2>(i - 1) <= df.element<2>(i));
+    if (df.element<2>(i - 1) != df.element<2>(i)) continue;
+    REQUIRE( df.element<0>(i - 1) >= df.element<0>(i));
+    if (df.element<0>(i - 1) == df.element<0>(i)) REQUIRE( df.element<1>(i - 1) < df.element<1>(i));
+    //each row is still whole
+    REQUIRE( df.element<0>(i) == (double) ((df.element<1>(i) * 37) % 100) / 4);
+  }
+}
+
+TEST_CASE("Scan the rows of a DataFrame with zone maps", "[DataFrame], [zonemap]") {
+  using string = std::string;
+  std::vector<std::vector<string> > table;
+  const uint n = 3 * defaultZoneRows + 100;
+  for (uint i = 0; i != n; ++i)
+    table.push_back({DataType::convert<string, uint>(i / 2), wordyInteger(i % 3 + 1)});
+  const ColumnRdbTable columns({ColumnType::UInt, ColumnType::String}, table);
+  const auto c = columns.cursor();
+  DataFrame< uint, std::string > df(&c);
+
+  REQUIRE( df.zoneMap<0>().size() == 4);
+  REQUIRE( df.zoneMap<0>().zone(1).min == defaultZoneRows / 2);
+  REQUIRE( df.zoneMap<1>().zone(0).max == "two");
+  const std::vector<uint> rows = df.rangeRows<0>(50000, false, 50003, true);
+  REQUIRE( rows == std::vector<uint>{100002, 100003, 100004, 100005, 100006, 100007});
+  REQUIRE( df.equalRows<0>(7) == std::vector<uint>{14, 15});
+  REQUIRE( df.equalRows<1>("three").size() == n / 3);
+  REQUIRE( df.rangeRows<0>(std::nullopt, true, 0, false).empty());
+
+  //sorted the other way round, the zone maps are those of the rows as they are now
+  df.orderBy<0>({true});
+  REQUIRE( df.zoneMap<0>().zone(0).max == (n - 1) / 2);
+  REQUIRE( df.equalRows<0>(0) == std::vector<uint>{n - 2, n - 1});
+}
@@ -0,0 +1,171 @@
+#include <vector>
+#include <string>
+#include <tuple>
+#include <algorithm>
+#include "util.h"
+#include "datatypes.h"
+#include "RelationalDatabaseSim.h"
+#include "RdbJoin.h"
+#include "RdbQuery.h"
+#include "catch.hpp"
+
+namespace {
+  //the rows of a table, in order, to compare with a join done by hand
+  std::vector< std::vector<std::string> > sortedRows(const ColumnRdbTable& t) {
+    std::vector< std::vector<std::string> > rows(t.nrow());
+    for (uint i = 0; i != t.nrow(); ++i)
+      for (uint j = 1; j <= t.ncol(); ++j) rows[i].push_back(t.getString(i, j));
+    std::sort(rows.begin(), rows.end());
+    return rows;
+  }
+}
+
+TEST_CASE("A hash index from keys to rows", "[RDBSim], [RdbJoin]") {
+  SECTION("rows with the same key, in order") {
+    const std::vector<double> keys{3, 1, 3, 2, 3, -0.0};
+    const std::vector<uint> rows{10, 11, 12, 13, 14, 15};
+    const RdbHashIndex<double> index(keys, rows);
+    std::vector<uint> found;
+    const auto find = [&] (const double k) {
+      found.clear();
+      index.find(k, RdbHashIndex<double>::hash(k), [&] (uint r) { found.push_back(r);});
+      return found;
+    };
+    REQUIRE( find(3) == std::vector<uint>{10, 12, 14});
+    REQUIRE( find(2) == std::vector<uint>{13});
+    REQUIRE( find(0.0) == std::vector<uint>{15});
+    REQUIRE( find(4).empty());
+  }
+
+  SECTION("more keys than fit in cache are partitioned") {
+    std::vector<double> keys;
+    std::vector<uint> rows;
+    for (uint i = 0; i != 100000; ++i) {
+      keys.push_back(i * 7.0);
+      rows.push_back(i);
+    }
+    const RdbHashIndex<double> index(keys, rows);
+    REQUIRE( index.partitions() > 1);
+    uint matched = 0;
+    for (uint i = 0; i != 100000; ++i) {
+      const double k = i * 7.0;
+      index.find(k, RdbHashIndex<double>::hash(k), [&] (uint r) { matched += r == i;});
+    }
+    REQUIRE( matched == 100000);
+  }
+
+  SECTION("an empty index") {
+    const RdbHashIndex<std::string_view> index;
+    bool found = false;
+    index.find("x", RdbHashIndex<std::string_view>::hash("x"), [&] (uint) { found = true;});
+    REQUIRE_FALSE( found);
+  }
+}
+
+TEST_CASE("Hash joins of tables of a database simulator", "[RDBSim], [RdbJoin]") {
+  //orders: id, customer, amount; customers: id, name
+  std::vector<std::vector<std::string> > orders;
+  for (uint i = 0; i != 20000; ++i)
+    orders.push_back({DataType::convert<std::string, uint>(i),
+          DataType::convert<std::string, uint>(i % 700),
+          DataType::convert<std::string, double>(i / 2.0)});
+  std::vector<std::vector<std::string> > customers;
+  for (uint i = 0; i != 500; ++i)
+    customers.push_back({DataType::convert<std::string, uint>(i), "customer" + std::to_string(i % 50)});
+  const ColumnRdbTable orderColumns({ColumnType::UInt, ColumnType::Int, ColumnType::Double}, orders);
+  const ColumnRdbTable customerColumns({ColumnType::UInt, ColumnType::String}, customers);
+
+  //the join, with nested loops
+  std::vector< std::vector<std::string> > expected;
+  for (uint o = 0; o != orders.size(); ++o)
+    for (uint c = 0; c != customers.size(); ++c)
+      if (o % 700 == c) {
+        std::vector<std::string> row{orderColumns.getString(o, 1),
+            orderColumns.getString(o, 2), orderColumns.getString(o, 3),
+            customers[c][0], customers[c][1]};
+        expected.push_back(row);
+      }
+  std::sort(expected.begin(), expected.end());
+
+  SECTION("columnar tables, numeric keys of different types") {
+    const ColumnRdbTable joined = hashJoin(orderColumns, customerColumns, 2, 1);
+    REQUIRE( joined.schema() == ColumnRdbTable::Schema{ColumnType::UInt, ColumnType::Int,
+          ColumnType::Double, ColumnType::UInt, ColumnType::String});
+    REQUIRE( joined.nrow() == expected.size());
+    REQUIRE( sortedRows(joined) == expected);
+  }
+
+  SECTION("the smaller table on either side") {
+    const ColumnRdbTable joined = hashJoin(customerColumns, orderColumns, 1, 2);
+    REQUIRE( joined.nrow() == expected.size());
+    for (uint i = 0; i != joined.nrow(); ++i)
+      REQUIRE( joined.getUInt(i, 1) == (uint) joined.getInt(i, 4));
+  }
+
+  SECTION("tables of strings join on strings") {
+    const StrRowRdbTable left(2, customers);
+    StrRowRdbTable right(2);
+    for (uint i = 0; i != 50; ++i)
+      right.insert(std::vector<std::string>{"customer" + std::to_string(i), std::to_string(i * i)});
+    const ColumnRdbTable joined = hashJoin(left, right, 2, 1);
+    REQUIRE( joined.nrow() == 500);
+    for (uint i = 0; i != joined.nrow(); ++i) {
+      REQUIRE( joined.getString(i, 2) == joined.getString(i, 3));
+      const uint c = joined.getUInt(i, 1) % 50;
+      REQUIRE( joined.getUInt(i, 4) == c * c);
+    }
+  }
+
+  SECTION("a key that is not a column") {
+    REQUIRE_THROWS_AS( hashJoin(orderColumns, customerColumns, 4, 1), std::invalid_argument);
+  }
+
+  DbSim dbsim;
+  dbsim.insert("orders", orderColumns);
+  dbsim.insert("customers", customerColumns);
+  dbsim.insert("customerStrings", StrRowRdbTable(2, customers));
+
+  SECTION("a join in a query") {
+    REQUIRE( sortedRows(hashJoin(dbsim, "orders", "customers", 2, 1)) == expected);
+    REQUIRE( sortedRows(hashJoin(dbsim, "orders", "customerStrings", 2, 1)) == expected);
+  }
+
+  SECTION("filters on both tables, and a projection") {
+    const ColumnRdbTable result = RdbQuery::scan("customers")
+      .join("orders", 1, 2)
+      .filter(col(2) == "customer7")
+      .filter(col(5) < 5000)
+      .project({5, 1})
+      .execute(dbsim);
+    uint n = 0;
+    for (const auto& row: expected)
+      n += row[4] == "customer7" and std::stod(row[2]) < 5000;
+    REQUIRE( result.nrow() == n);
+    for (uint i = 0; i != result.nrow(); ++i) {
+      REQUIRE( result.getDouble(i, 1) < 5000);
+      REQUIRE( result.getUInt(i, 2) % 50 == 7);
+    }
+  }
+
+  SECTION("a limit, over batches of matches") {
+    auto result = RdbQuery::scan("orders").join("customers", 2, 1).limit(1000).open(dbsim);
+    uint n = 0;
+    for (auto batch = result.nextBatch(333); batch.nrow != 0; batch = result.nextBatch(333)) {
+      REQUIRE( batch.nrow <= 333);
+      n += batch.nrow;
+    }
+    REQUIRE( n == 1000);
+  }
+
+  SECTION("aggregates over a join") {
+    const ColumnRdbTable result = RdbQuery::scan("orders")
+      .join("customers", 2, 1)
+      .aggregate({RdbAggregate::count(), RdbAggregate::sum(3), RdbAggregate::max(4)})
+      .execute(dbsim);
+    double sum = 0;
+    for (const auto& row: expected) sum += std::stod(row[2]);
+    REQUIRE( result.getUInt(0, 1) == expected.size());
+    REQUIRE( result.getDouble(0, 2) == Approx(sum));
+    REQUIRE( result.getDouble(0, 3) == 499);
+  }
+}
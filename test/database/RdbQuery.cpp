@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <map>
+#include <string>
+#include "util.h"
+#include "datatypes.h"
+#include "RelationalDatabaseSim.h"
+#include "RdbQuery.h"
+#include "DataFrame.h"
+#include "catch.hpp"
+
+
+TEST_CASE("Queries over the tables of a database simulator", "[RDBSim], [RdbQuery]") {
+  std::vector<std::vector<std::string> > table;
+  for (uint i = 0; i != 10000; ++i) {
+    std::vector<std::string> row{ DataType::convert<std::string, double>(i / 4.0),
+        DataType::convert<std::string, int>((int) i - 5000),
+        i % 3 == 0 ? "fizz" : "buzz"};
+    table.push_back(row);
+  }
+  DbSim dbsim;
+  dbsim.insert("columns", ColumnRdbTable(
+                 {ColumnType::Double, ColumnType::Int, ColumnType::String}, table));
+  dbsim.insert("strings", StrRowRdbTable(3, table));
+
+  SECTION("a scan of the whole table") {
+    const ColumnRdbTable all = RdbQuery::scan("columns").execute(dbsim);
+    REQUIRE( all.nrow() == 10000);
+    REQUIRE( all.schema() == dbsim.columnTable("columns")->schema());
+    REQUIRE( all.getInt(1234, 2) == 1234 - 5000);
+  }
+
+  SECTION("filters and a projection") {
+    const auto q = RdbQuery::scan("columns")
+      .filter(col(2) >= 0)
+      .filter(col(3) == "fizz")
+      .project({2, 1});
+    const ColumnRdbTable result = q.execute(dbsim);
+    REQUIRE( result.ncol() == 2);
+    REQUIRE( result.schema() == ColumnRdbTable::Schema{ColumnType::Int, ColumnType::Double});
+    uint n = 0;
+    for (uint i = 5000; i != 10000; ++i) {
+      if (i % 3 != 0) continue;
+      REQUIRE( result.getInt(n, 1) == (int) i - 5000);
+      REQUIRE( result.getDouble(n, 2) == i / 4.0);
+      ++n;
+    }
+    REQUIRE( result.nrow() == n);
+  }
+
+  SECTION("the same result from a table of strings") {
+    const auto query = [] (const std::string& name) {
+      return RdbQuery::scan(name)
+      .filter(col(1) < 100)
+      .filter(col(3) != "fizz")
+      .project({3, 2});
+    };
+    const ColumnRdbTable fromStrings = query("strings").execute(dbsim);
+    const ColumnRdbTable fromColumns = query("columns").execute(dbsim);
+    REQUIRE( fromStrings.nrow() == 400 - 134);
+    REQUIRE( fromColumns.nrow() == fromStrings.nrow());
+    REQUIRE( fromStrings.schema() == ColumnRdbTable::Schema(2, ColumnType::String));
+    for (uint i = 0; i != fromStrings.nrow(); ++i) {
+      REQUIRE( fromStrings.getString(i, 1) == fromColumns.getString(i, 1));
+      REQUIRE( fromStrings.getInt(i, 2) == fromColumns.getInt(i, 2));
+    }
+    REQUIRE( fromStrings.getInt(0, 2) == 1 - 5000);
+  }
+
+  SECTION("a limit stops the scan") {
+    auto result = RdbQuery::scan("columns").filter(col(3) == "fizz").limit(10).open(dbsim);
+    const auto batch = result.nextBatch(1000);
+    REQUIRE( batch.nrow == 10);
+    REQUIRE( batch.columns[1].ints[9] == 27 - 5000);
+    REQUIRE( result.scanned() == 28);
+    REQUIRE( result.nextBatch(1000).nrow == 0);
+  }
+
+  SECTION("batches of a result continue where the last one stopped") {
+    auto result = RdbQuery::scan("columns").filter(col(2) < -4000).project({2}).open(dbsim);
+    std::vector<int> xs;
+    for (auto batch = result.nextBatch(7); batch.nrow != 0; batch = result.nextBatch(7)) {
+      REQUIRE( batch.nrow <= 7);
+      batch.columns[0].appendTo(xs);
+    }
+    REQUIRE( xs.size() == 1000);
+    for (uint i = 0; i != xs.size(); ++i) REQUIRE( xs[i] == (int) i - 5000);
+  }
+
+  SECTION("aggregates") {
+    const ColumnRdbTable result = RdbQuery::scan("columns")
+      .filter(col(3) == "fizz")
+      .aggregate({RdbAggregate::count(), RdbAggregate::sum(2), RdbAggregate::min(1),
+            RdbAggregate::max(1), RdbAggregate::avg(2)})
+      .execute(dbsim);
+    REQUIRE( result.nrow() == 1);
+    REQUIRE( result.getUInt(0, 1) == 3334);
+    double sum = 0;
+    for (int i = 0; i < 10000; i += 3) sum += i - 5000;
+    REQUIRE( result.getDouble(0, 2) == sum);
+    REQUIRE( result.getDouble(0, 3) == 0.0);
+    REQUIRE( result.getDouble(0, 4) == 9999 / 4.0);
+    REQUIRE( result.getDouble(0, 5) == Approx(sum / 3334));
+  }
+
+  SECTION("aggregates over no rows") {
+    const ColumnRdbTable result = RdbQuery::scan("columns")
+      .filter(col(1) > 1e9)
+      .aggregate({RdbAggregate::count(), RdbAggregate::sum(2), RdbAggregate::max(2)})
+      .execute(dbsim);
+    REQUIRE( result.nrow() == 1);
+    REQUIRE( result.getUInt(0, 1) == 0);
+    REQUIRE( result.getDouble(0, 2) == 0.0);
+    REQUIRE( std::isnan(result.getDouble(0, 3)));
+  }
+
+  SECTION("columns that are not in the table") {
+    REQUIRE_THROWS_AS( RdbQuery::scan("columns").filter(col(4) == 1).open(dbsim),
+                       std::invalid_argument);
+    REQUIRE_THROWS_AS( RdbQuery::scan("columns").project({0}).open(dbsim),
+                       std::invalid_argument);
+  }
+
+  SECTION("a data-frame loads the result of a query") {
+    auto result = RdbQuery::scan("columns").filter(col(2) >= 4990).project({3, 2}).open(dbsim);
+    DataFrame< std::string, int > df(&result);
+    REQUIRE( df.nrow() == 10);
+    REQUIRE( df.element<1>(0) == 4990);
+    REQUIRE( df.element<0>(0) == "fizz");
+  }
+}
+
+TEST_CASE("Group by in queries over a database simulator", "[RDBSim], [RdbQuery], [RdbGroupBy]") {
+  std::vector<std::vector<std::string> > table;
+  for (uint i = 0; i != 50000; ++i) {
+    std::vector<std::string> row{ DataType::convert<std::string, int>((int) (i % 37) - 18),
+        i % 2 == 0 ? "even" : "odd",
+        DataType::convert<std::string, double>((i % 1000) / 8.0)};
+    table.push_back(row);
+  }
+  DbSim dbsim;
+  dbsim.insert("columns", ColumnRdbTable(
+                 {ColumnType::Int, ColumnType::String, ColumnType::Double}, table));
+  dbsim.insert("strings", StrRowRdbTable(3, table));
+
+  std::map<int, Accumulator> byKey;
+  std::map<std::pair<int, std::string>, Accumulator> byBoth;
+  std::map<std::pair<int, std::string>, Accumulator> filtered;
+  for (uint i = 0; i != 50000; ++i) {
+    const std::pair<int, std::string> both{(int) (i % 37) - 18, i % 2 == 0 ? "even" : "odd"};
+    byKey[both.first].add((i % 1000) / 8.0);
+    byBoth[both].add((i % 1000) / 8.0);
+    if (i % 1000 >= 800) filtered[both].add((i % 1000) / 8.0);
+  }
+
+  SECTION("an integer key") {
+    const ColumnRdbTable result = RdbQuery::scan("columns")
+      .groupBy({1})
+      .aggregate({RdbAggregate::count(), RdbAggregate::sum(3), RdbAggregate::min(3),
+            RdbAggregate::max(3), RdbAggregate::avg(3)})
+      .execute(dbsim);
+    REQUIRE( result.schema() == ColumnRdbTable::Schema{ColumnType::Int, ColumnType::UInt,
+          ColumnType::Double, ColumnType::Double, ColumnType::Double, ColumnType::Double});
+    REQUIRE( result.nrow() == 37);
+    for (uint g = 0; g != result.nrow(); ++g) {
+      //groups in the order of their first row
+      REQUIRE( result.getInt(g, 1) == (int) g - 18);
+      const Accumulator& a = byKey[result.getInt(g, 1)];
+      REQUIRE( result.getUInt(g, 2) == a.count);
+      REQUIRE( result.getDouble(g, 3) == a.sum);
+      REQUIRE( result.getDouble(g, 4) == a.min);
+      REQUIRE( result.getDouble(g, 5) == a.max);
+      REQUIRE( result.getDouble(g, 6) == Approx(a.sum / (double) a.count));
+    }
+  }
+
+  SECTION("two keys, from a table of strings, with a filter and a limit") {
+    const auto query = [] (const std::string& name) {
+      return RdbQuery::scan(name)
+      .filter(col(3) >= 100)
+      .groupBy({2, 1})
+      .aggregate({RdbAggregate::sum(3), RdbAggregate::count()});
+    };
+    const ColumnRdbTable result = query("strings").execute(dbsim);
+    REQUIRE( result.nrow() == 74);
+    REQUIRE( result.schema() == ColumnRdbTable::Schema{ColumnType::String, ColumnType::String,
+          ColumnType::Double, ColumnType::UInt});
+    for (uint g = 0; g != result.nrow(); ++g) {
+      const Accumulator& a = filtered[{result.getInt(g, 2), result.getString(g, 1)}];
+      REQUIRE( result.getDouble(g, 3) == Approx(a.sum));
+      REQUIRE( result.getUInt(g, 4) == a.count);
+    }
+
+    auto limited = query("columns").limit(10).open(dbsim);
+    REQUIRE( limited.nextBatch(4).nrow == 4);
+    REQUIRE( limited.nextBatch(100).nrow == 6);
+    REQUIRE( limited.nextBatch(100).nrow == 0);
+  }
+
+  SECTION("a table grouped by itself") {
+    const ColumnRdbTable result = groupBy(*dbsim.columnTable("columns"), {1, 2},
+                                          {RdbAggregate::max(3)});
+    REQUIRE( result.nrow() == byBoth.size());
+    for (uint g = 0; g != result.nrow(); ++g)
+      REQUIRE( result.getDouble(g, 3) == byBoth[{result.getInt(g, 1), result.getString(g, 2)}].max);
+    REQUIRE_THROWS_AS( groupBy(*dbsim.columnTable("columns"), {}, {RdbAggregate::count()}),
+                       std::invalid_argument);
+  }
+}
+
+TEST_CASE("Order by in queries over a database simulator", "[RDBSim], [RdbQuery], [RdbOrderBy]") {
+  std::vector<std::vector<std::string> > table;
+  for (uint i = 0; i != 30000; ++i) {
+    std::vector<std::string> row{ DataType::convert<std::string, int>((int) ((i * 7919) % 101) - 50),
+        wordyInteger(i % 7 + 1),
+        DataType::convert<std::string, uint>(i)};
+    table.push_back(row);
+  }
+  DbSim dbsim;
+  dbsim.insert("columns", ColumnRdbTable(
+                 {ColumnType::Int, ColumnType::String, ColumnType::UInt}, table));
+  dbsim.insert("strings", StrRowRdbTable(3, table));
+
+  //by the word, then from the largest number, then in the order of the table
+  const auto sorted = [] (const ColumnRdbTable& t, const uint word, const uint number, const uint row) {
+    for (uint i = 1; i < t.nrow(); ++i) {
+      const std::string a = t.getString(i - 1, word), b = t.getString(i, word);
+      if (a != b) {
+        if (a > b) return false;
+        continue;
+      }
+      if (t.getInt(i - 1, number) != t.getInt(i, number)) {
+        if (t.getInt(i - 1, number) < t.getInt(i, number)) return false;
+        continue;
+      }
+      if (t.getUInt(i - 1, row) >= t.getUInt(i, row)) return false;
+    }
+    return true;
+  };
+
+  SECTION("in memory, and through temporary files") {
+    for (const std::size_t budget: {defaultSortBudget, std::size_t(1) << 16}) {
+      const ColumnRdbTable result = RdbQuery::scan("columns")
+        .orderBy({RdbOrder::asc(2), RdbOrder::desc(1)})
+        .sortMemory(budget)
+        .execute(dbsim);
+      REQUIRE( result.nrow() == 30000);
+      REQUIRE( result.schema() == dbsim.columnTable("columns")->schema());
+      REQUIRE( sorted(result, 2, 1, 3));
+    }
+  }
+
+  SECTION("with a filter, a projection and a limit, in batches") {
+    auto result = RdbQuery::scan("columns")
+      .filter(col(1) >= 0)
+      .project({3, 2, 1})
+      .orderBy({RdbOrder::asc(2), RdbOrder::desc(3)})
+      .limit(1000)
+      .open(dbsim);
+    ColumnRdbTable rows(result.schema());
+    for (auto batch = result.nextBatch(300); batch.nrow != 0; batch = result.nextBatch(300)) {
+      REQUIRE( batch.nrow <= 300);
+      rows.append(batch);
+    }
+    REQUIRE( rows.nrow() == 1000);
+    REQUIRE( sorted(rows, 2, 3, 1));
+    REQUIRE( rows.getString(0, 2) == "five");
+    REQUIRE( rows.getInt(0, 3) == 50);
+  }
+
+  SECTION("the groups of a group by") {
+    const ColumnRdbTable result = RdbQuery::scan("strings")
+      .groupBy({2})
+      .aggregate({RdbAggregate::count()})
+      .orderBy({RdbOrder::desc(1)})
+      .execute(dbsim);
+    REQUIRE( result.nrow() == 7);
+    REQUIRE( result.getString(0, 1) == "two");
+    REQUIRE( result.getString(6, 1) == "five");
+  }
+
+  SECTION("a table sorted by itself") {
+    const ColumnRdbTable result = orderBy(*dbsim.columnTable("columns"),
+                                          {RdbOrder::asc(2), RdbOrder::desc(1)}, 1 << 16);
+    REQUIRE( result.nrow() == 30000);
+    REQUIRE( sorted(result, 2, 1, 3));
+    //strings sort as strings
+    const ColumnRdbTable strings = orderBy(*dbsim.table("strings"), {RdbOrder::asc(1)});
+    REQUIRE( strings.getString(0, 1) == "-1");
+    REQUIRE_THROWS_AS( orderBy(*dbsim.table("strings"), {RdbOrder::asc(4)}), std::invalid_argument);
+    REQUIRE_THROWS_AS( RdbQuery::scan("strings").project({1}).orderBy({RdbOrder::asc(2)}).open(dbsim),
+                       std::invalid_argument);
+  }
+}
+
+TEST_CASE("Queries that find their rows with an index", "[RDBSim], [RdbQuery], [RdbIndex]") {
+  std::vector<std::vector<std::string> > table;
+  for (uint i = 0; i != 20000; ++i) {
+    std::vector<std::string> row{ DataType::convert<std::string, uint>(i),
+        wordyInteger(i % 9 + 1),
+        DataType::convert<std::string, double>((i * 7919) % 1000 / 10.0)};
+    table.push_back(row);
+  }
+  DbSim dbsim;
+  dbsim.insert("columns", ColumnRdbTable(
+                 {ColumnType::UInt, ColumnType::String, ColumnType::Double}, table));
+  dbsim.insert("strings", StrRowRdbTable(3, table));
+  DbSim plain = dbsim;
+  dbsim.createIndex("columns", 1, IndexKind::Sorted);
+  dbsim.createIndex("columns", 2, IndexKind::Hash);
+  dbsim.createIndex("columns", 3, IndexKind::Hash);
+  dbsim.createIndex("strings", 2, IndexKind::Sorted);
+
+  //the same result as a scan, from fewer rows
+  const auto same = [&] (const RdbQuery& q, const uint scanned) {
+    auto withIndex = q.open(dbsim);
+    auto withoutIndex = q.open(plain);
+    const ColumnRdbTable a = q.execute(dbsim);
+    const ColumnRdbTable b = q.execute(plain);
+    REQUIRE( a.nrow() == b.nrow());
+    for (uint i = 0; i != a.nrow(); ++i)
+      for (uint j = 1; j <= a.ncol(); ++j) REQUIRE( a.getString(i, j) == b.getString(i, j));
+    while (withIndex.nextBatch(defaultBatchRows).nrow != 0) {}
+    REQUIRE( withIndex.indexed());
+    REQUIRE_FALSE( withoutIndex.indexed());
+    REQUIRE( withIndex.scanned() == scanned);
+    return a.nrow();
+  };
+
+  SECTION("a range of a sorted index") {
+    REQUIRE( same(RdbQuery::scan("columns").filter(col(1) >= 1000).filter(col(1) < 1500), 500) == 500);
+    REQUIRE( same(RdbQuery::scan("columns").filter(col(1) > 19990), 9) == 9);
+    REQUIRE( same(RdbQuery::scan("columns").filter(col(1) <= "9"), 10) == 10);
+  }
+
+  SECTION("the smallest of the rows of several indexes, with the other filters") {
+    REQUIRE( same(RdbQuery::scan("columns").filter(col(2) == "four").filter(col(3) == 50)
+                  .filter(col(1) < 10000), 20) == 1);
+    REQUIRE( same(RdbQuery::scan("columns").filter(col(3) == 12.55), 0) == 0);
+  }
+
+  SECTION("strings of a table of strings") {
+    REQUIRE( same(RdbQuery::scan("strings").filter(col(2) >= "seven").filter(col(2) < "six")
+                  .project({1}).limit(100), 100) == 100);
+    REQUIRE_FALSE( RdbQuery::scan("strings").filter(col(1) == 3).open(dbsim).indexed());
+  }
+
+  SECTION("rows inserted after the index") {
+    dbsim.insertRow("columns", {"20000", "four", "50"});
+    const ColumnRdbTable result = RdbQuery::scan("columns")
+      .filter(col(2) == "four").filter(col(3) == 50).execute(dbsim);
+    REQUIRE( result.nrow() == 3);
+    REQUIRE( result.getUInt(2, 1) == 20000);
+  }
+
+  SECTION("aggregates and joins scan the rows of the index") {
+    const ColumnRdbTable sum = RdbQuery::scan("columns").filter(col(1) < 100)
+      .aggregate({RdbAggregate::sum(1)}).execute(dbsim);
+    REQUIRE( sum.getDouble(0, 1) == 4950);
+    const ColumnRdbTable joined = RdbQuery::scan("columns").join("strings", 1, 1)
+      .filter(col(1) < 100).execute(dbsim);
+    REQUIRE( joined.nrow() == 100);
+  }
+}
+
+TEST_CASE("Queries over encoded columns", "[RDBSim], [RdbQuery], [RDBencoding]") {
+  std::vector<std::vector<std::string> > table;
+  const auto word = [] (const uint i) { return wordyInteger(i % 7 + 1);};
+  const auto offset = [] (const uint i) { return (int) (i * 7919 % 1000) - 500;};
+  for (uint i = 0; i != 20000; ++i)
+    table.push_back({word(i), DataType::convert<std::string, uint>(i / 1000),
+        DataType::convert<std::string, int>(offset(i)), DataType::convert<std::string, uint>(i)});
+  DbSim dbsim;
+  dbsim.insert("columns", ColumnRdbTable(
+                 {ColumnType::String, ColumnType::UInt, ColumnType::Int, ColumnType::UInt}, table));
+  dbsim.insert("strings", StrRowRdbTable(4, table));
+  REQUIRE( dbsim.columnTable("columns")->encoding(1) == ColumnEncoding::Dictionary);
+  REQUIRE( dbsim.columnTable("columns")->encoding(2) == ColumnEncoding::RunLength);
+  REQUIRE( dbsim.columnTable("columns")->encoding(3) == ColumnEncoding::FrameOfReference);
+
+  //the same result as from the table of strings
+  const auto same = [&dbsim] (const auto& query) {
+    const ColumnRdbTable a = query("columns").execute(dbsim);
+    const ColumnRdbTable b = query("strings").execute(dbsim);
+    REQUIRE( a.nrow() == b.nrow());
+    for (uint i = 0; i != a.nrow(); ++i)
+      for (uint j = 1; j <= a.ncol(); ++j) REQUIRE( a.getString(i, j) == b.getString(i, j));
+    return a;
+  };
+
+  SECTION("filters on each encoding") {
+    const ColumnRdbTable result = same([] (const std::string& t) {
+        return RdbQuery::scan(t).filter(col(1) == "three").filter(col(2) >= 5)
+          .filter(col(3) < 0).project({1, 4});
+      });
+    uint n = 0;
+    for (uint i = 5000; i != 20000; ++i) {
+      if (word(i) != "three" or offset(i) >= 0) continue;
+      REQUIRE( result.getUInt(n, 2) == i);
+      ++n;
+    }
+    REQUIRE( result.nrow() == n);
+    REQUIRE( n > 0);
+  }
+
+  SECTION("aggregates of each encoding") {
+    const ColumnRdbTable result = same([] (const std::string& t) {
+        return RdbQuery::scan(t).filter(col(1) != "one")
+          .aggregate({RdbAggregate::count(), RdbAggregate::sum(2), RdbAggregate::min(3),
+                RdbAggregate::max(3), RdbAggregate::sum(3)});
+      });
+    double runs = 0, offsets = 0;
+    uint n = 0;
+    for (uint i = 0; i != 20000; ++i) {
+      if (word(i) == "one") continue;
+      ++n;
+      runs += i / 1000;
+      offsets += offset(i);
+    }
+    REQUIRE( result.getUInt(0, 1) == n);
+    REQUIRE( result.getDouble(0, 2) == runs);
+    REQUIRE( result.getDouble(0, 3) == -500);
+    REQUIRE( result.getDouble(0, 4) == 499);
+    REQUIRE( result.getDouble(0, 5) == offsets);
+  }
+
+  SECTION("a join on an encoded key") {
+    const ColumnRdbTable joined = RdbQuery::scan("columns").join("strings", 2, 4)
+      .filter(col(3) == 0).project({4, 5, 2}).execute(dbsim);
+    REQUIRE( joined.nrow() == 20);
+    std::vector<uint> rows;
+    for (uint i = 0; i != joined.nrow(); ++i) {
+      rows.push_back(joined.getUInt(i, 1));
+      REQUIRE( joined.getUInt(i, 3) == rows.back() / 1000);
+      REQUIRE( joined.getString(i, 2) == word(rows.back() / 1000));
+    }
+    std::sort(rows.begin(), rows.end());
+    for (uint k = 0; k != 20; ++k) REQUIRE( rows[k] == 1000 * k + 500);
+  }
+}
+
+TEST_CASE("Queries that skip the blocks their zone maps rule out", "[RDBSim], [RdbQuery], [RDBzonemap]") {
+  //a time series, in the order of its times, with the blocks of a few of its days
+  std::vector<std::vector<std::string> > table;
+  for (uint i = 0; i != 50000; ++i)
+    table.push_back({DataType::convert<std::string, uint>(1000000 + i * 10),
+        DataType::convert<std::string, double>((i * 7919) % 1000 / 10.0),
+        i < 25000 ? "old" : "new"});
+  DbSim dbsim(5000);
+  dbsim.insert("columns", ColumnRdbTable(
+                 {ColumnType::UInt, ColumnType::Double, ColumnType::String}, table));
+  dbsim.insert("strings", StrRowRdbTable(3, table));
+
+  SECTION("a window of time") {
+    auto result = RdbQuery::scan("columns").filter(col(1) >= 1200000).filter(col(1) < 1260000)
+      .project({1}).open(dbsim);
+    std::vector<uint> times;
+    for (auto batch = result.nextBatch(1000); batch.nrow != 0; batch = result.nextBatch(1000))
+      batch.columns[0].appendTo(times);
+    REQUIRE( times.size() == 6000);
+    REQUIRE( times.front() == 1200000);
+    REQUIRE( times.back() == 1259990);
+    REQUIRE( result.scanned() == 50000);
+    //the blocks from row 20000 to 30000 are read
+    REQUIRE( result.skipped() == 40000);
+  }
+
+  SECTION("an equality, and the strings of a table of strings") {
+    const auto query = [] (const std::string& t) {
+      return RdbQuery::scan(t).filter(col(3) == "new").filter(col(2) >= 99)
+        .aggregate({RdbAggregate::count(), RdbAggregate::min(1)});
+    };
+    auto result = query("strings").open(dbsim);
+    const auto batch = result.nextBatch(defaultBatchRows);
+    REQUIRE( batch.columns[0].uints[0] == query("columns").execute(dbsim).getUInt(0, 1));
+    REQUIRE( batch.columns[0].uints[0] == 250);
+    REQUIRE( result.skipped() == 25000);
+  }
+
+  SECTION("nothing skipped without a range") {
+    auto result = RdbQuery::scan("columns").filter(col(1) != 1000000).filter(col(2) > 0).open(dbsim);
+    while (result.nextBatch(defaultBatchRows).nrow != 0) {}
+    REQUIRE( result.skipped() == 0);
+    auto all = RdbQuery::scan("columns").filter(col(1) > 1e9).open(dbsim);
+    REQUIRE( all.nextBatch(defaultBatchRows).nrow == 0);
+    REQUIRE( all.skipped() == 50000);
+  }
+}
@@ -2,9 +2,11 @@
 #include <map>
 #include <tuple>
 #include <array>
+#include <thread>
 #include "util.h"
 #include "datatypes.h"
 #include "RelationalDatabaseSim.h"
+#include "RdbEncoding.h"
 #include "catch.hpp"
 
 
@@ -185,3 +187,337 @@ TEST_CASE("Simulate a Relational Database Table with column names", "[RDBSim], [
     delete res;
 }
 
+
+TEST_CASE("Simulate a columnar Relational Database Table", "[RDBSim], [RDBcolumnTableSim]") {
+  std::vector<std::vector<std::string> > table;
+  for (uint i = 0; i != 100; ++i) {
+    std::vector<std::string> row{ DataType::convert<std::string, double>((double) i + 0.5),
+        DataType::convert<std::string, int>((int) i - 50),
+        DataType::convert<std::string, uint>(i),
+        wordyInteger(i)};
+    table.push_back(row);
+  }
+  const ColumnRdbTable::Schema schema {
+    ColumnType::Double, ColumnType::Int, ColumnType::UInt, ColumnType::String};
+
+  ColumnRdbTable* res = new ColumnRdbTable(schema, table);
+  REQUIRE( res->size() == (uint) table.size());
+  REQUIRE( res->ncol() == 4);
+  REQUIRE( res->column(1).doubles.size() == table.size());
+  REQUIRE( res->column(4).stringView(3) == wordyInteger(3));
+  uint i = 0;
+  while (res->next()) {
+    REQUIRE( res->getDouble(1) == (double) i + 0.5);
+    REQUIRE( res->getInt(2) == (int) i - 50);
+    REQUIRE( res->getUInt(3) == i);
+    REQUIRE( res->getString(4) == wordyInteger(i));
+    //numeric columns can be read with another type
+    REQUIRE( res->getDouble(3) == (double) i);
+    REQUIRE( res->getString(3) == DataType::convert<std::string, uint>(i));
+    i += 1;
+  }
+  REQUIRE( i == 100);
+
+  SECTION("typed values, read through a parameter pack") {
+    ColumnRdbTable copy(*res);
+    REQUIRE( copy.next());
+    auto tup = getTupleValue<ColumnRdbTable*, double, int, uint, std::string>(&copy, 0);
+    REQUIRE( std::get<3>(tup) == wordyInteger(0));
+  }
+
+  SECTION("from a table of strings") {
+    StrRowRdbTable strTable(4, table);
+    ColumnRdbTable columns(schema, strTable);
+    REQUIRE( columns.nrow() == strTable.nrow());
+    REQUIRE( columns.column(2).ints[99] == 49);
+    DbSim dbsim;
+    dbsim.insert("columns", columns);
+    REQUIRE( dbsim.columnTable("columns")->nrow() == 100);
+  }
+
+  SECTION("fields that do not parse") {
+    REQUIRE_THROWS_AS( res->insert({"1.5", "x", "1", "one"}), std::invalid_argument);
+    REQUIRE( res->nrow() == 100);
+    REQUIRE( res->column(1).doubles.size() == 100);
+    REQUIRE_THROWS_AS( res->column(5), std::invalid_argument);
+  }
+
+  delete res;
+}
+
+TEST_CASE("Independent cursors on a table", "[RDBSim], [RDBcursor]") {
+  std::vector<std::vector<std::string> > table;
+  for (uint i = 0; i != 1000; ++i) {
+    std::vector<std::string> row{ DataType::convert<std::string, double>((double) i),
+        DataType::convert<std::string, uint>(i),
+        wordyInteger(i)};
+    table.push_back(row);
+  }
+  DbSim dbsim;
+  dbsim.insert("table", StrRowRdbTable(3, table));
+  dbsim.insert("columns", ColumnRdbTable(
+                 {ColumnType::Double, ColumnType::UInt, ColumnType::String}, table));
+
+  SECTION("cursors do not move each other") {
+    const auto first = dbsim.cursor("table");
+    const auto second = dbsim.cursor("table");
+    REQUIRE( first.next());
+    REQUIRE( first.next());
+    REQUIRE( second.next());
+    REQUIRE( first.getUInt(2) == 1);
+    REQUIRE( second.getUInt(2) == 0);
+    REQUIRE( dbsim.table("table")->position() == 0);
+  }
+
+  SECTION("concurrent scans") {
+    const auto scan = [&dbsim] (const bool columns) {
+      double sum = 0;
+      if (columns) {
+        const auto c = dbsim.columnCursor("columns");
+        while (c.next()) sum += c.getDouble(1);
+      } else {
+        const auto c = dbsim.cursor("table");
+        while (c.next()) sum += c.getDouble(1);
+      }
+      return sum;
+    };
+    std::vector<double> sums(8);
+    std::vector<std::thread> threads;
+    for (uint t = 0; t != sums.size(); ++t)
+      threads.emplace_back([&, t] () { sums[t] = scan(t % 2);});
+    for (auto& thread: threads) thread.join();
+    for (const auto sum: sums) REQUIRE( sum == 999.0 * 1000.0 / 2);
+  }
+
+  SECTION("a cursor reads like a table") {
+    const auto c = dbsim.columnCursor("columns");
+    IterableRDB< const RdbCursor<ColumnRdbTable> > rows(&c);
+    const double sum = std::accumulate(rows.begin(), rows.end(), 0.0,
+                                       [] (const double s, const auto row) {
+                                         return s + row->getUInt(2);
+                                       });
+    REQUIRE( sum == 999.0 * 1000.0 / 2);
+  }
+}
+
+TEST_CASE("Read a table in batches of rows", "[RDBSim], [RDBbatch]") {
+  std::vector<std::vector<std::string> > table;
+  for (uint i = 0; i != 1000; ++i) {
+    std::vector<std::string> row{ DataType::convert<std::string, double>((double) i),
+        DataType::convert<std::string, uint>(i),
+        wordyInteger(i)};
+    table.push_back(row);
+  }
+  const std::vector<ColumnType> schema{ColumnType::Double, ColumnType::UInt, ColumnType::String};
+
+  SECTION("spans over the columns of a columnar table") {
+    ColumnRdbTable ct(schema, table);
+    uint nrow = 0;
+    for (auto batch = ct.nextBatch(300); batch.nrow != 0; batch = ct.nextBatch(300)) {
+      REQUIRE( batch.columns.size() == 3);
+      REQUIRE( batch.nrow == std::min(300U, 1000U - nrow));
+      REQUIRE( batch.columns[0].doubles.size == batch.nrow);
+      REQUIRE( batch.columns[0].doubles.data == ct.column(1).doubles.data() + nrow);
+      for (uint i = 0; i != batch.nrow; ++i) {
+        REQUIRE( batch.columns[1].uints[i] == nrow + i);
+        REQUIRE( batch.columns[2].stringView(i) == wordyInteger(nrow + i));
+      }
+      nrow += batch.nrow;
+    }
+    REQUIRE( nrow == 1000);
+    REQUIRE( ct.nextBatch(300).nrow == 0);
+  }
+
+  SECTION("string columns built for a table of strings") {
+    StrRowRdbTable st(3, table);
+    const auto batch = st.nextBatch(10);
+    REQUIRE( batch.nrow == 10);
+    REQUIRE( batch.columns[0].type == ColumnType::String);
+    REQUIRE( batch.columns[0].get<double>(7) == 7.0);
+    REQUIRE( batch.columns[2].get<std::string>(7) == wordyInteger(7));
+    REQUIRE( st.nextBatch(10).columns[1].get<uint>(0) == 10);
+  }
+
+  SECTION("a cursor in batches") {
+    DbSim dbsim;
+    dbsim.insert("columns", ColumnRdbTable(schema, table));
+    const auto c = dbsim.columnCursor("columns");
+    REQUIRE( c.next());
+    const auto batch = c.nextBatch(2000);
+    REQUIRE( batch.nrow == 999);
+    REQUIRE( batch.columns[1].uints[0] == 1);
+    REQUIRE( c.position() == 1000);
+    std::vector<int> ints;
+    batch.columns[1].appendTo(ints);
+    REQUIRE( ints.size() == 999);
+    REQUIRE( ints.back() == 999);
+  }
+}
+
+TEST_CASE("Indexes of the columns of a table", "[RDBSim], [RDBindex]") {
+  SECTION("a sorted index, with keys inserted one at a time") {
+    RdbKeyIndex<double> index(IndexKind::Sorted);
+    std::vector<double> keys;
+    for (uint i = 0; i != 5000; ++i) {
+      keys.push_back((double) ((i * 7919) % 1000));
+      index.insert({{keys.back(), i}});
+    }
+    const auto expected = [&keys] (const double low, const double high) {
+      std::vector<uint> rows;
+      for (uint i = 0; i != keys.size(); ++i)
+        if (keys[i] >= low and keys[i] < high) rows.push_back(i);
+      return rows;
+    };
+    REQUIRE( index.range(100.0, true, 200.0, false) == expected(100, 200));
+    REQUIRE( index.range(100.0, false, 200.0, true) == expected(100.5, 200.5));
+    REQUIRE( index.range(std::nullopt, true, 3.0, false) == expected(-1, 3));
+    REQUIRE( index.range(997.0, true, std::nullopt, true) == expected(997, 1000));
+    REQUIRE( index.equal(42) == expected(42, 43));
+    REQUIRE( index.equal(42.5).empty());
+  }
+
+  SECTION("a hash index finds keys, not ranges") {
+    RdbKeyIndex<std::string> index(IndexKind::Hash);
+    index.insert({{"b", 0}, {"a", 1}, {"b", 2}});
+    index.insert({{"b", 3}});
+    REQUIRE( index.equal("b") == std::vector<uint>{0, 2, 3});
+    REQUIRE( index.equal("c").empty());
+    REQUIRE_THROWS_AS( index.range(std::string("a"), true, std::nullopt, true), std::invalid_argument);
+  }
+
+  SECTION("indexes of a database, kept up to date") {
+    std::vector<std::vector<std::string> > table;
+    for (uint i = 0; i != 100; ++i)
+      table.push_back({DataType::convert<std::string, uint>(i), wordyInteger(i % 10 + 1)});
+    DbSim dbsim;
+    dbsim.insert("columns", ColumnRdbTable({ColumnType::UInt, ColumnType::String}, table));
+    dbsim.insert("strings", StrRowRdbTable(2, table));
+    dbsim.createIndex("columns", 1, IndexKind::Sorted);
+    dbsim.createIndex("strings", 2, IndexKind::Hash);
+    REQUIRE( dbsim.index("columns", 2) == nullptr);
+    REQUIRE( dbsim.index("columns", 1)->kind() == IndexKind::Sorted);
+    REQUIRE( dbsim.index("strings", 2)->text());
+    REQUIRE( dbsim.index("strings", 2)->equal(std::string("three")).size() == 10);
+
+    dbsim.insertRow("columns", {"1000", "three"});
+    dbsim.insertRow("strings", {"1000", "three"});
+    REQUIRE( dbsim.columnTable("columns")->size() == 101);
+    REQUIRE( dbsim.index("columns", 1)->range(99.0, true, std::nullopt, true) == std::vector<uint>{99, 100});
+    REQUIRE( dbsim.index("strings", 2)->equal(std::string("three")).back() == 100);
+
+    REQUIRE_THROWS_AS( dbsim.createIndex("columns", 3, IndexKind::Hash), std::invalid_argument);
+    REQUIRE_THROWS_AS( dbsim.createIndex("nothing", 1, IndexKind::Hash), std::invalid_argument);
+  }
+}
+
+TEST_CASE("Zone maps of the columns of a table", "[RDBSim], [RDBzonemap]") {
+  std::vector<std::vector<std::string> > table;
+  for (uint i = 0; i != 1000; ++i)
+    table.push_back({DataType::convert<std::string, uint>(i), wordyInteger(i % 10 + 1)});
+  DbSim dbsim(300);
+  dbsim.insert("columns", ColumnRdbTable({ColumnType::UInt, ColumnType::String}, table));
+  dbsim.insert("strings", StrRowRdbTable(2, table));
+  const RdbZoneMap* numbers = dbsim.zoneMap("columns", 1);
+  REQUIRE( numbers != nullptr);
+  REQUIRE_FALSE( numbers->text());
+  REQUIRE( numbers->size() == 4);
+  REQUIRE( numbers->numbers().zone(1).min == 300);
+  REQUIRE( numbers->numbers().zone(3).max == 999);
+  REQUIRE( numbers->mayHold(1, 500.0, true, std::nullopt, true));
+  REQUIRE_FALSE( numbers->mayHold(0, 500.0, true, std::nullopt, true));
+  REQUIRE( dbsim.zoneMap("columns", 2)->strings().zone(0).max == "two");
+  REQUIRE( dbsim.zoneMap("strings", 1)->text());
+  REQUIRE( dbsim.zoneMap("strings", 1)->strings().zone(0).max == "99");
+  REQUIRE( dbsim.zoneMap("columns", 3) == nullptr);
+  REQUIRE( dbsim.zoneMap("nothing", 1) == nullptr);
+
+  dbsim.insertRow("columns", {"5", "one"});
+  REQUIRE( numbers->numbers().zone(3).rows == 101);
+  REQUIRE( numbers->numbers().zone(3).min == 5);
+}
+
+TEST_CASE("Encoded columns of a table", "[RDBSim], [RDBencoding]") {
+  std::vector<std::vector<std::string> > table;
+  for (uint i = 0; i != 10000; ++i)
+    table.push_back({wordyInteger(i % 7 + 1), DataType::convert<std::string, uint>(i / 1000),
+        DataType::convert<std::string, int>((int) (i * 7919 % 1000) - 500),
+        DataType::convert<std::string, double>(i / 4.0)});
+  const ColumnRdbTable::Schema schema{
+    ColumnType::String, ColumnType::UInt, ColumnType::Int, ColumnType::Double};
+  const ColumnRdbTable plain(schema, table);
+  ColumnRdbTable ct = plain;
+  ct.encode();
+
+  SECTION("the encoding that takes the fewest bytes, for each column") {
+    REQUIRE( ct.encoding(1) == ColumnEncoding::Dictionary);
+    REQUIRE( ct.encoding(2) == ColumnEncoding::RunLength);
+    REQUIRE( ct.encoding(3) == ColumnEncoding::FrameOfReference);
+    REQUIRE( ct.encoding(4) == ColumnEncoding::Plain);
+    REQUIRE( ct.column(1).encoded->bytes() < plain.column(1).blob.size());
+    REQUIRE( ct.column(2).encoded->values().size() == 10);
+    REQUIRE( ct.column(3).encoded->base() == -500);
+    REQUIRE( ct.column(3).encoded->bytes() == 10000 * 2);
+    REQUIRE( plain.encoding(1) == ColumnEncoding::Plain);
+  }
+
+  SECTION("the values read as they were") {
+    for (uint i = 0; i < 10000; i += 37)
+      for (uint j = 1; j <= 4; ++j) REQUIRE( ct.getString(i, j) == plain.getString(i, j));
+    const auto batch = ct.batch(995, 10);
+    REQUIRE( batch.columns[1].uints[4] == 0);
+    REQUIRE( batch.columns[1].uints[5] == 1);
+    REQUIRE( batch.columns[0].stringView(9) == wordyInteger(1004 % 7 + 1));
+    REQUIRE( batch.columns[2].ints[0] == plain.getInt(995, 3));
+    const auto spans = ct.encodedBatch(995, 10);
+    REQUIRE( spans.columns[0].encoded == ct.column(1).encoded.get());
+    REQUIRE( spans.columns[0].first == 995);
+    const uint rows[] = {3, 1, 4};
+    const auto gathered = ct.gather(rows, 3);
+    REQUIRE( gathered.columns[0].stringView(2) == wordyInteger(4 % 7 + 1));
+  }
+
+  SECTION("a column that rows are inserted into") {
+    ct.insert({"one", "10", "-501", "0.5"});
+    REQUIRE( ct.encoding(2) == ColumnEncoding::Plain);
+    REQUIRE( ct.nrow() == 10001);
+    REQUIRE( ct.getUInt(9999, 2) == 9);
+    REQUIRE( ct.getInt(10000, 3) == -501);
+    REQUIRE( ct.batch(9999, 2).columns[0].stringView(1) == "one");
+  }
+
+  SECTION("rows that the encodings have room for") {
+    const ColumnRdbTable shared = ct;
+    ct.insert({"two", "9", "499", "0.5"});
+    REQUIRE( ct.nrow() == 10001);
+    REQUIRE( ct.encoding(1) == ColumnEncoding::Dictionary);
+    REQUIRE( ct.encoding(2) == ColumnEncoding::RunLength);
+    REQUIRE( ct.encoding(3) == ColumnEncoding::FrameOfReference);
+    REQUIRE( ct.column(2).encoded->values().size() == 10);
+    REQUIRE( ct.getString(10000, 1) == "two");
+    REQUIRE( ct.getUInt(10000, 2) == 9);
+    REQUIRE( ct.getInt(10000, 3) == 499);
+    REQUIRE( ct.batch(9999, 2).columns[2].ints[1] == 499);
+    REQUIRE( shared.nrow() == 10000);
+    REQUIRE( shared.column(1).encoded->size() == 10000);
+  }
+
+  SECTION("columns decoded by inserts are encoded again") {
+    ct.insert({"one", "10", "-501", "0.5"});
+    REQUIRE( ct.encoding(2) == ColumnEncoding::Plain);
+    REQUIRE( ct.encoding(3) == ColumnEncoding::Plain);
+    //an eighth of the table, 11500 rows
+    for (uint i = 1; i != 1500; ++i) ct.insert({"one", "10", "-501", "0.5"});
+    REQUIRE( ct.encoding(2) == ColumnEncoding::RunLength);
+    REQUIRE( ct.encoding(3) == ColumnEncoding::FrameOfReference);
+    REQUIRE( ct.column(2).encoded->values().size() == 11);
+    REQUIRE( ct.getInt(11499, 3) == -501);
+    REQUIRE( ct.getString(1234, 1) == plain.getString(1234, 1));
+  }
+
+  SECTION("tables encoded as they are loaded") {
+    DbSim dbsim;
+    dbsim.insert("columns", plain);
+    REQUIRE( dbsim.columnTable("columns")->encoding(1) == ColumnEncoding::Dictionary);
+    REQUIRE( dbsim.columnTable("columns")->getString(1234, 1) == plain.getString(1234, 1));
+  }
+}
@@ -0,0 +1,41 @@
+#include <cmath>
+#include <numeric>
+#include <vector>
+#include "algebra.h"
+#include "catch.hpp"
+
+TEST_CASE("The vectorized function algebra", "[category] [vectorized]")
+{
+	using namespace category::vectorized;
+	auto f = [] (double x) { return x * x; };
+	auto g = [] (double x) { return x + 2; };
+
+	//the scalar algebra of category.h, for reference
+	auto h = category::Add(category::Compose(f, g), category::Multiply(f, g));
+	const auto e = (lift(g) ^ f) + lift(f) * g;
+	CHECK(e(3.0) == h(3.0));
+
+	std::vector<double> xs(10000);
+	std::iota(std::begin(xs), std::end(xs), -5000.0);
+
+	SECTION("evaluated over a vector, across blocks") {
+		const auto ys = evaluate(e, xs);
+		REQUIRE(ys.size() == xs.size());
+		bool same = true;
+		for (std::size_t i = 0; i != xs.size(); ++i) same = same and ys[i] == h(xs[i]);
+		CHECK(same);
+	}
+
+	SECTION("constants, differences and in place evaluation") {
+		const auto line = 2.0 * arg - 1;
+		evaluate(line, xs.data(), xs.data(), xs.size());
+		CHECK(xs.front() == -10001.0);
+		CHECK(xs.back() == 9997.0);
+	}
+
+	SECTION("columns of other types") {
+		const std::vector<int> column {1, 2, 3};
+		const auto root = lift([] (double x) { return std::sqrt(x); }) ^ (arg * arg);
+		CHECK(evaluate(root, column) == std::vector<double>({1.0, 2.0, 3.0}));
+	}
+}
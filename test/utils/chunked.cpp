@@ -0,0 +1,70 @@
+#include <vector>
+#include "chunked.h"
+#include "catch.hpp"
+
+using namespace Monadic;
+
+TEST_CASE("A chunked persistent sequence", "[ChunkedSequence]")
+{
+	std::vector<int> xs(1000);
+	std::iota(std::begin(xs), std::end(xs), 0);
+	const Chunked<int> cs(std::begin(xs), std::end(xs));
+	REQUIRE(cs.size() == xs.size());
+	CHECK(cs.nchunks() == (xs.size() + 31) / 32);
+	CHECK(std::equal(std::begin(cs), std::end(cs), std::begin(xs)));
+	CHECK(cs[0] == 0);
+	CHECK(cs[517] == 517);
+	CHECK(cs.at(999) == 999);
+	REQUIRE_THROWS_AS(cs.at(1000), std::out_of_range);
+
+	SECTION("pushing back leaves older versions unchanged") {
+		const auto cs1 = cs.pushed_back(1000);
+		const auto cs2 = cs.pushed_back(-1);
+		CHECK(cs.size() == 1000);
+		CHECK(cs1.size() == 1001);
+		CHECK(cs1[1000] == 1000);
+		CHECK(cs2[1000] == -1);
+	}
+
+	SECTION("slice and concat share chunks") {
+		const auto s = cs.slice(10, 990);
+		REQUIRE(s.size() == 980);
+		CHECK(s[0] == 10);
+		CHECK(s[979] == 989);
+		const auto c = concat(cs.slice(0, 10), cs.slice(10, 1000));
+		CHECK(c == cs);
+		CHECK(c.nchunks() <= cs.nchunks() + 1);
+	}
+
+	SECTION("monadic functions") {
+		const auto ds = map([] (const int x) {return 2.0 * x;}, cs);
+		CHECK(ds.size() == cs.size());
+		CHECK(ds[999] == 1998.0);
+		const auto evens = filter([] (const int x) {return x % 2 == 0;}, cs);
+		CHECK(evens.size() == 500);
+		CHECK(foldl([] (const long s, const int x) {return s + x;}, 0L, cs) == 499500L);
+
+		const auto twice = cs >>= [] (const int x) {return Chunked<int>({x, x});};
+		REQUIRE(twice.size() == 2000);
+		CHECK(twice[1] == 0);
+		CHECK(twice[1999] == 999);
+
+		const Chunked< Chunked<int> > ccs {cs, cs};
+		CHECK(flatten(ccs) == concat(cs, cs));
+	}
+
+	SECTION("small appends fill the last chunk in place") {
+		Chunked<int> small;
+		const Chunked<int> pair {1, 2};
+		for (int i = 0; i != 500; ++i) small.append(pair);
+		REQUIRE(small.size() == 1000);
+		CHECK(small.nchunks() == 1000 / 32 + 1);
+		//a version that shares the last chunk leaves it as it is
+		const auto before = small;
+		small.append(pair);
+		CHECK(before.size() == 1000);
+		CHECK(small.size() == 1002);
+		CHECK(small[1001] == 2);
+		CHECK(before == small.slice(0, 1000));
+	}
+}
@@ -0,0 +1,54 @@
+#include <memory>
+#include <string>
+#include "curry.h"
+#include "catch.hpp"
+
+using namespace category;
+
+namespace {
+int volume(int x, int y, int z) { return x * y * z;}
+}
+
+TEST_CASE("Currying functions of any arity", "[category] [curry]")
+{
+	SECTION("the arity is read from the signature") {
+		const auto f = curry(volume);
+		CHECK(f(2)(3)(4) == 24);
+		CHECK(f(2, 3)(4) == 24);
+		CHECK(f(2)(3, 4) == 24);
+		const auto g = f(2);
+		//g keeps its argument, and can be used again
+		CHECK(g(1)(1) == 2);
+		CHECK(g(5, 5) == 50);
+		CHECK(arity<decltype(&volume)>::value == 3);
+	}
+
+	SECTION("generic lambdas are called once they can be") {
+		const auto join = curry([] (const auto& a, const auto& b, const auto& c) { return a + b + c;});
+		CHECK(join(std::string("a"))(std::string("b"))(std::string("c")) == "abc");
+		const auto phi = [] (auto x, auto y) { return x + y;};
+		CHECK(curry(phi)(3)(4) == 7);
+	}
+
+	SECTION("an explicit arity") {
+		const auto sum = [] (auto... xs) { return (0 + ... + xs);};
+		CHECK(curry<3>(sum)(1)(2)(3) == 6);
+	}
+
+	SECTION("arguments that can only be moved") {
+		const auto deref = curry([] (std::unique_ptr<int> p, int x) { return *p + x;});
+		CHECK(deref(std::make_unique<int>(40))(2) == 42);
+	}
+}
+
+TEST_CASE("Partial application with placeholders", "[category] [curry]")
+{
+	const auto minus = [] (int x, int y) { return x - y;};
+	CHECK(partial(minus, 10)(3) == 7);
+	CHECK(partial(minus, _1, 10)(3) == -7);
+	CHECK(partial(minus, _2, _1)(1, 10) == 9);
+	CHECK(partial(volume, _1, 2, _1)(3) == 18);
+	CHECK(partial(volume, 1, 2, 3)() == 6);
+	//std::bind understands the placeholders too
+	CHECK(std::bind(minus, _2, _1)(1, 10) == 9);
+}
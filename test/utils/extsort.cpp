@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "extsort.h"
+#include "catch.hpp"
+
+namespace
+{
+	template <typename T>
+	std::string sortKey(const T& x, const bool descending = false)
+	{
+		std::string key;
+		appendSortKey(key, x, descending);
+		return key;
+	}
+}
+
+TEST_CASE("Keys that sort as bytes", "[extsort]")
+{
+	const std::vector<double> doubles{-1e300, -2.5, -1, -0.0, 0, 1e-300, 3, 1e300};
+	for (std::size_t i = 0; i + 1 != doubles.size(); ++i) {
+		CHECK(sortKey(doubles[i]) <= sortKey(doubles[i + 1]));
+		CHECK(sortKey(doubles[i], true) >= sortKey(doubles[i + 1], true));
+	}
+	CHECK(sortKey(-0.0) == sortKey(0.0));
+	CHECK(sortKey(-3) < sortKey(-2));
+	CHECK(sortKey(-1) < sortKey(0));
+	CHECK(sortKey(0U) < sortKey(4000000000U));
+	CHECK(sortKey(std::string("a")) < sortKey(std::string("ab")));
+	CHECK(sortKey(std::string("ab")) < sortKey(std::string("b")));
+	CHECK(sortKey(std::string("a")) < sortKey(std::string("a\0", 2)));
+	CHECK(sortKey(std::string("a"), true) > sortKey(std::string("ab"), true));
+	//the first key decides, whatever the lengths of the strings
+	std::string k1 = sortKey(std::string("a"));
+	appendSortKey(k1, 9);
+	std::string k2 = sortKey(std::string("a"));
+	appendSortKey(k2, 10);
+	CHECK(k1 < k2);
+}
+
+TEST_CASE("A merge with a loser tree", "[extsort]")
+{
+	const std::vector< std::vector<int> > sources{{1, 4, 9}, {2, 3, 10, 11}, {}, {0, 4, 12}, {5}};
+	std::vector<std::size_t> positions(sources.size(), 0);
+	std::vector<std::size_t> nonEmpty;
+	for (std::size_t s = 0; s != sources.size(); ++s)
+		if (not sources[s].empty()) nonEmpty.push_back(s);
+	const auto head = [&] (const std::size_t i) {
+		return sources[nonEmpty[i]][positions[nonEmpty[i]]];
+	};
+	LoserTree tree(nonEmpty.size(), [&] (std::size_t a, std::size_t b) { return head(a) < head(b);});
+	std::vector< std::pair<int, std::size_t> > merged;
+	for (std::size_t i = tree.top(); i != tree.None; i = tree.top()) {
+		merged.emplace_back(head(i), nonEmpty[i]);
+		tree.replay(++positions[nonEmpty[i]] == sources[nonEmpty[i]].size());
+	}
+	//4 from the first source first
+	const std::vector< std::pair<int, std::size_t> > expected{
+		{0, 3}, {1, 0}, {2, 1}, {3, 1}, {4, 0}, {4, 3}, {5, 4}, {9, 0}, {10, 1}, {11, 1}, {12, 3}};
+	CHECK(merged == expected);
+}
+
+TEST_CASE("Sorting more records than the memory of a sort", "[extsort]")
+{
+	const std::size_t n = 50000;
+	std::vector< std::tuple<int, std::string, std::size_t> > expected;
+	const auto sortAll = [&] (ExternalSort& sort) {
+		for (std::size_t i = 0; i != n; ++i) {
+			const int x = (int) ((i * 7919) % 1001) - 500;
+			const std::string word = i % 3 == 0 ? "three" : i % 3 == 1 ? "one" : "";
+			std::string key;
+			appendSortKey(key, word);
+			appendSortKey(key, x, true);
+			sort.add(key, std::to_string(i));
+			expected.emplace_back(x, word, i);
+		}
+		std::vector<std::size_t> rows;
+		for (const SortRecord* r = sort.next(); r; r = sort.next()) rows.push_back(std::stoul(r->payload));
+		CHECK(sort.next() == nullptr);
+		return rows;
+	};
+	//words in order, numbers from the largest, rows in the order they came in
+	const auto check = [&] (const std::vector<std::size_t>& rows) {
+		std::stable_sort(expected.begin(), expected.end(), [] (const auto& a, const auto& b) {
+				return std::get<1>(a) < std::get<1>(b) or
+					(std::get<1>(a) == std::get<1>(b) and std::get<0>(a) > std::get<0>(b));
+			});
+		REQUIRE(rows.size() == n);
+		for (std::size_t i = 0; i != n; ++i) REQUIRE(rows[i] == std::get<2>(expected[i]));
+	};
+
+	SECTION("in memory") {
+		ExternalSort sort;
+		check(sortAll(sort));
+		CHECK(sort.spilled() == 0);
+	}
+
+	SECTION("in runs of temporary files") {
+		ExternalSort sort(100000);
+		check(sortAll(sort));
+		CHECK(sort.spilled() > 10);
+		CHECK(sort.size() == n);
+		CHECK_THROWS_AS(sort.add("", ""), std::logic_error);
+	}
+
+	SECTION("with no thread of its own") {
+		ThreadPool none(0);
+		ExternalSort sort(1 << 20, none);
+		check(sortAll(sort));
+	}
+
+	SECTION("nothing to sort") {
+		ExternalSort sort;
+		CHECK(sort.next() == nullptr);
+	}
+}
@@ -0,0 +1,78 @@
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "format.h"
+#include "list.h"
+#include "stream.h"
+#include "catch.hpp"
+
+using namespace Format;
+
+TEST_CASE("Building text in a single buffer", "[TextBuilder]")
+{
+	SECTION("numbers, strings and tuples") {
+		TextBuilder text;
+		text << 42 << ' ' << -7L << ' ' << 0.5 << ' ' << "abc" << ' ' << std::string("de");
+		CHECK(text.str() == "42 -7 0.5 abc de");
+
+		TextBuilder tuple;
+		tuple << std::make_tuple(1, std::string("one"), 1.25);
+		CHECK(tuple.str() == "(1,one,1.25)");
+	}
+
+	SECTION("ranges with their separators") {
+		TextBuilder text;
+		text.range(Persistent::List<int>({1, 2, 3}));
+		text.range(Monadic::List<int>({4, 5}), {"[", ";", "]"});
+		text.range(std::vector<int>(), {"<", ",", ">"});
+		const auto ones = Monadic::iterate(1, [] (const int x) {return x;});
+		text.range(Monadic::take(3, ones), {" ", "", ""});
+		CHECK(text.str() == "1, 2, 3[4;5]<> 111");
+		CHECK(Persistent::to_string(Persistent::List<int>({1, 2, 3})) == "123");
+		//as std::to_string writes them
+		CHECK(Persistent::to_string(Persistent::List<double>({1.5})) == "1.500000");
+		CHECK(Persistent::to_string(Persistent::List<char>({'a'})) == "97");
+	}
+
+	SECTION("flushing to a stream in blocks") {
+		std::ostringstream out;
+		{
+			TextBuilder text(out, 64);
+			for (int i = 0; i != 1000; ++i) text << i << '\n';
+			CHECK(text.size() < 64 + 8);
+		}
+		std::ostringstream expected;
+		for (int i = 0; i != 1000; ++i) expected << i << '\n';
+		CHECK(out.str() == expected.str());
+	}
+
+	SECTION("flushing to a file descriptor") {
+		std::FILE* file = std::tmpfile();
+		REQUIRE(file);
+		{
+			TextBuilder text(fileno(file));
+			text.range(std::vector<int>({10, 20}), {"", ",", "\n"});
+		}
+		std::rewind(file);
+		char line[16] = {0};
+		REQUIRE(std::fgets(line, sizeof(line), file));
+		CHECK(std::string(line) == "10,20\n");
+		std::fclose(file);
+	}
+
+	SECTION("a write that fails keeps what was not written") {
+		const int fd = ::open("/dev/null", O_RDONLY);
+		REQUIRE(fd >= 0);
+		{
+			TextBuilder text(fd);
+			text << "abc";
+			CHECK_THROWS_AS(text.flush(), std::system_error);
+			CHECK(text.str() == "abc");
+		}
+		::close(fd);
+	}
+}
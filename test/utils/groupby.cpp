@@ -0,0 +1,76 @@
+#include <map>
+#include <string>
+#include <vector>
+#include "groupby.h"
+#include "catch.hpp"
+
+TEST_CASE("Grouped aggregation", "[groupby]")
+{
+	//keys with a first row each, in an order of their own
+	const std::size_t n = 200000;
+	std::vector<int> keys(n);
+	std::vector<double> values(n);
+	for (std::size_t i = 0; i != n; ++i) {
+		keys[i] = (int) ((i * 7919) % 1000) - 500;
+		values[i] = (double) (i % 13);
+	}
+	std::map<int, Accumulator> expected;
+	std::vector<int> order;
+	for (std::size_t i = 0; i != n; ++i) {
+		if (not expected.count(keys[i])) order.push_back(keys[i]);
+		expected[keys[i]].add(values[i]);
+	}
+
+	const auto check = [&] (const Groups<int>& groups) {
+		REQUIRE(groups.size() == expected.size());
+		CHECK(groups.keys == order);
+		for (std::size_t g = 0; g != groups.size(); ++g) {
+			const Accumulator& a = expected[groups.keys[g]];
+			CHECK(keys[groups.first[g]] == groups.keys[g]);
+			CHECK(groups.at(g, 0).count == a.count);
+			CHECK(groups.at(g, 0).sum == a.sum);
+			CHECK(groups.at(g, 1).value(AggregateOp::Min) == a.min);
+			CHECK(groups.at(g, 1).value(AggregateOp::Max) == a.max);
+		}
+	};
+	const auto key = [&keys] (std::size_t i) { return keys[i];};
+	const auto value = [&values] (std::size_t, std::size_t i) { return values[i];};
+
+	SECTION("small integer keys are indexed directly") {
+		check(groupRows<int>(n, 2, key, value));
+	}
+
+	SECTION("other keys are hashed") {
+		check(groupRowsHashed<int>(n, 2, key, value, ThreadPool::shared()));
+	}
+
+	SECTION("the same groups with one thread or several") {
+		ThreadPool one(0);
+		check(groupRows<int>(n, 2, key, value, one));
+	}
+
+	SECTION("string keys") {
+		std::vector<std::string> names(n);
+		for (std::size_t i = 0; i != n; ++i) names[i] = "key" + std::to_string(keys[i]);
+		const auto groups = groupRows<std::string>(
+			n, 1,
+			[&names] (std::size_t i) -> const std::string& { return names[i];},
+			value);
+		REQUIRE(groups.size() == order.size());
+		for (std::size_t g = 0; g != groups.size(); ++g) {
+			CHECK(groups.keys[g] == "key" + std::to_string(order[g]));
+			CHECK(groups.at(g, 0).sum == expected[order[g]].sum);
+		}
+	}
+
+	SECTION("no rows") {
+		CHECK(groupRows<int>(0, 1, key, value).size() == 0);
+	}
+
+	SECTION("a table that grows") {
+		GroupTable<long> table;
+		for (long k = 0; k != 10000; ++k) CHECK(table.insert(k * 1000003) == (uint32_t) k);
+		for (long k = 0; k != 10000; ++k) CHECK(table.insert(k * 1000003) == (uint32_t) k);
+		CHECK(table.size() == 10000);
+	}
+}
@@ -0,0 +1,106 @@
+#include <map>
+#include <random>
+#include <string>
+#include "hamt.h"
+#include "catch.hpp"
+
+using namespace Persistent;
+
+//a bad hash, to exercise collisions
+struct ModHash
+{
+	std::size_t operator()(const int x) const { return (std::size_t) (x % 7);}
+};
+
+TEST_CASE("A persistent hash map", "[HAMT]")
+{
+	const HashMap<std::string, int> m0;
+	const auto m1 = m0.insert("one", 1);
+	const auto m2 = m1.insert("two", 2);
+	const auto m3 = m2.insert("one", 11);
+	REQUIRE(m0.empty());
+	REQUIRE(m1.size() == 1);
+	REQUIRE(m2.size() == 2);
+	REQUIRE(m3.size() == 2);
+	CHECK(m1.at("one") == 1);
+	CHECK(m2.at("one") == 1);
+	CHECK(m3.at("one") == 11);
+	CHECK(not m1.contains("two"));
+	CHECK(m2.erase("one").size() == 1);
+	CHECK(m2.contains("one"));
+	REQUIRE_THROWS_AS(m0.at("one"), std::out_of_range);
+
+	const HashMap<std::string, int> ml {{"a", 1}, {"b", 2}};
+	CHECK(ml.at("b") == 2);
+}
+
+TEST_CASE("A persistent hash map against std::map", "[HAMT]")
+{
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> keys(0, 5000);
+
+	SECTION("random inserts and erases, keeping old versions") {
+		HashMap<int, int> m;
+		std::map<int, int> ref;
+		std::vector< std::pair< HashMap<int, int>, std::map<int, int> > > versions;
+		for (int i = 0; i != 20000; ++i) {
+			const int k = keys(rng);
+			if (i % 3 == 2) {
+				m = m.erase(k);
+				ref.erase(k);
+			} else {
+				m = m.insert(k, i);
+				ref[k] = i;
+			}
+			if (i % 2000 == 0) versions.push_back(std::make_pair(m, ref));
+		}
+		REQUIRE(m.size() == ref.size());
+		for (const auto& kv : ref) REQUIRE(m.at(kv.first) == kv.second);
+		std::size_t n = 0;
+		for (const auto& e : m) {
+			REQUIRE(ref.at(e.key) == e.value);
+			++n;
+		}
+		CHECK(n == ref.size());
+		for (const auto& v : versions) {
+			REQUIRE(v.first.size() == v.second.size());
+			for (const auto& kv : v.second) REQUIRE(v.first.at(kv.first) == kv.second);
+		}
+	}
+
+	SECTION("colliding hashes") {
+		HashMap<int, int, ModHash> m;
+		for (int i = 0; i != 100; ++i) m = m.insert(i, -i);
+		REQUIRE(m.size() == 100);
+		for (int i = 0; i != 100; i += 2) m = m.erase(i);
+		REQUIRE(m.size() == 50);
+		for (int i = 0; i != 100; ++i) CHECK(m.contains(i) == (i % 2 == 1));
+	}
+
+	SECTION("transient batch build") {
+		const auto base = HashMap<int, int>().insert(-1, -1);
+		auto t = base.transient();
+		for (int i = 0; i != 10000; ++i) t.insert(i, i * i);
+		for (int i = 0; i != 10000; i += 2) t.erase(i);
+		const auto m = t.persistent();
+		REQUIRE(m.size() == 5001);
+		CHECK(base.size() == 1);
+		CHECK(m.at(9999) == 9999 * 9999);
+		CHECK(not m.contains(5000));
+		CHECK(m.at(-1) == -1);
+		const auto m2 = m.insert(5000, 0);
+		CHECK(not m.contains(5000));
+		CHECK(m2.contains(5000));
+	}
+}
+
+TEST_CASE("A persistent hash set", "[HAMT] [HashSet]")
+{
+	const HashSet<std::string> s {"a", "b", "c"};
+	const auto s2 = s.erase("b").insert("d");
+	CHECK(s.size() == 3);
+	CHECK(s.contains("b"));
+	CHECK(s2.size() == 3);
+	CHECK(not s2.contains("b"));
+	CHECK(s2.contains("d"));
+}
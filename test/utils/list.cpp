@@ -0,0 +1,130 @@
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "list.h"
+#include "catch.hpp"
+
+using namespace Persistent;
+
+TEST_CASE("A persistent cons list", "[PersistentList]")
+{
+	const List<int> l0;
+	REQUIRE(l0.empty());
+	REQUIRE(l0 == nil<int>);
+
+	const auto l1 = 3 >> l0;
+	const auto l2 = 2 >> l1;
+	const auto l3 = 1 >> l2;
+	REQUIRE(l3.size() == 3);
+	CHECK(head(l3) == 1);
+	CHECK(head(tail(l3)) == 2);
+	CHECK(l3 == List<int>({1, 2, 3}));
+
+	SECTION("consing leaves the tail unchanged") {
+		const auto l4 = 0 >> l1;
+		CHECK(l1 == List<int>({3}));
+		CHECK(l4 == List<int>({0, 3}));
+		CHECK(l3 == List<int>({1, 2, 3}));
+	}
+
+	SECTION("tail shares the cells of the list") {
+		CHECK(&head(tail(l3)) == &head(l2));
+		CHECK(&head(tail(tail(l3))) == &head(l1));
+	}
+
+	SECTION("reverse and map") {
+		CHECK(l3.reverse() == List<int>({3, 2, 1}));
+		CHECK(map([] (const int x) {return 2 * x;}, l3) == List<int>({2, 4, 6}));
+		CHECK(to_string(l3) == "123");
+	}
+
+	REQUIRE_THROWS_AS(head(l0), std::out_of_range);
+}
+
+TEST_CASE("A long persistent list", "[PersistentList]")
+{
+	std::vector<uint> xs(1000000);
+	std::iota(std::begin(xs), std::end(xs), 0);
+	List<uint> l(std::begin(xs), std::end(xs));
+	REQUIRE(l.size() == xs.size());
+	CHECK(std::equal(std::begin(l), std::end(l), std::begin(xs)));
+
+	List<uint> ys;
+	for (const auto x : xs) ys = x >> ys;
+	CHECK(ys.reverse() == l);
+	//destruction of a long list should not grow the stack
+	ys = nil<uint>;
+	CHECK(ys.empty());
+}
+
+TEST_CASE("Cells released by another thread go back to the pool", "[PersistentList]")
+{
+	using Pool = NodePool< Cell<long> >;
+	//lists built by a thread, and dropped by the main one
+	for (int round = 0; round != 50; ++round) {
+		List<long> l;
+		std::thread([&l] {
+				for (long i = 0; i != 10000; ++i) l = i >> l;
+			}).join();
+		REQUIRE(l.size() == 10000);
+	}
+	//the cells of a round, and those threads hold on to
+	CHECK(Pool::size() < 3 * 10000 / 256);
+}
+
+namespace
+{
+	//a T that counts its copies, and throws on the one it is told to
+	struct Fragile
+	{
+		static int alive;
+		static int copies;
+		static int throwAt;
+
+		Fragile() { ++alive;}
+		Fragile(const Fragile&)
+		{
+			if (++copies == throwAt) throw std::runtime_error("fragile");
+			++alive;
+		}
+		~Fragile() { --alive;}
+	};
+	int Fragile::alive = 0;
+	int Fragile::copies = 0;
+	int Fragile::throwAt = 0;
+}
+
+TEST_CASE("A list that throws as it is built releases its cells", "[PersistentList]")
+{
+	{
+		const std::vector<Fragile> xs(10);
+		Fragile::copies = 0;
+		Fragile::throwAt = 5;
+		CHECK_THROWS_AS(List<Fragile>(xs.begin(), xs.end()), std::runtime_error);
+		CHECK(Fragile::alive == 10);
+		Fragile::throwAt = 0;
+		const List<Fragile> l(xs.begin(), xs.end());
+		Fragile::copies = 0;
+		Fragile::throwAt = 3;
+		CHECK_THROWS_AS(l.map([] (const Fragile& x) { return x;}), std::runtime_error);
+		Fragile::copies = 0;
+		CHECK_THROWS_AS(l.concat(l), std::runtime_error);
+		CHECK(Fragile::alive == 20);
+		Fragile::throwAt = 0;
+	}
+	CHECK(Fragile::alive == 0);
+}
+
+TEST_CASE("The persistent list monad", "[PersistentList] [PersistentListMonad]")
+{
+	const List<int> xs {1, 2, 3};
+	const List< List<int> > lls {{1, 2}, {}, {3, 4}};
+	const auto ls = flatten(lls);
+	CHECK(ls == List<int>({1, 2, 3, 4}));
+	//the last list is shared
+	CHECK(&head(tail(tail(ls))) == &head(*std::next(std::begin(lls), 2)));
+
+	const auto ys = xs >>= [] (const int x) {return List<int>({x, 10 * x});};
+	CHECK(ys == List<int>({1, 10, 2, 20, 3, 30}));
+	CHECK(xs.concat(xs) == List<int>({1, 2, 3, 1, 2, 3}));
+}
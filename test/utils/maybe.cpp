@@ -0,0 +1,58 @@
+#include <string>
+#include "util.h"
+#include "parser.h"
+#include "catch.hpp"
+
+TEST_CASE("A value type Maybe", "[Maybe]")
+{
+	const Maybe<int> none = None();
+	const auto two = Valid(2);
+	REQUIRE(not none.isValid());
+	REQUIRE(two.isValid());
+	CHECK(two.get() == 2);
+	REQUIRE_THROWS_AS(none.get(), std::invalid_argument);
+	CHECK(none.getOrElse(3) == 3);
+	CHECK(none.orElse(two) == two);
+
+	const auto half = [] (const int x) {
+		return x % 2 == 0 ? Valid(x / 2) : Maybe<int>();
+	};
+	CHECK(two.map([] (const int x) {return std::to_string(x);}).get() == "2");
+	CHECK(two.flatMap(half) == Valid(1));
+	CHECK(not Valid(3).flatMap(half).isValid());
+	CHECK(not none.flatMap(half).isValid());
+	static_assert(sizeof(Maybe<double>) <= 2 * sizeof(double), "stored inline");
+}
+
+TEST_CASE("A value type Either", "[Either]")
+{
+	using Result = Either<std::string, int>;
+	const Result error = Left(std::string("no number"));
+	const Result ten = Right(10);
+	REQUIRE(error.isLeft());
+	REQUIRE(ten.isRight());
+	CHECK(error.left() == "no number");
+	CHECK(ten.get() == 10);
+	REQUIRE_THROWS_AS(error.get(), std::invalid_argument);
+
+	const auto inverse = [] (const int x) -> Either<std::string, double> {
+		if (x == 0) return Left(std::string("division by zero"));
+		return Right(1.0 / x);
+	};
+	CHECK(ten.flatMap(inverse).get() == 0.1);
+	CHECK(Result(Right(0)).flatMap(inverse).left() == "division by zero");
+	CHECK(error.map([] (const int x) {return 2 * x;}).left() == "no number");
+	CHECK(ten.map([] (const int x) {return 2 * x;}).get() == 20);
+	CHECK(error.orElse(ten).get() == 10);
+	CHECK(not error.toMaybe().isValid());
+
+	const Either<int, int> sameTypes = Left(1);
+	CHECK(sameTypes.isLeft());
+}
+
+TEST_CASE("A parsed result as a Maybe", "[Maybe] [ParsedResult]")
+{
+	using namespace Expression;
+	CHECK(parse(char_('h'), "hello").toMaybe() == Valid('h'));
+	CHECK(not parse(char_('x'), "hello").toMaybe().isValid());
+}
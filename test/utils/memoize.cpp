@@ -0,0 +1,86 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "memoize.h"
+#include "catch.hpp"
+
+using namespace category;
+
+TEST_CASE("Memoized functions", "[category] [memoize]")
+{
+	SECTION("calls are computed once") {
+		int calls = 0;
+		const auto square = memoize([&calls] (int x) -> long { ++calls; return (long) x * x;});
+		CHECK(square(12) == 144);
+		CHECK(square(12) == 144);
+		CHECK(square(3) == 9);
+		CHECK(calls == 2);
+		CHECK(square.stats().hits == 1);
+		CHECK(square.stats().misses == 2);
+
+		//copies share the table
+		const auto copy = square;
+		CHECK(copy(3) == 9);
+		CHECK(calls == 2);
+	}
+
+	SECTION("generic lambdas and several arguments") {
+		const auto join = memoize<std::string(std::string, int)>(
+			[] (const auto& s, auto n) { return s + std::to_string(n);}
+		);
+		CHECK(join("a", 1) == "a1");
+		CHECK(join("a", 1) == "a1");
+		CHECK(join.size() == 1);
+	}
+
+	SECTION("values that cannot be default constructed") {
+		struct Boxed
+		{
+			explicit Boxed(int x) : x(x) {}
+			int x;
+		};
+		int calls = 0;
+		const auto box = memoize([&calls] (int x) { ++calls; return Boxed(x);});
+		CHECK(box(7).x == 7);
+		CHECK(box(7).x == 7);
+		CHECK(calls == 1);
+	}
+
+	SECTION("a bounded table drops the least recently used entries") {
+		const auto id = memoize([] (int x) { return x;}, 32);
+		for (int i = 0; i != 1000; ++i) id(i);
+		CHECK(id.size() <= 32);
+		CHECK(id.stats().evictions >= 1000 - 32);
+	}
+
+	SECTION("a memoized fixpoint") {
+		const auto fib = memo_fix<uint64_t(int)>(
+			[] (const auto& self, int n) -> uint64_t {
+				return n < 2 ? (uint64_t) n : self(n - 1) + self(n - 2);
+			}
+		);
+		//without memoization, 2^90 calls
+		CHECK(fib(90) == 2880067194370816120ULL);
+		CHECK(fib.size() == 91);
+		CHECK(fib.stats().hitRate() > 0.4);
+	}
+
+	SECTION("called from several threads") {
+		std::atomic<int> calls {0};
+		const auto half = memoize([&calls] (int x) { ++calls; return x / 2;});
+		std::vector<std::thread> threads;
+		std::atomic<bool> wrong {false};
+		for (int t = 0; t != 4; ++t)
+			threads.emplace_back([&] () {
+					for (int i = 0; i != 10000; ++i)
+						if (half(i % 100) != (i % 100) / 2) wrong = true;
+				}
+			);
+		for (auto& thread : threads) thread.join();
+		CHECK(not wrong);
+		CHECK(half.size() == 100);
+		CHECK(calls >= 100);
+		CHECK(half.stats().hits + half.stats().misses == 40000);
+	}
+}
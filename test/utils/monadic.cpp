@@ -0,0 +1,44 @@
+#include <vector>
+#include "monadic.h"
+#include "catch.hpp"
+
+TEST_CASE("The std::list monad", "[ListMonad]")
+{
+	using Monadic::List;
+	const List<int> xs {1, 2, 3};
+
+	SECTION("map returns the mapped list") {
+		const auto ys = Monadic::map([] (const int x) {return x * x;}, xs);
+		CHECK(ys == List<int>({1, 4, 9}));
+	}
+
+	SECTION("flatten splices the inner lists") {
+		List< List<int> > lls {{1, 2}, {}, {3}, {4, 5}};
+		const int* first = &(lls.front().front());
+		const auto ls = Monadic::flatten(std::move(lls));
+		CHECK(ls == List<int>({1, 2, 3, 4, 5}));
+		CHECK(&(ls.front()) == first);
+
+		const List< List<int> > clls {{1}, {2, 3}};
+		CHECK(Monadic::flatten(clls) == List<int>({1, 2, 3}));
+		CHECK(clls.size() == 2);
+	}
+
+	SECTION("bind") {
+		const auto ys = Monadic::operator>>=(xs, [] (const int x) {
+				return List<int>(x, x);
+			}
+		);
+		CHECK(ys == List<int>({1, 2, 2, 3, 3, 3}));
+	}
+
+	SECTION("flatMap into a single container") {
+		std::vector<int> out;
+		Monadic::flatMap(
+			[] (const int x) {return std::vector<int>{x, -x};},
+			xs,
+			out
+		);
+		CHECK(out == std::vector<int>({1, -1, 2, -2, 3, -3}));
+	}
+}
@@ -0,0 +1,59 @@
+#include <vector>
+#include <list>
+#include "parallel.h"
+#include "catch.hpp"
+
+using namespace Monadic;
+
+TEST_CASE("Parallel map, filter, reduce and flatMap", "[ParallelCombinators]")
+{
+	std::vector<long> xs(100000);
+	std::iota(std::begin(xs), std::end(xs), 0);
+
+	SECTION("pmap keeps the order of the input") {
+		const auto ys = pmap([] (const long x) {return 2 * x;}, xs, 100);
+		REQUIRE(ys.size() == xs.size());
+		for (std::size_t i = 0; i != xs.size(); ++i) REQUIRE(ys[i] == 2 * xs[i]);
+	}
+
+	SECTION("pfilter") {
+		const auto ys = pfilter([] (const long x) {return x % 3 == 0;}, xs, 100);
+		REQUIRE(ys.size() == 33334);
+		CHECK(std::is_sorted(std::begin(ys), std::end(ys)));
+		CHECK(ys.back() == 99999);
+	}
+
+	SECTION("preduce") {
+		const auto s = preduce([] (const long a, const long b) {return a + b;}, 0L, xs, 100);
+		CHECK(s == 4999950000L);
+		const auto h = preduce([] (const double a, const double b) {return a + b;},
+		                       0, std::vector<double>(10000, 0.5), 100);
+		CHECK(h == 5000.0);
+	}
+
+	SECTION("pflatMap") {
+		const std::list<int> ns {1, 2, 3};
+		const auto ys = pflatMap([] (const int n) {return std::vector<int>(n, n);}, ns, 1);
+		CHECK(ys == std::vector<int>({1, 2, 2, 3, 3, 3}));
+	}
+
+	SECTION("small inputs stay sequential, and exceptions come back") {
+		const std::vector<int> small {1, 2, 3};
+		CHECK(pmap([] (const int x) {return x + 1;}, small) == std::vector<int>({2, 3, 4}));
+		REQUIRE_THROWS_AS(
+			pmap([] (const long x) {
+					if (x == 5000) throw std::invalid_argument("five thousand");
+					return x;
+				}, xs, 100),
+			std::invalid_argument
+		);
+	}
+
+	SECTION("nested parallel loops do not deadlock") {
+		const auto sums = pmap([&xs] (const long x) {
+				return preduce([] (long a, long b) {return a + b;}, x, xs, 1000);
+			}, std::vector<long>(64, 0L), 1);
+		CHECK(sums.size() == 64);
+		CHECK(sums[63] == 4999950000L);
+	}
+}
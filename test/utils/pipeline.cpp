@@ -0,0 +1,66 @@
+#include <array>
+#include <list>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "category.h"
+#include "list.h"
+#include "catch.hpp"
+
+using namespace category;
+
+TEST_CASE("fmap over runtime containers", "[category] [pipeline]")
+{
+	const auto f = [] (int x) { return x * x;};
+	const auto g = [] (int x) { return x + 2;};
+
+	SECTION("the lambda lists of category.h still map") {
+		int sum = 0;
+		List(3, 4, 5) > f > g > [&sum] (int x) { sum += x; return x;};
+		CHECK(sum == 11 + 18 + 27);
+	}
+
+	SECTION("vectors, arrays, lists and temporaries") {
+		const std::vector<int> xs {3, 4, 5};
+		const std::vector<int> ys = xs > f > g;
+		CHECK(ys == std::vector<int>({11, 18, 27}));
+
+		const std::array<int, 3> as {3, 4, 5};
+		CHECK((as > (g ^ f)).collect() == ys);
+		CHECK((std::list<int>({3, 4, 5}) > f > g).collect() == ys);
+		CHECK((Persistent::List<int>({3, 4, 5}) > f > g).collect() == ys);
+		CHECK((std::vector<int>({3, 4, 5}) > f > g).collect() == ys);
+
+		const std::vector<std::string> ss = xs > [] (int x) { return std::to_string(x);};
+		CHECK(ss == std::vector<std::string>({"3", "4", "5"}));
+	}
+
+	SECTION("the functions are fused, and run once per element") {
+		const std::vector<int> xs {1, 2, 3, 4};
+		int calls = 0;
+		const auto counted = [&calls] (int x) { ++calls; return x;};
+		const std::vector<int> ys = xs > counted > f > g;
+		CHECK(calls == 4);
+		CHECK(ys.back() == 18);
+	}
+
+	SECTION("a stage that returns nothing runs the pipeline") {
+		const std::vector<int> xs {1, 2, 3};
+		int sum = 0;
+		xs > f > [&sum] (int y) { sum += y;};
+		CHECK(sum == 14);
+	}
+
+	SECTION("parallel policies") {
+		std::vector<int> xs(100000);
+		std::iota(std::begin(xs), std::end(xs), 0);
+		const auto h = [] (int x) { return (long) x * 3;};
+		const std::vector<long> expected = seq(xs) > h;
+		CHECK((par(xs) > h).collect() == expected);
+		CHECK((par_unseq(xs) > h).collect() == expected);
+		CHECK(((xs > h).on(par)).collect() == expected);
+		std::atomic<long> sum {0};
+		par(xs) > h > [&sum] (long y) { sum += y;};
+		CHECK(sum == 3L * 99999L * 100000L / 2);
+	}
+}
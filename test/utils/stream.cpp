@@ -0,0 +1,80 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "stream.h"
+#include "catch.hpp"
+
+using namespace Monadic;
+
+TEST_CASE("A lazy stream", "[LazyStream]")
+{
+	uint calls = 0;
+	const auto naturals = iterate(0U, [&calls] (const uint n) {
+			++calls;
+			return n + 1;
+		}
+	);
+	REQUIRE(calls == 0);
+	CHECK(naturals.head() == 0);
+	CHECK(not naturals.forced());
+
+	SECTION("only what is consumed is evaluated, and only once") {
+		const auto evens = filter([] (const uint n) {return n % 2 == 0;}, naturals);
+		const auto squares = map([] (const uint n) {return n * n;}, evens);
+		CHECK(toList(take(3, squares)) == List<uint>({0, 4, 16}));
+		CHECK(calls == 4);
+		CHECK(toList(take(3, squares)) == List<uint>({0, 4, 16}));
+		CHECK(calls == 4);
+		CHECK(naturals.forced());
+	}
+
+	SECTION("zip") {
+		const std::vector<char> cs {'a', 'b', 'c'};
+		CHECK(stream(std::begin(cs), std::begin(cs)).empty());
+		const auto zs = zip(naturals, stream(std::begin(cs), std::end(cs)));
+		CHECK(toList(zs) == List< std::pair<uint, char> >({{0, 'a'}, {1, 'b'}, {2, 'c'}}));
+	}
+
+	SECTION("bind") {
+		const auto pairs = naturals >>= [] (const uint n) {
+			if (n % 3 != 0) return Stream<uint>();
+			return take(2, iterate(n, [] (const uint m) {return m;}));
+		};
+		CHECK(toList(take(5, pairs)) == List<uint>({0, 0, 3, 3, 6}));
+		CHECK(calls <= 7);
+	}
+
+	SECTION("a long stream") {
+		const auto ls = take(1000000, naturals);
+		uint n = 0;
+		for (const auto x : ls) n = x;
+		CHECK(n == 999999);
+	}
+}
+
+TEST_CASE("A stream forced by several threads at once", "[LazyStream]")
+{
+	std::atomic<uint> calls(0);
+	const auto naturals = iterate(0U, [&calls] (const uint n) {
+			++calls;
+			return n + 1;
+		}
+	);
+	std::vector<std::thread> threads;
+	std::atomic<uint> done(0);
+	for (int t = 0; t != 4; ++t)
+		threads.emplace_back([&] {
+				//forced() reads the cell while others force it
+				auto s = naturals;
+				for (uint i = 0; i != 1000; ++i) {
+					(void) s.forced();
+					s = s.tail();
+				}
+				if (s.head() == 1000) ++done;
+			}
+		);
+	for (auto& t : threads) t.join();
+	CHECK(done == 4);
+	CHECK(calls == 1000);
+	CHECK(naturals.forced());
+}
@@ -0,0 +1,69 @@
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "task.h"
+#include "catch.hpp"
+
+using namespace Async;
+
+TEST_CASE("Tasks on the work stealing pool", "[task]")
+{
+	SECTION("unit, fmap and bind") {
+		const auto t = async([] () { return 20;});
+		const auto u = fmap([] (int x) { return x + 1;}, t);
+		const auto v = u >>= [] (int x) {
+			return async([x] () { return std::to_string(2 * x);});
+		};
+		CHECK(v.get() == "42");
+		CHECK(unit(3).ready());
+		CHECK((unit(3) >>= [] (int x) { return unit(x * x);}).get() == 9);
+	}
+
+	SECTION("when_all joins independent tasks") {
+		const auto both = when_all(async([] () { return 1;}), async([] () { return std::string("two");}));
+		CHECK(both.get() == std::make_tuple(1, std::string("two")));
+
+		std::vector< Task<long> > ts;
+		for (long i = 0; i != 1000; ++i) ts.push_back(async([i] () { return i * i;}));
+		const auto squares = when_all(ts).get();
+		REQUIRE(squares.size() == 1000);
+		CHECK(squares[999] == 999L * 999L);
+	}
+
+	SECTION("tasks waiting on tasks do not exhaust the pool") {
+		//more nested waits than there are workers
+		std::vector< Task<int> > ts;
+		for (int i = 0; i != 64; ++i)
+			ts.push_back(async([i] () { return async([i] () { return i;}).get() + 1;}));
+		int sum = 0;
+		for (const auto& t : ts) sum += t.get();
+		CHECK(sum == 64 * 63 / 2 + 64);
+	}
+
+	SECTION("errors go on to the stages after them") {
+		const auto t = async([] () -> int { throw std::runtime_error("no value");});
+		const auto u = t.map([] (int x) { return x + 1;});
+		CHECK_THROWS_AS(u.get(), std::runtime_error);
+		CHECK_THROWS_AS(when_all(u, unit(1)).get(), std::runtime_error);
+	}
+
+	SECTION("a stage that returns no task fails the task after it") {
+		const auto t = unit(1) >>= [] (int) { return Task<int>();};
+		CHECK_THROWS_AS(t.get(), std::invalid_argument);
+	}
+
+	SECTION("the stages of a task that is never done are freed with it") {
+		auto held = std::make_shared<int>(0);
+		const std::weak_ptr<int> watch = held;
+		{
+			const Task<int> never(std::make_shared< TaskState<int> >(ThreadPool::shared()));
+			const auto u = never.map([held] (int x) { return x + *held;});
+			const auto v = when_all(never, u).map([held] (const auto&) { return *held;});
+			held.reset();
+			CHECK(not watch.expired());
+		}
+		CHECK(watch.expired());
+	}
+}
@@ -0,0 +1,50 @@
+#include <string>
+#include "trampoline.h"
+#include "parser.h"
+#include "catch.hpp"
+
+TEST_CASE("Tail calls on a trampoline", "[trampoline]")
+{
+	SECTION("a factorial with an accumulator") {
+		const auto factorial = [] (int n, long acc) -> Bounce<long, int, long> {
+			if (n == 0) return done(acc);
+			return again(n - 1, n * acc);
+		};
+		CHECK(run(factorial, 10, 1L) == 3628800L);
+	}
+
+	SECTION("ten million calls in constant stack") {
+		const auto count = [] (uint64_t n, uint64_t acc) -> Bounce<uint64_t, uint64_t, uint64_t> {
+			if (n == 0) return done(acc);
+			return again(n - 1, acc + n);
+		};
+		CHECK(run(count, 10000000ULL, 0ULL) == 50000005000000ULL);
+	}
+
+	SECTION("mutual recursion, with the callee as an argument") {
+		enum class Fn {even, odd};
+		const auto parity = [] (Fn fn, uint n) -> Bounce<bool, Fn, uint> {
+			if (n == 0) return done(fn == Fn::even);
+			return again(fn == Fn::even ? Fn::odd : Fn::even, n - 1);
+		};
+		CHECK(run(parity, Fn::even, 1000001U) == false);
+		CHECK(run(parity, Fn::odd, 1000001U) == true);
+	}
+}
+
+TEST_CASE("Trampolined parsers on long inputs", "[trampoline] [parser]")
+{
+	using namespace Expression;
+	const String as(20000, 'a');
+
+	const auto ras = parse(many(char_('a')), as + "b");
+	REQUIRE(not ras.empty);
+	CHECK(ras.value.size() == as.size());
+	CHECK(ras.out == "b");
+
+	const auto rd = parse(drop(as), as + "b");
+	REQUIRE(not rd.empty);
+	CHECK(rd.out == "b");
+	CHECK(parse(drop(as), as.substr(1)).empty);
+	CHECK(parse(drop(String("ab")), String("ac")).empty);
+}
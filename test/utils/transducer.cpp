@@ -0,0 +1,62 @@
+#include <vector>
+#include <list>
+#include <array>
+#include "transducer.h"
+#include "stream.h"
+#include "list.h"
+#include "kmer.h"
+#include "catch.hpp"
+
+using namespace Monadic;
+
+TEST_CASE("Transducers fuse map / filter / take", "[Transducer]")
+{
+	std::vector<int> xs(100);
+	std::iota(std::begin(xs), std::end(xs), 0);
+
+	const auto square = mapping([] (const int x) {return x * x;});
+	const auto odd = filtering([] (const int x) {return x % 2 == 1;});
+
+	SECTION("into a container") {
+		const auto ys = into(std::vector<int>(), odd | square | taking(3), xs);
+		CHECK(ys == std::vector<int>({1, 9, 25}));
+		//a transducer can be reused, its steps are created for each run
+		const auto zs = into(std::list<int>(), odd | square | taking(3), xs);
+		CHECK(zs == std::list<int>({1, 9, 25}));
+	}
+
+	SECTION("fold") {
+		const auto s = fold(
+			square | taking_while([] (const int x) {return x < 100;}),
+			[] (const int acc, const int x) {return acc + x;},
+			0,
+			xs
+		);
+		CHECK(s == 285);
+	}
+
+	SECTION("early termination on an infinite stream") {
+		uint calls = 0;
+		const auto naturals = iterate(0, [&calls] (const int n) {
+				++calls;
+				return n + 1;
+			}
+		);
+		const auto ys = into(std::vector<int>(), odd | taking(4), naturals);
+		CHECK(ys == std::vector<int>({1, 3, 5, 7}));
+		CHECK(calls == 7);
+	}
+
+	SECTION("other sources") {
+		const Persistent::List<int> l {1, 2, 3, 4};
+		CHECK(fold(odd, [] (int a, int x) {return a + x;}, 0, l) == 4);
+
+		Kmer<std::vector<int>, int, 3> kmers(std::vector<int>(xs.begin(), xs.begin() + 6));
+		const auto firsts = into(
+			std::vector<int>(),
+			mapping([] (const std::array<int, 3>& k) {return k[0] + k[1] + k[2];}),
+			kmers
+		);
+		CHECK(firsts == std::vector<int>({3, 6, 9, 12}));
+	}
+}
@@ -0,0 +1,48 @@
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include "zonemap.h"
+#include "catch.hpp"
+
+TEST_CASE("Zone maps of blocks of rows", "[zonemap]")
+{
+	ZoneMap<double> zones(100);
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	//rows in order, with a NaN in every tenth one
+	for (std::size_t i = 0; i != 1050; ++i) zones.append(i % 10 == 3 ? nan : (double) i);
+	REQUIRE(zones.rows() == 1050);
+	REQUIRE(zones.size() == 11);
+	REQUIRE(zones.zone(2).min == 200);
+	REQUIRE(zones.zone(2).max == 299);
+	REQUIRE(zones.zone(2).nulls == 10);
+	REQUIRE(zones.zone(10).rows == 50);
+	REQUIRE(zones.first(10) == 1000);
+	REQUIRE(zones.last(10) == 1050);
+
+	CHECK(zones.mayHold(2, 250.0, true, 260.0, false));
+	CHECK_FALSE(zones.mayHold(2, 400.0, true, std::nullopt, true));
+	CHECK(zones.mayHold(2, std::nullopt, true, 200.0, true));
+	CHECK_FALSE(zones.mayHold(2, std::nullopt, true, 200.0, false));
+	CHECK(zones.blocks(250.0, true, 250.0, true) == std::vector<std::size_t>{2});
+	CHECK(zones.blocks(299.0, true, 400.0, false) == std::vector<std::size_t>{2, 3});
+	CHECK(zones.blocks(2000.0, true, std::nullopt, true).empty());
+
+	SECTION("blocks of nulls hold nothing") {
+		ZoneMap<double> nulls(4);
+		for (int i = 0; i != 4; ++i) nulls.append(nan);
+		nulls.append(1);
+		REQUIRE(nulls.zone(0).empty());
+		CHECK(nulls.blocks(std::nullopt, true, std::nullopt, true) == std::vector<std::size_t>{1});
+	}
+
+	SECTION("strings") {
+		ZoneMap<std::string> words(2);
+		for (const char* w: {"pear", "apple", "plum", "quince", "fig"}) words.append(w);
+		REQUIRE(words.zone(0).min == "apple");
+		REQUIRE(words.zone(1).max == "quince");
+		CHECK(words.blocks(std::string("b"), true, std::string("p"), false) == std::vector<std::size_t>{0, 2});
+		words.clear();
+		CHECK(words.size() == 0);
+	}
+}